@@ -0,0 +1,183 @@
+// Benchmark of scene BVH: build time on one and on all hardware threads, refit, frustum queries
+// against brute force test of every mesh instance and ray casts against triangle BVHs.
+// Model is loaded into hidden window, since meshes create GL buffers. Scene is made of
+// copies x copies instances of the model placed in a grid.
+//
+// Build example (from CourseWork3 directory):
+//     g++ -O2 -mavx2 -std=c++17 -Iinclude benchmarks/BvhBenchmark.cpp src/glad.c src/Geometry/Bvh.cpp
+//         src/Core/*.cpp src/Scene/*.cpp src/Objects/*.cpp src/Render/GLStateCache.cpp
+//         src/Render/GeometryArena.cpp src/Lights/*.cpp src/Shader.cpp -lglfw -lassimp -ldl -pthread
+// Usage:
+//     BvhBenchmark [path to model] [copies]
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <Geometry/Bvh.h>
+#include <Geometry/Frustum.h>
+#include <Scene/Scene.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int ITERATIONS = 20;
+const int QUERIES_NUMBER = 1000;
+const int RAYS_NUMBER = 10000;
+
+template <typename Function>
+double measure(Function function, int iterations = ITERATIONS)
+{
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        function();
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+    string path = argc > 1 ? argv[1] : "data/models/sponza/sponza.obj";
+    int copies = argc > 2 ? stoi(argv[2]) : 1;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "BvhBenchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        cout << "ERROR::BENCHMARK::FAILED_TO_CREATE_WINDOW" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        cout << "ERROR::BENCHMARK::FAILED_TO_INITIALIZE_GLAD" << endl;
+        return -1;
+    }
+
+    Scene scene;
+    ModelHandle model = scene.addModel(Model(path));
+    AABB modelBounds = scene.getModel(model)->getBounds();
+    glm::vec3 modelSize = modelBounds.max - modelBounds.min;
+    for (int x = 0; x < copies; ++x)
+    {
+        for (int z = 0; z < copies; ++z)
+        {
+            glm::vec3 position(x * modelSize.x * 1.1f, 0.0f, z * modelSize.z * 1.1f);
+            scene.addObject(Object(position, glm::vec3(0.0f), glm::vec3(1.0f), model));
+        }
+    }
+    scene.update();
+
+    const vector<Scene::MeshInstance>& instances = scene.getMeshInstances();
+    vector<AABB> bounds;
+    for (const Scene::MeshInstance& instance : instances)
+        bounds.push_back(instance.worldBounds);
+
+    AABB sceneBounds;
+    for (const AABB& box : bounds)
+        sceneBounds.expand(box);
+
+    unsigned int threads = max(1u, thread::hardware_concurrency());
+    Bvh bvh;
+    double buildSingleTime = measure([&]() { bvh.build(bounds, 1); });
+    double buildParallelTime = measure([&]() { bvh.build(bounds, threads); });
+    double refitTime = measure([&]() { bvh.refit(bounds); });
+
+    // Cameras at random points of the scene looking in random directions
+    mt19937 generator(42);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto randomPoint = [&]()
+    {
+        return sceneBounds.min + glm::vec3(unit(generator), unit(generator), unit(generator)) * (sceneBounds.max - sceneBounds.min);
+    };
+    auto randomDirection = [&]()
+    {
+        return glm::normalize(glm::vec3(unit(generator), unit(generator), unit(generator)) * 2.0f - glm::vec3(1.0f));
+    };
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, glm::length(sceneBounds.max - sceneBounds.min) * 0.25f);
+    vector<Frustum> frustums;
+    for (int i = 0; i < QUERIES_NUMBER; ++i)
+    {
+        glm::vec3 eye = randomPoint();
+        frustums.push_back(Frustum::fromMatrix(projection * glm::lookAt(eye, eye + randomDirection(), glm::vec3(0.0f, 1.0f, 0.0f))));
+    }
+
+    vector<uint32_t> visible;
+    size_t bruteForceVisible = 0;
+    double bruteForceTime = measure([&]()
+    {
+        bruteForceVisible = 0;
+        for (const Frustum& frustum : frustums)
+        {
+            for (const AABB& box : bounds)
+                bruteForceVisible += frustum.intersects(box);
+        }
+    }, 1);
+
+    size_t bvhVisible = 0;
+    double frustumTime = measure([&]()
+    {
+        bvhVisible = 0;
+        for (const Frustum& frustum : frustums)
+        {
+            visible.clear();
+            bvh.queryFrustum(frustum, [&visible](uint32_t instance) { visible.push_back(instance); });
+            bvhVisible += visible.size();
+        }
+    }, 1);
+
+    // Rays are tested against triangles of meshes
+    Model* loadedModel = scene.getModel(model);
+    double triangleBvhTime = measure([&]()
+    {
+        for (Mesh& mesh : loadedModel->meshes)
+            mesh.buildTriangleBvh();
+    }, 1);
+
+    vector<glm::vec3> origins, directions;
+    for (int i = 0; i < RAYS_NUMBER; ++i)
+    {
+        origins.push_back(randomPoint());
+        directions.push_back(randomDirection());
+    }
+
+    int hits = 0;
+    double rayTime = measure([&]()
+    {
+        hits = 0;
+        for (int i = 0; i < RAYS_NUMBER; ++i)
+        {
+            float distance = numeric_limits<float>::max();
+            hits += scene.raycast(origins[i], directions[i], distance) >= 0;
+        }
+    }, 1);
+
+    cout << "Model: " << path << ", mesh instances: " << bounds.size() << ", nodes: " << bvh.getNodeCount() << endl;
+    cout << "Build (1 thread): " << buildSingleTime << " ms" << endl;
+    cout << "Build (" << threads << " threads): " << buildParallelTime << " ms" << endl;
+    cout << "Refit: " << refitTime << " ms" << endl;
+    cout << QUERIES_NUMBER << " frustum queries, brute force: " << bruteForceTime << " ms (" << bruteForceVisible << " visible)" << endl;
+    cout << QUERIES_NUMBER << " frustum queries, BVH: " << frustumTime << " ms (" << bvhVisible << " visible)" << endl;
+    cout << "Triangle BVH build for all meshes: " << triangleBvhTime << " ms" << endl;
+    cout << RAYS_NUMBER << " rays: " << rayTime << " ms (" << hits << " hits)" << endl;
+
+    Mesh::getGeometryArena().release();
+    glfwTerminate();
+    return 0;
+}
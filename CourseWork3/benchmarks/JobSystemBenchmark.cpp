@@ -0,0 +1,123 @@
+// Scaling benchmark of CPU frame preparation on job system: transform composition of all objects,
+// BVH refit, culling of camera and light views and sort key generation for every view.
+// Scene has 10k objects moving every frame, frame is prepared with 1 to N threads.
+//
+// Build example (from CourseWork3 directory):
+//     g++ -O2 -mavx2 -std=c++17 -Iinclude benchmarks/JobSystemBenchmark.cpp src/Core/JobSystem.cpp
+//         src/Scene/TransformStore.cpp src/Geometry/Bvh.cpp src/Render/RenderQueue.cpp -pthread
+
+#include <Core/JobSystem.h>
+#include <Geometry/Bvh.h>
+#include <Geometry/Frustum.h>
+#include <Render/RenderQueue.h>
+#include <Scene/TransformStore.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int OBJECTS_NUMBER = 10000;
+const int LIGHTS_NUMBER = 16;
+const int FRAMES = 100;
+const float LIGHT_RANGE = 20.0f;
+
+struct View
+{
+    vector<uint32_t> visible;
+    RenderQueue queue;
+};
+
+int main()
+{
+    mt19937 generator(42);
+    uniform_real_distribution<float> position(-100.0f, 100.0f);
+    uniform_real_distribution<float> angle(0.0f, 360.0f);
+
+    TransformStore transforms;
+    AABB localBounds(glm::vec3(-1.0f), glm::vec3(1.0f));
+    for (int i = 0; i < OBJECTS_NUMBER; ++i)
+    {
+        glm::vec3 p(position(generator), position(generator), position(generator));
+        glm::vec3 r(angle(generator), angle(generator), angle(generator));
+        transforms.add(p, r, glm::vec3(1.0f), localBounds);
+    }
+
+    vector<glm::vec3> lights;
+    for (int i = 0; i < LIGHTS_NUMBER; ++i)
+        lights.emplace_back(position(generator), position(generator), position(generator));
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::vec3 eye(0.0f, 0.0f, 150.0f);
+    Frustum frustum = Frustum::fromMatrix(projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    vector<AABB> bounds(OBJECTS_NUMBER);
+    vector<View> views(LIGHTS_NUMBER + 1);
+    Bvh bvh;
+
+    unsigned int maxThreads = max(1u, thread::hardware_concurrency());
+    double singleThreadTime = 0.0;
+    cout << "Objects: " << OBJECTS_NUMBER << ", views: " << views.size() << endl;
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem jobs(threads);
+
+        auto start = chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            // Move every object a bit, so that all transforms are recomposed
+            for (int i = 0; i < OBJECTS_NUMBER; ++i)
+                transforms.setRotation(i, glm::vec3(frame * 0.5f, i % 360, 0.0f));
+            transforms.update(&jobs);
+
+            jobs.parallelFor(0, bounds.size(), 1024, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                    bounds[i] = transforms.getWorldBounds(static_cast<TransformStore::Index>(i));
+            });
+            if (bvh.isEmpty())
+                bvh.build(bounds, threads);
+            else
+                bvh.refit(bounds);
+
+            // Every view is culled and sorted by its own job
+            JobCounter viewsDone;
+            for (size_t v = 0; v < views.size(); ++v)
+            {
+                jobs.run([&, v]()
+                {
+                    View& view = views[v];
+                    glm::vec3 viewPosition = v == 0 ? eye : lights[v - 1];
+                    view.visible.clear();
+                    auto collect = [&view](uint32_t primitive) { view.visible.push_back(primitive); };
+                    if (v == 0)
+                        bvh.queryFrustum(frustum, collect);
+                    else
+                        bvh.querySphere(viewPosition, LIGHT_RANGE, collect);
+
+                    view.queue.clear();
+                    for (uint32_t object : view.visible)
+                    {
+                        float depth = glm::length(bounds[object].getCenter() - viewPosition);
+                        view.queue.push(RenderQueue::makeKey(RenderQueue::Layer::Opaque, 0, object % 64, object % 16, depth), object);
+                    }
+                    view.queue.sort();
+                }, &viewsDone);
+            }
+            jobs.wait(viewsDone);
+        }
+        auto end = chrono::high_resolution_clock::now();
+
+        double frameTime = chrono::duration<double, milli>(end - start).count() / FRAMES;
+        if (threads == 1)
+            singleThreadTime = frameTime;
+        cout << "Threads: " << threads << ", frame preparation: " << frameTime << " ms"
+             << ", speedup: " << singleThreadTime / frameTime << "x" << endl;
+    }
+    return 0;
+}
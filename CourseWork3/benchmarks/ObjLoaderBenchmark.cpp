@@ -0,0 +1,115 @@
+// Benchmark of OBJ import: ASSIMP (as Model imports files) against ObjLoader on one and on all
+// hardware threads. Only parsing into de-indexed meshes is measured, mesh optimization and
+// GL upload are the same for both. Outputs are compared mesh by mesh: vertex and index counts
+// and all vertex attributes.
+//
+// Build example (from CourseWork3 directory):
+//     g++ -O2 -std=c++17 -Iinclude benchmarks/ObjLoaderBenchmark.cpp src/Objects/ObjLoader.cpp
+//         src/Core/MappedFile.cpp src/Core/JobSystem.cpp -lassimp -pthread
+// Usage:
+//     ObjLoaderBenchmark [path to model]
+
+#include <Core/JobSystem.h>
+#include <Objects/ObjLoader.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int ITERATIONS = 5;
+
+template <typename Function>
+double measure(Function function, int iterations = ITERATIONS)
+{
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        function();
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / iterations;
+}
+
+// Number of ObjLoader meshes which differ from meshes imported by ASSIMP
+size_t countMismatches(const aiScene& scene, const ObjModel& model)
+{
+    auto equal = [](float a, float b) { return std::abs(a - b) <= 1e-6f * std::max(1.0f, std::abs(a)); };
+
+    size_t mismatches = scene.mNumMeshes > model.meshes.size() ? scene.mNumMeshes - model.meshes.size() : model.meshes.size() - scene.mNumMeshes;
+    for (size_t i = 0; i < std::min<size_t>(scene.mNumMeshes, model.meshes.size()); ++i)
+    {
+        const aiMesh& imported = *scene.mMeshes[i];
+        const ObjMesh& parsed = model.meshes[i];
+        bool same = imported.mNumVertices == parsed.vertices.size() && imported.mNumFaces * 3 == parsed.indices.size();
+        for (unsigned int v = 0; same && v < imported.mNumVertices; ++v)
+        {
+            const Vertex& vertex = parsed.vertices[v];
+            same = equal(imported.mVertices[v].x, vertex.Position.x) && equal(imported.mVertices[v].y, vertex.Position.y)
+                && equal(imported.mVertices[v].z, vertex.Position.z);
+            if (same && imported.HasNormals())
+                same = equal(imported.mNormals[v].x, vertex.Normal.x) && equal(imported.mNormals[v].y, vertex.Normal.y)
+                    && equal(imported.mNormals[v].z, vertex.Normal.z);
+            if (same && imported.HasTextureCoords(0))
+                same = equal(imported.mTextureCoords[0][v].x, vertex.TexCoords.x) && equal(imported.mTextureCoords[0][v].y, vertex.TexCoords.y);
+        }
+        for (unsigned int f = 0; same && f < imported.mNumFaces; ++f)
+        {
+            const aiFace& face = imported.mFaces[f];
+            same = face.mNumIndices == 3 && face.mIndices[0] == parsed.indices[3 * f]
+                && face.mIndices[1] == parsed.indices[3 * f + 1] && face.mIndices[2] == parsed.indices[3 * f + 2];
+        }
+        if (!same)
+        {
+            cout << "Mesh " << i << " (" << parsed.name << ") differs: vertices " << imported.mNumVertices << " / " << parsed.vertices.size()
+                 << ", indices " << imported.mNumFaces * 3 << " / " << parsed.indices.size() << endl;
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    string path = argc > 1 ? argv[1] : "data/models/sponza_pbr/sponza.obj";
+
+    // Importer keeps the last scene (reading a file frees the previous one), so it is compared after measurement
+    Assimp::Importer importer;
+    const aiScene* scene = nullptr;
+    double assimpTime = measure([&]() { scene = importer.ReadFile(path, aiProcess_Triangulate); });
+    if (!scene || !scene->mRootNode)
+    {
+        cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        return -1;
+    }
+
+    ObjModel model;
+    bool loaded = true;
+    double singleTime = measure([&]() { loaded = loaded && loadObj(path, model); });
+
+    unsigned int threads = max(1u, thread::hardware_concurrency());
+    JobSystem jobs(threads);
+    double parallelTime = measure([&]() { loaded = loaded && loadObj(path, model, &jobs); });
+    if (!loaded)
+        return -1;
+
+    size_t vertices = 0, triangles = 0;
+    for (const ObjMesh& mesh : model.meshes)
+    {
+        vertices += mesh.vertices.size();
+        triangles += mesh.indices.size() / 3;
+    }
+
+    cout << "Model: " << path << ", meshes: " << model.meshes.size() << ", vertices: " << vertices << ", triangles: " << triangles << endl;
+    cout << "ASSIMP: " << assimpTime << " ms" << endl;
+    cout << "ObjLoader (1 thread): " << singleTime << " ms" << endl;
+    cout << "ObjLoader (" << threads << " threads): " << parallelTime << " ms" << endl;
+    cout << "Meshes different from ASSIMP: " << countMismatches(*scene, model) << endl;
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Cooks textures offline and measures what cooking saves: time of decoding the source image
+// (as every run without cache does) against opening the cooked cache, video memory of the
+// uncompressed mip chain against the compressed one, and quality of compressed level 0 as PSNR
+// against the source image. Caches are written next to images, where TextureStreamer finds them.
+// Color is cooked for GPUs with S3TC, others cook color again uncompressed at run time.
+//
+// Build example (from CourseWork3 directory):
+//     g++ -O2 -std=c++17 -Iinclude benchmarks/TextureCookerBenchmark.cpp src/Render/TextureCache.cpp
+//         src/Render/BlockCompression.cpp src/Core/MappedFile.cpp src/glad.c -ldl
+// Usage:
+//     TextureCookerBenchmark color|normal|mask [image paths]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <Render/BlockCompression.h>
+#include <Render/TextureCache.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const int ITERATIONS = 5;
+
+template <typename Function>
+double measure(Function function, int iterations = ITERATIONS)
+{
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        function();
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / iterations;
+}
+
+// Decoders follow GL_EXT_texture_compression_s3tc and RGTC, texels are written row by row
+void decodeBC4(const uint8_t* block, uint8_t* values, size_t stride)
+{
+    int palette[8] = { block[0], block[1] };
+    for (int i = 2; i < 8; ++i)
+        palette[i] = palette[0] > palette[1] ? ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7
+            : i < 6 ? ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5 : i == 6 ? 0 : 255;
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+        bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i)
+        values[i * stride] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7]);
+}
+
+void decodeBC1(const uint8_t* block, uint8_t* rgba)
+{
+    uint16_t color0 = static_cast<uint16_t>(block[0] | block[1] << 8);
+    uint16_t color1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+    int palette[4][4];
+    for (int i = 0; i < 2; ++i)
+    {
+        uint16_t packed = i == 0 ? color0 : color1;
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        palette[i][0] = (r << 3) | (r >> 2);
+        palette[i][1] = (g << 2) | (g >> 4);
+        palette[i][2] = (b << 3) | (b >> 2);
+        palette[i][3] = 255;
+    }
+    for (int c = 0; c < 4; ++c)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    uint32_t bits = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+            rgba[4 * i + c] = static_cast<uint8_t>(palette[(bits >> (2 * i)) & 3][c]);
+    }
+}
+
+// Decodes level 0 to RGBA, missing channels are 0 (alpha 255)
+vector<uint8_t> decodeLevel(bc::Format format, const uint8_t* data, int width, int height)
+{
+    vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+    uint8_t texels[16 * 4];
+    for (int blockY = 0; blockY < height; blockY += 4)
+    {
+        for (int blockX = 0; blockX < width; blockX += 4)
+        {
+            fill(begin(texels), end(texels), 0);
+            for (int i = 0; i < 16; ++i)
+                texels[4 * i + 3] = 255;
+            switch (format)
+            {
+            case bc::Format::BC1: decodeBC1(data, texels); break;
+            case bc::Format::BC3:
+                decodeBC1(data + 8, texels);
+                decodeBC4(data, texels + 3, 4);
+                break;
+            case bc::Format::BC4: decodeBC4(data, texels, 4); break;
+            case bc::Format::BC5:
+                decodeBC4(data, texels, 4);
+                decodeBC4(data + 8, texels + 1, 4);
+                break;
+            }
+            data += bc::getBlockSize(format);
+
+            for (int y = 0; y < 4 && blockY + y < height; ++y)
+            {
+                for (int x = 0; x < 4 && blockX + x < width; ++x)
+                    memcpy(&image[(static_cast<size_t>(blockY + y) * width + blockX + x) * 4], &texels[4 * (4 * y + x)], 4);
+            }
+        }
+    }
+    return image;
+}
+
+bc::Format formatOf(GLenum format)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return bc::Format::BC3;
+    case GL_COMPRESSED_RED_RGTC1: return bc::Format::BC4;
+    case GL_COMPRESSED_RG_RGTC2: return bc::Format::BC5;
+    default: return bc::Format::BC1;
+    }
+}
+
+// PSNR over channels usage keeps, source channels are mapped as TextureCache does
+double measurePsnr(const uint8_t* source, int components, const vector<uint8_t>& decoded, TextureUsage usage, bool alpha)
+{
+    int channels = usage == TextureUsage::Color ? (alpha ? 4 : 3) : usage == TextureUsage::Normal ? 2 : 1;
+    size_t count = decoded.size() / 4;
+    double error = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t* texel = source + i * components;
+        for (int c = 0; c < channels; ++c)
+        {
+            int expected;
+            if (c == 3)
+                expected = components == 4 ? texel[3] : components == 2 ? texel[1] : 255;
+            else if (c == 1 && usage == TextureUsage::Normal)
+                expected = components >= 2 ? texel[1] : texel[0];
+            else
+                expected = components >= 3 ? texel[c] : texel[0];
+            double difference = static_cast<double>(expected) - decoded[4 * i + c];
+            error += difference * difference;
+        }
+    }
+    double mse = error / (static_cast<double>(count) * channels);
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cout << "Usage: TextureCookerBenchmark color|normal|mask [image paths]" << endl;
+        return -1;
+    }
+    string usageName = argv[1];
+    TextureUsage usage = usageName == "normal" ? TextureUsage::Normal : usageName == "mask" ? TextureUsage::Mask : TextureUsage::Color;
+
+    size_t rawTotal = 0, cookedTotal = 0;
+    double decodeTotal = 0.0, openTotal = 0.0;
+    for (int i = 2; i < argc; ++i)
+    {
+        string path = argv[i];
+        int width = 0, height = 0, components = 0;
+        unsigned char* image = nullptr;
+        double decodeTime = measure([&]()
+        {
+            stbi_image_free(image);
+            image = stbi_load(path.c_str(), &width, &height, &components, 0);
+        });
+        if (!image)
+        {
+            cout << "ERROR::TEXTURE_COOKER::FAILED_TO_LOAD " << path << endl;
+            continue;
+        }
+
+        CookedTexture cooked;
+        auto start = chrono::high_resolution_clock::now();
+        bool written = TextureCache::cook(path, usage, true, cooked) && TextureCache::write(path, usage, true, cooked);
+        double cookTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        if (!written)
+        {
+            stbi_image_free(image);
+            continue;
+        }
+
+        // Opening maps the file, every byte is read as upload would read it
+        uint64_t checksum = 0;
+        bool opened = true;
+        double openTime = measure([&]()
+        {
+            TextureCache cache;
+            opened = opened && cache.open(path, usage, true);
+            if (!opened)
+                return;
+            vector<CookedLevel> levels = cache.getLevels();
+            const unsigned char* data = cache.getData();
+            for (size_t byte = 0; byte < levels.back().offset + levels.back().size; byte += 64)
+                checksum += data[byte];
+        });
+        if (!opened)
+        {
+            cout << "ERROR::TEXTURE_COOKER::FAILED_TO_OPEN " << TextureCache::getCachePath(path, usage) << endl;
+            stbi_image_free(image);
+            continue;
+        }
+
+        // Uncompressed chain as streamed without cooking: RGB takes RGBA in video memory
+        size_t raw = 0;
+        for (const CookedLevel& level : cooked.levels)
+            raw += static_cast<size_t>(level.width) * level.height * (components == 3 ? 4 : components);
+        bc::Format format = formatOf(cooked.format);
+        vector<uint8_t> decoded = decodeLevel(format, cooked.data.data(), width, height);
+        double psnr = measurePsnr(image, components, decoded, usage, format == bc::Format::BC3);
+        stbi_image_free(image);
+
+        cout << path << " (" << width << "x" << height << ", " << components << " components, " << cooked.levels.size() << " levels)" << endl;
+        cout << "    decode: " << decodeTime << " ms, cook and write: " << cookTime << " ms, cached open: " << openTime << " ms"
+             << " (checksum " << checksum % 256 << ")" << endl;
+        cout << "    video memory: " << raw / 1024 << " KB uncompressed, " << cooked.data.size() / 1024 << " KB compressed, PSNR of level 0: "
+             << psnr << " dB" << endl;
+        rawTotal += raw;
+        cookedTotal += cooked.data.size();
+        decodeTotal += decodeTime;
+        openTotal += openTime;
+    }
+
+    cout << "Total video memory: " << rawTotal / 1024 << " KB uncompressed, " << cookedTotal / 1024 << " KB compressed" << endl;
+    cout << "Total load time: " << decodeTotal << " ms decoding, " << openTotal << " ms from cache" << endl;
+    return 0;
+}
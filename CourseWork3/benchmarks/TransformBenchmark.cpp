@@ -0,0 +1,104 @@
+// Microbenchmark of transform composition: Object::getModelMatrix (with normal matrix computed
+// through glm::inverse, as in render loop) against batched SIMD update of TransformStore.
+//
+// Build example (from CourseWork3 directory):
+//     g++ -O2 -mavx2 -std=c++17 -Iinclude benchmarks/TransformBenchmark.cpp src/Scene/TransformStore.cpp src/Objects/Object.cpp
+//         src/Core/JobSystem.cpp -pthread
+
+#include <Objects/Object.h>
+#include <Scene/TransformStore.h>
+#include <Core/Simd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const int OBJECTS_NUMBER = 10000;
+const int ITERATIONS = 200;
+// Every that many objects batch results are compared with Object ones
+const int CHECK_STRIDE = 97;
+const float EPSILON = 1e-4f;
+
+// Elements are compared relatively to the largest one, so big scales don't need bigger epsilon
+template <int Size, typename Matrix>
+bool isClose(const Matrix& a, const Matrix& b)
+{
+    float largest = 1.0f;
+    for (int column = 0; column < Size; ++column)
+        for (int row = 0; row < Size; ++row)
+            largest = std::max(largest, std::abs(a[column][row]));
+    for (int column = 0; column < Size; ++column)
+        for (int row = 0; row < Size; ++row)
+            if (std::abs(a[column][row] - b[column][row]) > EPSILON * largest)
+                return false;
+    return true;
+}
+
+template <typename Function>
+double measure(Function function)
+{
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i)
+        function();
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / ITERATIONS;
+}
+
+int main()
+{
+    mt19937 generator(42);
+    uniform_real_distribution<float> position(-100.0f, 100.0f);
+    uniform_real_distribution<float> angle(0.0f, 360.0f);
+    uniform_real_distribution<float> scale(0.1f, 2.0f);
+
+    vector<Object> objects;
+    TransformStore transforms;
+    AABB localBounds(glm::vec3(-1.0f), glm::vec3(1.0f));
+    for (int i = 0; i < OBJECTS_NUMBER; ++i)
+    {
+        glm::vec3 p(position(generator), position(generator), position(generator));
+        glm::vec3 r(angle(generator), angle(generator), angle(generator));
+        glm::vec3 s(scale(generator), scale(generator), scale(generator));
+        objects.emplace_back(p, r, s, ModelHandle());
+        transforms.add(p, r, s, localBounds);
+    }
+
+    vector<glm::mat4> modelMatrices(objects.size());
+    vector<glm::mat3> normalMatrices(objects.size());
+    double objectTime = measure([&]()
+    {
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            modelMatrices[i] = objects[i].getModelMatrix();
+            normalMatrices[i] = glm::mat3(glm::transpose(glm::inverse(modelMatrices[i])));
+        }
+    });
+
+    double storeTime = measure([&]()
+    {
+        // Mark store as changed, so update() recomposes every transform
+        transforms.setPosition(0, transforms.getPosition(0));
+        transforms.update();
+    });
+
+    // Speedup means nothing if batch composition gives different matrices
+    int mismatches = 0;
+    for (int i = 0; i < OBJECTS_NUMBER; i += CHECK_STRIDE)
+    {
+        TransformStore::Index index = static_cast<TransformStore::Index>(i);
+        if (!isClose<4>(transforms.getWorldMatrix(index), modelMatrices[i]) || !isClose<3>(transforms.getNormalMatrix(index), normalMatrices[i]))
+            ++mismatches;
+    }
+
+    cout << "Objects: " << OBJECTS_NUMBER << ", SIMD width: " << simd::FloatN::width << endl;
+    cout << "Object::getModelMatrix + inverse: " << objectTime << " ms" << endl;
+    cout << "TransformStore::update (with AABB): " << storeTime << " ms" << endl;
+    cout << "Speedup: " << objectTime / storeTime << "x" << endl;
+    cout << "Checked objects different from Object::getModelMatrix: " << mismatches << endl;
+    return mismatches == 0 ? 0 : -1;
+}
@@ -1,14 +1,24 @@
+#ifndef ALIASES_H
+#define ALIASES_H
+
 #include <Lights/PointLight.h>
 #include <Lights/SpotLight.h>
 #include <Lights/DirectionalLight.h>
 #include <Objects/Model.h>
 #include <Objects/Object.h>
+#include <Core/Pool.h>
 
 #include <vector>
 #include <memory>
 
-using DirectionalLights = vector<DirectionalLight>;
-using PointLights = vector<PointLight>;
-using SpotLights = vector<SpotLight>;
-using Objects = vector<Object>;
-using Models = vector<std::shared_ptr<Model>>;
\ No newline at end of file
+using DirectionalLights = Pool<DirectionalLight>;
+using PointLights = Pool<PointLight>;
+using SpotLights = Pool<SpotLight>;
+using Objects = Pool<Object>;
+using Models = Pool<Model>;
+
+using DirectionalLightHandle = DirectionalLights::HandleType;
+using PointLightHandle = PointLights::HandleType;
+using SpotLightHandle = SpotLights::HandleType;
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include <vector>
+
+// Allocator which returns memory aligned to Alignment bytes, so that arrays can be
+// accessed with aligned SIMD loads and stores.
+template <typename T, std::size_t Alignment = 32>
+class AlignedAllocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t count)
+    {
+        // aligned_alloc requires size to be a multiple of alignment, MSVC has no aligned_alloc
+        std::size_t size = (count * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+#ifdef _WIN32
+        void* memory = _aligned_malloc(size, Alignment);
+#else
+        void* memory = std::aligned_alloc(Alignment, size);
+#endif
+        if (!memory)
+            throw std::bad_alloc();
+        return static_cast<T*>(memory);
+    }
+
+    void deallocate(T* pointer, std::size_t)
+    {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T, std::size_t Alignment = 32>
+using AlignedVector = std::vector<T, AlignedAllocator<T, Alignment>>;
+
+#endif
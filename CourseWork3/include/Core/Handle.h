@@ -0,0 +1,23 @@
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include <cstdint>
+#include <limits>
+
+// Generational handle to an element of Pool. Slot index is reused after removal,
+// generation is incremented each time, so stale handles can be detected.
+template <typename T>
+struct Handle
+{
+    static const std::uint32_t INVALID_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t index = INVALID_INDEX;
+    std::uint32_t generation = 0;
+
+    bool isNull() const { return index == INVALID_INDEX; }
+
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Number of unfinished jobs of a group. Jobs can be made dependent on a counter,
+// they are started when it reaches zero.
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        std::function<void()> job;
+        JobCounter* counter;
+    };
+
+    std::atomic<int> m_pending{ 0 };
+    std::mutex m_mutex;
+    std::vector<Continuation> m_continuations;
+};
+
+// Pool of worker threads with work stealing.
+// Every worker owns a deque: it pushes and pops jobs at the back (so recently spawned,
+// cache-warm jobs run first) while idle workers steal from the front of other deques.
+// The thread which created the system counts as worker 0 and executes jobs while it waits.
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    // threads is the total number of threads including the calling one, 0 uses all hardware threads
+    explicit JobSystem(unsigned int threads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    // Schedules job. Counter (if given) is incremented now and decremented when job finishes.
+    // If dependency is given, job is started only after dependency counter reaches zero.
+    void run(Job job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // Executes pending jobs until counter reaches zero
+    void wait(JobCounter& counter);
+
+    // Calls function(begin, end) for chunks of [begin, end) of at most grain elements in parallel
+    // and returns when all of them are done
+    template <typename Function>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Function&& function);
+
+private:
+    struct Task
+    {
+        Job job;
+        JobCounter* counter;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool pop(Task& task);
+    void execute(Task& task);
+    void workerLoop(unsigned int index);
+    unsigned int currentWorker() const;
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<int> m_queued{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+};
+
+template <typename Function>
+void JobSystem::parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Function&& function)
+{
+    if (begin >= end)
+        return;
+
+    grain = std::max<std::size_t>(grain, 1);
+    if (end - begin <= grain || m_workers.size() == 1)
+    {
+        function(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    for (std::size_t first = begin; first < end; first += grain)
+    {
+        std::size_t last = std::min(first + grain, end);
+        run([&function, first, last]() { function(first, last); }, &counter);
+    }
+    wait(counter);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are read by the OS on first access,
+// so data can be copied (or uploaded to GL) from the file without an intermediate buffer.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps file, returns false if it can't be opened (previous mapping is closed anyway)
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const unsigned char* getData() const { return m_data; }
+    std::size_t getSize() const { return m_size; }
+
+    // FNV-1a of file content, identifies it across paths. 0 if no file is mapped.
+    std::uint64_t hash() const;
+
+private:
+    const unsigned char* m_data = nullptr;
+    std::size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <Core/Handle.h>
+#include <Core/Span.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Dense storage of elements addressed by generational handles.
+// Elements are always packed in one array, so iteration doesn't jump over holes.
+// Removal moves the last element into the freed place (swap and pop), therefore dense
+// indices of elements may change, while handles stay valid until element is removed.
+template <typename T, typename Tag = T>
+class Pool
+{
+public:
+    using HandleType = Handle<Tag>;
+    using size_type = std::size_t;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    HandleType add(T value)
+    {
+        std::uint32_t slot;
+        if (!m_freeSlots.empty())
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(m_slots.size());
+            m_slots.push_back(Slot());
+        }
+
+        m_slots[slot].dense = static_cast<std::uint32_t>(m_items.size());
+        m_items.push_back(std::move(value));
+        m_denseToSlot.push_back(slot);
+
+        HandleType handle;
+        handle.index = slot;
+        handle.generation = m_slots[slot].generation;
+        return handle;
+    }
+
+    // Returns false if handle is stale
+    bool remove(HandleType handle)
+    {
+        if (!isValid(handle))
+            return false;
+
+        std::uint32_t dense = m_slots[handle.index].dense;
+        std::uint32_t last = static_cast<std::uint32_t>(m_items.size() - 1);
+        if (dense != last)
+        {
+            m_items[dense] = std::move(m_items[last]);
+            m_denseToSlot[dense] = m_denseToSlot[last];
+            m_slots[m_denseToSlot[dense]].dense = dense;
+        }
+        m_items.pop_back();
+        m_denseToSlot.pop_back();
+
+        ++m_slots[handle.index].generation;
+        m_slots[handle.index].dense = HandleType::INVALID_INDEX;
+        m_freeSlots.push_back(handle.index);
+        return true;
+    }
+
+    void clear()
+    {
+        for (std::uint32_t slot : m_denseToSlot)
+        {
+            ++m_slots[slot].generation;
+            m_slots[slot].dense = HandleType::INVALID_INDEX;
+            m_freeSlots.push_back(slot);
+        }
+        m_items.clear();
+        m_denseToSlot.clear();
+    }
+
+    bool isValid(HandleType handle) const
+    {
+        return handle.index < m_slots.size() &&
+               m_slots[handle.index].generation == handle.generation &&
+               m_slots[handle.index].dense != HandleType::INVALID_INDEX;
+    }
+
+    T* get(HandleType handle) { return isValid(handle) ? &m_items[m_slots[handle.index].dense] : nullptr; }
+    const T* get(HandleType handle) const { return isValid(handle) ? &m_items[m_slots[handle.index].dense] : nullptr; }
+
+    // Dense index of element, valid until next removal
+    std::size_t indexOf(HandleType handle) const { return m_slots[handle.index].dense; }
+
+    HandleType getHandle(std::size_t index) const
+    {
+        HandleType handle;
+        handle.index = m_denseToSlot[index];
+        handle.generation = m_slots[handle.index].generation;
+        return handle;
+    }
+
+    T& operator[](std::size_t index) { return m_items[index]; }
+    const T& operator[](std::size_t index) const { return m_items[index]; }
+
+    std::size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+
+    iterator begin() { return m_items.begin(); }
+    iterator end() { return m_items.end(); }
+    const_iterator begin() const { return m_items.begin(); }
+    const_iterator end() const { return m_items.end(); }
+
+    Span<T> span() { return Span<T>(m_items.data(), m_items.size()); }
+    Span<const T> span() const { return Span<const T>(m_items.data(), m_items.size()); }
+
+private:
+    struct Slot
+    {
+        std::uint32_t dense = HandleType::INVALID_INDEX;
+        std::uint32_t generation = 0;
+    };
+
+    std::vector<T> m_items;
+    std::vector<std::uint32_t> m_denseToSlot;
+    std::vector<Slot> m_slots;
+    std::vector<std::uint32_t> m_freeSlots;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+
+// Sub-allocator of ranges [offset, offset + size) inside a linear space of given capacity
+// (e.g. elements of a GPU buffer). Only bookkeeping is done here, memory itself is owned by user.
+// Free ranges are kept sorted by offset and by size: allocation takes the smallest range which
+// fits (best fit), freed ranges are merged with free neighbours, so space doesn't fragment
+// after a model is unloaded and another one of similar size is loaded.
+class RangeAllocator
+{
+public:
+    static const std::size_t INVALID = static_cast<std::size_t>(-1);
+
+    explicit RangeAllocator(std::size_t capacity = 0);
+
+    // Returns offset of allocated range or INVALID if there is no free range large enough
+    std::size_t allocate(std::size_t size);
+
+    // Returns range to free space, range must have been returned by allocate()
+    void free(std::size_t offset, std::size_t size);
+
+    // Extends space, new part is appended to free range at the end
+    void grow(std::size_t capacity);
+
+    void clear();
+
+    std::size_t getCapacity() const { return m_capacity; }
+    std::size_t getUsed() const { return m_used; }
+    std::size_t getLargestFreeRange() const;
+    std::size_t getFreeRangeCount() const { return m_byOffset.size(); }
+
+private:
+    void insertFree(std::size_t offset, std::size_t size);
+    void eraseFree(std::map<std::size_t, std::size_t>::iterator range);
+
+private:
+    std::size_t m_capacity = 0;
+    std::size_t m_used = 0;
+    std::map<std::size_t, std::size_t> m_byOffset;      // offset -> size
+    std::multimap<std::size_t, std::size_t> m_bySize;   // size -> offset
+};
+
+#endif
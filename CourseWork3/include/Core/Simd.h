@@ -0,0 +1,156 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SIMD_HAS_SSE2 1
+#endif
+
+#include <cmath>
+#include <algorithm>
+
+// Thin wrapper over the widest float vector available at compile time.
+// AVX2 builds process 8 lanes, SSE2 builds 4 lanes, everything else falls back to scalar code.
+namespace simd
+{
+
+#if defined(__AVX2__)
+
+struct FloatN
+{
+    static constexpr int width = 8;
+    __m256 v;
+
+    FloatN() = default;
+    FloatN(__m256 value) : v(value) {}
+    explicit FloatN(float value) : v(_mm256_set1_ps(value)) {}
+
+    static FloatN load(const float* p) { return _mm256_load_ps(p); }
+    static FloatN loadUnaligned(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_store_ps(p, v); }
+};
+
+inline FloatN operator+(FloatN a, FloatN b) { return _mm256_add_ps(a.v, b.v); }
+inline FloatN operator-(FloatN a, FloatN b) { return _mm256_sub_ps(a.v, b.v); }
+inline FloatN operator*(FloatN a, FloatN b) { return _mm256_mul_ps(a.v, b.v); }
+inline FloatN operator/(FloatN a, FloatN b) { return _mm256_div_ps(a.v, b.v); }
+inline FloatN min(FloatN a, FloatN b) { return _mm256_min_ps(a.v, b.v); }
+inline FloatN max(FloatN a, FloatN b) { return _mm256_max_ps(a.v, b.v); }
+inline FloatN abs(FloatN a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct FloatN
+{
+    static constexpr int width = 4;
+    __m128 v;
+
+    FloatN() = default;
+    FloatN(__m128 value) : v(value) {}
+    explicit FloatN(float value) : v(_mm_set1_ps(value)) {}
+
+    static FloatN load(const float* p) { return _mm_load_ps(p); }
+    static FloatN loadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_store_ps(p, v); }
+};
+
+inline FloatN operator+(FloatN a, FloatN b) { return _mm_add_ps(a.v, b.v); }
+inline FloatN operator-(FloatN a, FloatN b) { return _mm_sub_ps(a.v, b.v); }
+inline FloatN operator*(FloatN a, FloatN b) { return _mm_mul_ps(a.v, b.v); }
+inline FloatN operator/(FloatN a, FloatN b) { return _mm_div_ps(a.v, b.v); }
+inline FloatN min(FloatN a, FloatN b) { return _mm_min_ps(a.v, b.v); }
+inline FloatN max(FloatN a, FloatN b) { return _mm_max_ps(a.v, b.v); }
+inline FloatN abs(FloatN a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+#else
+
+struct FloatN
+{
+    static constexpr int width = 1;
+    float v;
+
+    FloatN() = default;
+    explicit FloatN(float value) : v(value) {}
+
+    static FloatN load(const float* p) { return FloatN(*p); }
+    static FloatN loadUnaligned(const float* p) { return FloatN(*p); }
+    void store(float* p) const { *p = v; }
+};
+
+inline FloatN operator+(FloatN a, FloatN b) { return FloatN(a.v + b.v); }
+inline FloatN operator-(FloatN a, FloatN b) { return FloatN(a.v - b.v); }
+inline FloatN operator*(FloatN a, FloatN b) { return FloatN(a.v * b.v); }
+inline FloatN operator/(FloatN a, FloatN b) { return FloatN(a.v / b.v); }
+inline FloatN min(FloatN a, FloatN b) { return FloatN(std::min(a.v, b.v)); }
+inline FloatN max(FloatN a, FloatN b) { return FloatN(std::max(a.v, b.v)); }
+inline FloatN abs(FloatN a) { return FloatN(std::fabs(a.v)); }
+
+#endif
+
+// Fixed 4-wide vector, used where data is naturally grouped by four (e.g. BVH4 nodes)
+#if defined(SIMD_HAS_SSE2)
+
+struct Float4
+{
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 value) : v(value) {}
+    explicit Float4(float value) : v(_mm_set1_ps(value)) {}
+
+    static Float4 load(const float* p) { return _mm_load_ps(p); }
+    void store(float* p) const { _mm_store_ps(p, v); }
+};
+
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+
+// Bit i of result is set if a[i] < b[i]
+inline int lessMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+// Bit i of result is set if a[i] <= b[i]
+inline int lessEqualMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+
+#else
+
+struct Float4
+{
+    float v[4];
+
+    Float4() = default;
+    explicit Float4(float value) : v{ value, value, value, value } {}
+
+    static Float4 load(const float* p) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+    void store(float* p) const { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+};
+
+#define SIMD_FLOAT4_BINARY(name, expression) \
+    inline Float4 name(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = expression; return r; }
+SIMD_FLOAT4_BINARY(operator+, a.v[i] + b.v[i])
+SIMD_FLOAT4_BINARY(operator-, a.v[i] - b.v[i])
+SIMD_FLOAT4_BINARY(operator*, a.v[i] * b.v[i])
+SIMD_FLOAT4_BINARY(min, std::min(a.v[i], b.v[i]))
+SIMD_FLOAT4_BINARY(max, std::max(a.v[i], b.v[i]))
+#undef SIMD_FLOAT4_BINARY
+
+inline int lessMask(Float4 a, Float4 b) { int m = 0; for (int i = 0; i < 4; ++i) m |= (a.v[i] < b.v[i]) << i; return m; }
+inline int lessEqualMask(Float4 a, Float4 b) { int m = 0; for (int i = 0; i < 4; ++i) m |= (a.v[i] <= b.v[i]) << i; return m; }
+
+#endif
+
+// Rounds count up to a multiple of the vector width
+inline std::size_t paddedSize(std::size_t count)
+{
+    return (count + FloatN::width - 1) / FloatN::width * FloatN::width;
+}
+
+} // namespace simd
+
+#endif
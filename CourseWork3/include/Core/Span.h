@@ -0,0 +1,26 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+
+// Non-owning view of contiguous elements
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+    Span(T* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+    T* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T& operator[](std::size_t index) const { return m_data[index]; }
+
+private:
+    T* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis-aligned bounding box. Default constructed box is empty (min > max),
+// so it can be grown with expand() starting from nothing.
+struct AABB
+{
+    glm::vec3 min = glm::vec3( std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    AABB() = default;
+    AABB(glm::vec3 minPoint, glm::vec3 maxPoint) : min(minPoint), max(maxPoint) {}
+
+    bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+
+    glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+
+    void expand(glm::vec3 point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // Returns bounds of this box transformed by affine matrix
+    AABB transformed(const glm::mat4& matrix) const
+    {
+        if (isEmpty())
+            return *this;
+
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+        glm::vec3 extents = getExtents();
+        glm::vec3 worldExtents =
+            glm::abs(glm::vec3(matrix[0])) * extents.x +
+            glm::abs(glm::vec3(matrix[1])) * extents.y +
+            glm::abs(glm::vec3(matrix[2])) * extents.z;
+        return AABB(center - worldExtents, center + worldExtents);
+    }
+};
+
+#endif
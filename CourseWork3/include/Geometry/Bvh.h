@@ -0,0 +1,255 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <Core/Simd.h>
+#include <Geometry/AABB.h>
+#include <Geometry/Frustum.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Bounding volume hierarchy over a set of primitives given by their bounds.
+// Tree is built with binned surface area heuristic (subtrees of big nodes are built on
+// separate threads) and stored as 4-wide nodes, so one SIMD test checks four children at once.
+// Primitives are referenced by their index in the array passed to build().
+class Bvh
+{
+public:
+    // 4-wide node. Child bounds are kept in structure-of-arrays form for SIMD tests.
+    struct alignas(16) Node
+    {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        std::int32_t child[4];  // index of child node or LEAF
+        std::uint32_t first[4]; // first primitive of child subtree in primitive indices
+        std::uint32_t count[4]; // number of primitives in child subtree, 0 for empty slot
+    };
+
+    static const std::int32_t LEAF = -1;
+    static const unsigned int MAX_LEAF_SIZE = 4;
+    static const unsigned int MAX_DEPTH = 64;
+
+    Bvh() = default;
+
+    // Builds hierarchy from scratch, threads = 0 uses all hardware threads
+    void build(const std::vector<AABB>& bounds, unsigned int threads = 0);
+
+    // Updates bounds of primitives which moved without changing tree topology
+    void refit(const std::vector<AABB>& bounds);
+
+    // Refits tree and rebuilds subtrees whose surface area grew too much after refit.
+    // Falls back to full rebuild if primitive count changed or too many nodes are abandoned.
+    void update(const std::vector<AABB>& bounds);
+
+    void clear();
+
+    bool isEmpty() const { return m_nodes.empty(); }
+    std::size_t getNodeCount() const { return m_nodes.size(); }
+    std::size_t getPrimitiveCount() const { return m_primitiveIndices.size(); }
+    const std::vector<Node>& getNodes() const { return m_nodes; }
+
+    // Calls callback(primitive) for every primitive whose bounds intersect frustum
+    template <typename Callback>
+    void queryFrustum(const Frustum& frustum, Callback&& callback) const;
+
+    // Calls callback(primitive) for every primitive whose bounds intersect sphere
+    template <typename Callback>
+    void querySphere(glm::vec3 center, float radius, Callback&& callback) const;
+
+    // Calls callback(primitive) for every primitive whose bounds intersect box
+    template <typename Callback>
+    void queryBox(const AABB& box, Callback&& callback) const;
+
+    // Finds closest hit along ray. intersect(primitive, maxDistance) must return distance to
+    // primitive hit or negative value if ray misses it. Returns index of hit primitive or -1.
+    template <typename Intersect>
+    int raycast(glm::vec3 origin, glm::vec3 direction, float& distance, Intersect&& intersect) const;
+
+private:
+    struct BuildContext;
+
+    std::int32_t buildRange(BuildContext& context, std::uint32_t begin, std::uint32_t end, unsigned int depth);
+    std::uint32_t partition(std::uint32_t begin, std::uint32_t end);
+    AABB rangeBounds(std::uint32_t begin, std::uint32_t end) const;
+    void setChild(Node& node, int slot, const AABB& bounds, std::int32_t child, std::uint32_t first, std::uint32_t count) const;
+    void rebuildDegradedSubtrees();
+
+    // Enters children of node selected by bit mask returned from test(node),
+    // primitives in reached leaves are reported if primitiveTest(bounds) passes
+    template <typename Test, typename PrimitiveTest, typename Callback>
+    void traverse(Test&& test, PrimitiveTest&& primitiveTest, Callback&& callback) const;
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<std::array<float, 4>> m_buildArea; // surface area of node children right after build
+    std::vector<std::uint32_t> m_primitiveIndices;
+    std::vector<AABB> m_primitiveBounds;
+    std::vector<glm::vec3> m_centroids;
+    std::size_t m_nodesAfterBuild = 0;
+    unsigned int m_threads = 0;
+};
+
+template <typename Test, typename PrimitiveTest, typename Callback>
+void Bvh::traverse(Test&& test, PrimitiveTest&& primitiveTest, Callback&& callback) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::int32_t stack[3 * MAX_DEPTH + 1];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const Node& node = m_nodes[stack[--stackSize]];
+        int mask = test(node);
+        for (int i = 0; i < 4; ++i)
+        {
+            if (!(mask & (1 << i)) || node.count[i] == 0)
+                continue;
+
+            if (node.child[i] == LEAF)
+            {
+                for (std::uint32_t p = node.first[i]; p < node.first[i] + node.count[i]; ++p)
+                {
+                    std::uint32_t primitive = m_primitiveIndices[p];
+                    if (primitiveTest(m_primitiveBounds[primitive]))
+                        callback(primitive);
+                }
+            }
+            else
+            {
+                stack[stackSize++] = node.child[i];
+            }
+        }
+    }
+}
+
+template <typename Callback>
+void Bvh::queryFrustum(const Frustum& frustum, Callback&& callback) const
+{
+    traverse([&frustum](const Node& node)
+    {
+        using simd::Float4;
+        int outside = 0;
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            // Farthest corner along plane normal for each of four children
+            Float4 x = Float4::load(plane.x >= 0 ? node.maxX : node.minX);
+            Float4 y = Float4::load(plane.y >= 0 ? node.maxY : node.minY);
+            Float4 z = Float4::load(plane.z >= 0 ? node.maxZ : node.minZ);
+            Float4 distance = x * Float4(plane.x) + y * Float4(plane.y) + z * Float4(plane.z) + Float4(plane.w);
+            outside |= simd::lessMask(distance, Float4(0.0f));
+        }
+        return ~outside & 0xF;
+    }, [&frustum](const AABB& bounds) { return frustum.intersects(bounds); }, callback);
+}
+
+template <typename Callback>
+void Bvh::querySphere(glm::vec3 center, float radius, Callback&& callback) const
+{
+    traverse([center, radius](const Node& node)
+    {
+        using simd::Float4;
+        // Distance from sphere center to closest point of each child box
+        Float4 cx(center.x), cy(center.y), cz(center.z);
+        Float4 dx = cx - simd::max(Float4::load(node.minX), simd::min(cx, Float4::load(node.maxX)));
+        Float4 dy = cy - simd::max(Float4::load(node.minY), simd::min(cy, Float4::load(node.maxY)));
+        Float4 dz = cz - simd::max(Float4::load(node.minZ), simd::min(cz, Float4::load(node.maxZ)));
+        return simd::lessEqualMask(dx * dx + dy * dy + dz * dz, Float4(radius * radius));
+    }, [center, radius](const AABB& bounds)
+    {
+        glm::vec3 offset = center - glm::max(bounds.min, glm::min(center, bounds.max));
+        return glm::dot(offset, offset) <= radius * radius;
+    }, callback);
+}
+
+template <typename Callback>
+void Bvh::queryBox(const AABB& box, Callback&& callback) const
+{
+    traverse([&box](const Node& node)
+    {
+        using simd::Float4;
+        int mask = simd::lessEqualMask(Float4::load(node.minX), Float4(box.max.x))
+                 & simd::lessEqualMask(Float4::load(node.minY), Float4(box.max.y))
+                 & simd::lessEqualMask(Float4::load(node.minZ), Float4(box.max.z))
+                 & simd::lessEqualMask(Float4(box.min.x), Float4::load(node.maxX))
+                 & simd::lessEqualMask(Float4(box.min.y), Float4::load(node.maxY))
+                 & simd::lessEqualMask(Float4(box.min.z), Float4::load(node.maxZ));
+        return mask;
+    }, [&box](const AABB& bounds)
+    {
+        return bounds.min.x <= box.max.x && bounds.min.y <= box.max.y && bounds.min.z <= box.max.z
+            && box.min.x <= bounds.max.x && box.min.y <= bounds.max.y && box.min.z <= bounds.max.z;
+    }, callback);
+}
+
+template <typename Intersect>
+int Bvh::raycast(glm::vec3 origin, glm::vec3 direction, float& distance, Intersect&& intersect) const
+{
+    using simd::Float4;
+    if (m_nodes.empty())
+        return -1;
+
+    const float infinity = std::numeric_limits<float>::max();
+    glm::vec3 inverse(
+        direction.x != 0 ? 1.0f / direction.x : infinity,
+        direction.y != 0 ? 1.0f / direction.y : infinity,
+        direction.z != 0 ? 1.0f / direction.z : infinity
+    );
+    Float4 ox(origin.x), oy(origin.y), oz(origin.z);
+    Float4 ix(inverse.x), iy(inverse.y), iz(inverse.z);
+
+    int hit = -1;
+    std::int32_t stack[3 * MAX_DEPTH + 1];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const Node& node = m_nodes[stack[--stackSize]];
+
+        // Slab test against four children
+        Float4 tx1 = (Float4::load(node.minX) - ox) * ix, tx2 = (Float4::load(node.maxX) - ox) * ix;
+        Float4 ty1 = (Float4::load(node.minY) - oy) * iy, ty2 = (Float4::load(node.maxY) - oy) * iy;
+        Float4 tz1 = (Float4::load(node.minZ) - oz) * iz, tz2 = (Float4::load(node.maxZ) - oz) * iz;
+        Float4 tNear = simd::max(simd::max(simd::min(tx1, tx2), simd::min(ty1, ty2)), simd::max(simd::min(tz1, tz2), Float4(0.0f)));
+        Float4 tFar = simd::min(simd::min(simd::max(tx1, tx2), simd::max(ty1, ty2)), simd::min(simd::max(tz1, tz2), Float4(distance)));
+        int mask = simd::lessEqualMask(tNear, tFar);
+
+        alignas(16) float nearDistance[4];
+        tNear.store(nearDistance);
+
+        // Push farther children first, so that the nearest one is visited next
+        int order[4] = { 0, 1, 2, 3 };
+        std::sort(order, order + 4, [&nearDistance](int a, int b) { return nearDistance[a] > nearDistance[b]; });
+        for (int i : order)
+        {
+            if (!(mask & (1 << i)) || node.count[i] == 0 || nearDistance[i] > distance)
+                continue;
+
+            if (node.child[i] == LEAF)
+            {
+                for (std::uint32_t p = node.first[i]; p < node.first[i] + node.count[i]; ++p)
+                {
+                    float t = intersect(m_primitiveIndices[p], distance);
+                    if (t >= 0 && t < distance)
+                    {
+                        distance = t;
+                        hit = static_cast<int>(m_primitiveIndices[p]);
+                    }
+                }
+            }
+            else
+            {
+                stack[stackSize++] = node.child[i];
+            }
+        }
+    }
+    return hit;
+}
+
+#endif
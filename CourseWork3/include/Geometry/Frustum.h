@@ -0,0 +1,61 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <Geometry/AABB.h>
+
+#include <glm/glm.hpp>
+
+// View frustum as six planes (left, right, bottom, top, near, far) with normals pointing inside.
+// Plane is stored as (normal, distance), point p is inside if dot(normal, p) + distance >= 0.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    // Extracts planes from projection * view matrix (Gribb-Hartmann method)
+    static Frustum fromMatrix(const glm::mat4& viewProjection)
+    {
+        auto row = [&viewProjection](int i)
+        {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+
+        Frustum frustum;
+        frustum.planes[0] = row(3) + row(0);
+        frustum.planes[1] = row(3) - row(0);
+        frustum.planes[2] = row(3) + row(1);
+        frustum.planes[3] = row(3) - row(1);
+        frustum.planes[4] = row(3) + row(2);
+        frustum.planes[5] = row(3) - row(2);
+        for (glm::vec4& plane : frustum.planes)
+            plane = plane / glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    bool intersects(const AABB& box) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            // Take box corner which is the farthest along plane normal
+            glm::vec3 corner(
+                plane.x >= 0 ? box.max.x : box.min.x,
+                plane.y >= 0 ? box.max.y : box.min.y,
+                plane.z >= 0 ? box.max.z : box.min.z
+            );
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool intersects(glm::vec3 center, float radius) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Import-time optimizations of indexed triangle lists. Vertices are treated as opaque blocks of
+// stride bytes, only overdraw ordering reads positions (three floats at the start of vertex).
+// Usual order is: weld, vertex cache, overdraw, vertex fetch.
+namespace mesh
+{
+    // Post-transform cache size assumed by analysis and optimization
+    const unsigned int VERTEX_CACHE_SIZE = 16;
+
+    struct VertexCacheStats
+    {
+        std::size_t misses = 0;     // vertex shader invocations of simulated FIFO cache
+        float acmr = 0.0f;          // average cache miss ratio: misses per triangle (0.5 at best, 3 at worst)
+        float atvr = 0.0f;          // average transformed vertex ratio: misses per used vertex (1 at best)
+    };
+
+    // Cluster of neighbouring triangles, culled on its own
+    struct Meshlet
+    {
+        std::uint32_t firstIndex;   // meshlet triangles are consecutive in mesh indices
+        std::uint32_t indexCount;
+        glm::vec3 center;           // bounding sphere
+        float radius;
+        // All triangles face away from points p where
+        // dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius.
+        // Axis is zero and cutoff is one when triangles face all around.
+        glm::vec3 coneAxis;
+        float coneCutoff;
+    };
+
+    const std::size_t MESHLET_MAX_VERTICES = 64;
+    const std::size_t MESHLET_MAX_TRIANGLES = 124;
+
+    // Simulates FIFO post-transform cache of given size over triangle list
+    VertexCacheStats analyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount,
+        unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+    // Merges vertices with identical bytes through hash table. Vertices are compacted in place
+    // keeping order of first occurrence and indices are rewritten. Returns new vertex count.
+    std::size_t weldVertices(void* vertices, std::size_t vertexCount, std::size_t stride,
+        std::uint32_t* indices, std::size_t indexCount);
+
+    // Reorders triangles for post-transform cache hits (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+    void optimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount);
+
+    // Reorders clusters of cache optimized triangles so that outward facing ones come first and
+    // occlude the rest (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+    // Overdraw"). Clusters are split while their ACMR stays within threshold of the original.
+    void optimizeOverdraw(std::uint32_t* indices, std::size_t indexCount, const void* vertices, std::size_t vertexCount,
+        std::size_t stride, float threshold = 1.05f);
+
+    // Simplifies mesh by edge collapses ordered by quadric error (Garland and Heckbert, "Surface
+    // Simplification Using Quadric Error Metrics") until it has targetIndexCount indices or the next
+    // collapse would move surface farther than targetError. Errors are relative to the largest
+    // extent of mesh bounds. Vertices on open borders and attribute seams stay in place, so
+    // simplified indices keep referencing the original vertices. Writes up to indexCount indices
+    // to destination and returns their number, resultError gets the largest error made.
+    std::size_t simplify(std::uint32_t* destination, const std::uint32_t* indices, std::size_t indexCount,
+        const void* vertices, std::size_t vertexCount, std::size_t stride,
+        std::size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+    // Splits triangles into meshlets in index order: meshlet is closed when the next triangle would
+    // exceed vertex or triangle limit. Triangles should be cache optimized, so that neighbours are close.
+    std::vector<Meshlet> buildMeshlets(const std::uint32_t* indices, std::size_t indexCount,
+        const void* vertices, std::size_t vertexCount, std::size_t stride,
+        std::size_t maxVertices = MESHLET_MAX_VERTICES, std::size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+    // Reorders vertices in order of first use by triangles, so that vertex fetch goes through
+    // memory linearly. Unused vertices are dropped. Returns new vertex count.
+    std::size_t optimizeVertexFetch(void* vertices, std::size_t vertexCount, std::size_t stride,
+        std::uint32_t* indices, std::size_t indexCount);
+}
+
+#endif
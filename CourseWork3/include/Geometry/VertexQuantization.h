@@ -0,0 +1,22 @@
+#ifndef VERTEX_QUANTIZATION_H
+#define VERTEX_QUANTIZATION_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Encoders of compact vertex attributes, GPU decodes them in vertex fetch
+// (normalized integer and half float attribute types)
+namespace mesh
+{
+    // Maps [0, 1] to GL_UNSIGNED_SHORT normalized
+    std::uint16_t quantizeUnorm16(float value);
+
+    // Packs vector with components in [-1, 1] to GL_INT_2_10_10_10_REV normalized, w is zero
+    std::uint32_t packSnorm10(glm::vec3 value);
+
+    // IEEE 754 binary16 (GL_HALF_FLOAT), rounded to nearest even
+    std::uint16_t floatToHalf(float value);
+}
+
+#endif
@@ -5,12 +5,19 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Shader.h"
+#include <Geometry/AABB.h>
+#include <Geometry/Bvh.h>
+#include <Geometry/MeshOptimizer.h>
+#include <Geometry/VertexQuantization.h>
+#include <Render/GeometryArena.h>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <utility>
 
 enum class TextureType {
     Albedo,
@@ -30,45 +37,202 @@ struct Vertex {
     glm::vec2 TexCoords;   
 };
 
+// Layout of vertices in GPU buffers, chosen once before the first mesh is created
+enum class VertexLayout {
+    // Vertex as is, 32 bytes
+    Float,
+    // 16 bytes: positions are 16-bit normalized within mesh bounds, normals are packed to
+    // GL_INT_2_10_10_10_REV and texture coordinates are half floats. Meshes with fewer than
+    // 65536 vertices also get 16-bit indices.
+    Quantized
+};
+
+// Vertex of VertexLayout::Quantized
+struct QuantizedVertex {
+    uint16_t Position[4];   // w is padding
+    uint32_t Normal;
+    uint16_t TexCoords[2];
+};
+
 struct Texture {
     unsigned int id;
     TextureType type;
     std::string path;
 };
 
+// Level of detail of mesh: range of its indices in geometry arena. All levels share vertices.
+struct MeshLod {
+    unsigned int firstIndex;    // relative to the first index of mesh geometry
+    unsigned int indexCount;
+    float error;                // largest deviation from full mesh surface in model space
+};
+
+// The same geometry as it is stored in the geometry arena: vertices of the arena layout and
+// indices of the type they are drawn with, uploaded without any conversion
+struct ArenaGeometry {
+    const void* vertices;
+    size_t vertexCount;
+    const void* indices;        // all levels of detail
+    size_t indexCount;
+    GLenum indexType;           // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+    glm::mat4 positionDecode;   // see Mesh::getPositionDecode
+};
+
+// Mesh geometry after import processing: optimized vertices and indices of all levels of detail
+// one after another, full mesh first. Pointers may refer to a memory mapped file.
+struct ProcessedGeometry {
+    const Vertex* vertices;
+    size_t vertexCount;
+    const unsigned int* indices;
+    size_t indexCount;
+    const MeshLod* lods;
+    size_t lodCount;
+    const mesh::Meshlet* meshlets;
+    size_t meshletCount;
+    ArenaGeometry arena;
+};
+
+// Owning counterpart of ProcessedGeometry, built by Mesh::processGeometry on any thread
+struct ProcessedMeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+    std::vector<mesh::Meshlet> meshlets;
+    // Arena layout, empty where it is the same as vertices and indices above
+    std::vector<QuantizedVertex> quantizedVertices;
+    std::vector<uint16_t> shortIndices;
+    glm::mat4 positionDecode = glm::mat4(1.0f);
+
+    ProcessedGeometry view() const;
+};
+
 const int BLINN_PHONG = 4;
 
 class Mesh {
 public:       
     Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures);
 
+    // Creates mesh from geometry processed before (e.g. read from geometry cache),
+    // levels of detail and meshlets are taken as they are
+    Mesh(const ProcessedGeometry& geometry, const std::vector<Texture>& textures);
+
     // Render the mesh
-    void Draw(Shader shader);
+    void Draw(Shader shader) const;
+
+    // Binds textures and sets material uniforms, used when draws are grouped by material
+    void bindMaterial(const Shader& shader) const;
+
+    // Unbinds textures and resets material uniforms to defaults
+    void unbindMaterial(const Shader& shader) const;
+
+    void setOpacityRatio(float opacity);
+
+    void setRefractionRatio(float refraction);
+
+    float getOpacityRatio() const { return _opacityRatio; }
+
+    float getRefractionRatio() const { return _refractionRatio; }
+
+    // Meshes with equal textures and material constants share material id
+    unsigned int getMaterialId() const { return _materialId; }
+
+    // All meshes share VAO and buffers of the geometry arena
+    unsigned int getVAO() const { return getGeometryArena().getVAO(); }
 
-    void setOpacityRatio(float opacity) { _opacityRatio = opacity; }
+    unsigned int getIndexCount() const { return static_cast<unsigned int>(_indices.size()); }
 
-    void setRefractionRatio(float refraction) { _refractionRatio = refraction; }
+    // Levels of detail from full mesh (error 0) to the coarsest one
+    const std::vector<MeshLod>& getLods() const { return _lods; }
 
-    float getOpacityRatio() { return _opacityRatio; }
+    // Clusters of full mesh triangles in model space, empty if the whole mesh is one cluster
+    const std::vector<mesh::Meshlet>& getMeshlets() const { return _meshlets; }
 
-    float getRefractionRatio() { return _refractionRatio; }
+    // Place of mesh vertices and indices in the geometry arena
+    const GeometryRange& getGeometry() const { return *_geometry; }
+
+    unsigned int getTextureCount() const { return static_cast<unsigned int>(_textures.size()); }
+
+    const std::vector<Vertex>& getVertices() const { return _vertices; }
+
+    const std::vector<unsigned int>& getIndices() const { return _indices; }
+
+    const std::vector<Texture>& getTextures() const { return _textures; }
+
+    // Bounds of the mesh vertices in model space
+    const AABB& getBounds() const { return _bounds; }
+
+    // Texture coordinate units per model space unit, averaged over area of all triangles.
+    // Tells how much of a texture one pixel covers, mip streaming picks levels by it.
+    float getTexCoordDensity() const { return _texCoordDensity; }
+
+    // Transforms positions stored in GPU buffers to model space, so it goes right before model matrix.
+    // Identity unless positions are quantized.
+    const glm::mat4& getPositionDecode() const { return _positionDecode; }
+
+    // Builds BVH over mesh triangles used by raycast. It is optional, since most meshes are never ray cast.
+    void buildTriangleBvh();
+
+    bool hasTriangleBvh() const { return _triangleBvh != nullptr; }
+
+    // Returns distance to the closest triangle hit by ray in model space (less than maxDistance) or -1
+    float raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance) const;
+
+    // Welds identical vertices, then reorders triangles for vertex cache and overdraw and vertices
+    // for fetch. Returns simulated vertex cache statistics of the original and optimized geometry.
+    static std::pair<mesh::VertexCacheStats, mesh::VertexCacheStats> optimizeGeometry(
+        std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // Builds meshlets and levels of detail (as enabled) and converts geometry to the arena layout,
+    // done by the first constructor. Doesn't touch GL, so meshes may be processed on worker threads
+    // and created on the GL thread.
+    static ProcessedMeshData processGeometry(std::vector<Vertex> vertices, std::vector<unsigned int> indices);
+
+    // New meshes get chain of simplified levels of detail
+    static bool generateLods;
+
+    // New meshes are split into meshlets culled separately
+    static bool generateMeshlets;
+
+    // Must be called before the first mesh is processed, since all meshes share the arena
+    static void setVertexLayout(VertexLayout layout);
+
+    static VertexLayout getVertexLayout();
+
+    // Size of one vertex in the arena buffers
+    static size_t getArenaVertexSize();
+
+    // Arena holding geometry of all meshes, created with the first mesh.
+    // Its GL objects must be released before the context is destroyed.
+    static GeometryArena& getGeometryArena();
 
 private:
-    // Initializes all the buffer objects/arrays
-    void setupMesh();
+    // Takes processed geometry and uploads it
+    void initialize(const ProcessedGeometry& geometry);
+
+    // Uploads vertices and indices of all levels of detail to the geometry arena
+    void setupMesh(const ArenaGeometry& geometry);
+
+    void updateMaterialId();
 
 private:
-    // Render data
-    unsigned int VAO;
-    unsigned int VBO;
-    unsigned int EBO;
+    // Render data, shared between copies of mesh and returned to arena with the last one
+    std::shared_ptr<const GeometryRange> _geometry;
 
     // Mesh data
     std::vector<Vertex> _vertices;
     std::vector<unsigned int> _indices;
     std::vector<Texture> _textures; 
-
-    float _opacityRatio;
-    float _refractionRatio;
+    std::vector<MeshLod> _lods;
+    std::vector<mesh::Meshlet> _meshlets;
+
+    AABB _bounds;
+    float _texCoordDensity = 0.0f;
+    glm::mat4 _positionDecode = glm::mat4(1.0f);
+    // Shared between copies of mesh, tree is immutable after build
+    std::shared_ptr<const Bvh> _triangleBvh;
+
+    float _opacityRatio = 1.0f;
+    float _refractionRatio = 1.0f;
+    unsigned int _materialId = 0;
 };
 #endif
\ No newline at end of file
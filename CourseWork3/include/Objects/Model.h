@@ -11,46 +11,179 @@
 #include <assimp/postprocess.h>
 #include "Shader.h"
 #include <Objects/Mesh.h>
+#include <Core/Handle.h>
+#include <Core/JobSystem.h>
+#include <Render/TextureRegistry.h>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
 
+class ModelCache;
+class TextureStreamer;
+
 unsigned int TextureFromFile(const char *path, const string &directory);
 
+// Image of model texture decoded by the CPU stage of loading, pixels are released after upload
+struct TextureImage
+{
+    string path;                // relative to model directory
+    TextureType type;
+    TextureKey key;             // finds texture loaded by other models
+    size_t videoSize = 0;       // estimated from image header, with mipmaps
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unique_ptr<unsigned char, void (*)(void*)> pixels{ nullptr, stbi_image_free };
+};
+
+// Uploads decoded image as mipmapped repeating texture, returns its id
+unsigned int uploadTexture(const TextureImage &image);
+
+// Estimated video memory of 8-bit texture with mipmaps, RGB is counted as RGBA
+size_t getTextureSize(int width, int height, int components);
+
+// Node of the model hierarchy as imported by ASSIMP. Nodes are stored in depth-first order,
+// so parent node always precedes its children.
+struct ModelNode
+{
+    string name;
+    glm::mat4 transform;            // relative to parent node
+    glm::mat4 globalTransform;      // relative to model root
+    int parent;                     // -1 for root node
+    vector<unsigned int> meshes;    // indices in Model::meshes
+};
+
+// Mesh prepared by the CPU stage of loading
+struct ImportedMesh
+{
+    string name;
+    ProcessedMeshData data;         // empty if geometry comes from cache
+    bool fromCache = false;
+    ProcessedGeometry cached = {};  // points into mapped cache file
+    vector<unsigned int> textures;  // indices in ModelImport::textures
+    float opacity = 1.0f;
+    float refraction = 1.0f;
+
+    ProcessedGeometry getGeometry() const { return fromCache ? cached : data.view(); }
+};
+
+// Result of the CPU stage of model loading: file is parsed, meshes are processed and textures are
+// decoded without any GL call. Made by Model::import on any thread, uploaded by Model constructor
+// on the GL thread.
+struct ModelImport
+{
+    string path;
+    string directory;
+    bool loaded = false;
+    string error;                   // why file couldn't be loaded
+    vector<ImportedMesh> meshes;
+    vector<TextureImage> textures;
+    unordered_map<string, unsigned int> textureIndices;     // by path, used while importing
+    vector<ModelNode> nodes;
+    vector<string> dependencies;            // files read besides the source one (e.g. .mtl), geometry cache depends on them
+    shared_ptr<const ModelCache> cache;     // keeps cached geometry mapped until upload
+};
+
 class Model 
 {
 public:
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// textures of all meshes, model holds a reference to each of them in texture registry
     vector<Mesh> meshes;    
+    vector<ModelNode> nodes;
     string directory;
 
-    // constructor, expects a filepath to a 3D model.
-    Model(string const &path);
+    // imported meshes are welded and reordered for vertex cache, overdraw and vertex fetch,
+    // statistics of every mesh are printed. Can be turned off to compare with original geometry.
+    static bool optimizeMeshes;
+
+    // models loaded from file are cooked to geometry cache next to it (see ModelCache),
+    // later loads read the cache instead of importing the file again
+    static bool useGeometryCache;
+
+    // .obj files are read by ObjLoader instead of ASSIMP, which is used for other formats
+    static bool useObjLoader;
+
+    // if set, textures are decoded and uploaded by the streamer in background and meshes get
+    // placeholder textures first, otherwise they are decoded by import and uploaded by constructor
+    static TextureStreamer* textureStreamer;
+
+    // constructor, expects a filepath to a 3D model. Model is imported and uploaded on the calling thread,
+    // jobs (if given) help with the import.
+    Model(string const &path, JobSystem* jobs = nullptr);
+
+    // uploads model imported before, must be called on the GL thread.
+    // Exits if the file couldn't be imported.
+    explicit Model(ModelImport &&imported);
+
+    // creates model from meshes built in memory (e.g. merged static geometry),
+    // all of them are drawn by the root node. name is used as model directory.
+    Model(string const &name, vector<Mesh> meshes);
+
+    // releases references to textures
+    ~Model();
+
+    // textures are referenced once per model, so it can only be moved
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model &&other) noexcept;
+    Model& operator=(Model &&other) noexcept;
 
     // draws the model, and thus all its meshes
     void Draw(Shader shader);    
 
+    // returns bounds of all meshes in model space
+    AABB getBounds() const;
+
+    // CPU stage of loading, safe to call on any thread: reads geometry cache or imports the file,
+    // processes meshes and decodes textures (unless they are streamed). Jobs (if given) parse .obj files, process meshes and
+    // decode textures in parallel.
+    static ModelImport import(string const &path, JobSystem* jobs = nullptr);
+
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path);
+    // fills import from geometry cache, returns false if there is no valid cache
+    static bool importCached(ModelImport &result);
+
+    // loads .obj file with ObjLoader, returns false if it can't be parsed
+    static bool importObj(ModelImport &result, JobSystem* jobs);
+
+    // loads a model with supported ASSIMP extensions from file
+    static bool importAssimp(ModelImport &result);
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene);
+    // node transformation is kept in nodes together with indices of its meshes.
+    // processedMeshes maps ASSIMP mesh index to index in meshes, so meshes referenced by several nodes are loaded once
+    static void processNode(aiNode *node, const aiScene *scene, int parent, ModelImport &result, map<unsigned int, unsigned int> &processedMeshes);
+
+    static ImportedMesh processMesh(aiMesh *mesh, const aiScene *scene, ModelImport &result);
+
+    // checks all material textures of a given type and adds the textures if they're not added yet.
+    // indices of textures in result are returned.
+    static vector<unsigned int> loadMaterialTextures(aiMaterial *mat, aiTextureType type, TextureType typeName, ModelImport &result);
+
+    // returns index of texture with path relative to model directory, adds it unless it was added already
+    static unsigned int addTexture(ModelImport &result, const string &path, TextureType typeName);
+
+    // optimizes imported geometry (if enabled) and builds meshlets and levels of detail of every mesh
+    static void processMeshes(ModelImport &result, JobSystem* jobs);
+
+    // makes registry keys of textures and estimates their size from image headers
+    static void identifyTextures(ModelImport &result, JobSystem* jobs);
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+    static void decodeTextures(ModelImport &result, JobSystem* jobs);
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, TextureType typeName);    
+    void releaseTextures();
 
 private:
     std::string path;
 };
 
+using ModelHandle = Handle<Model>;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <Core/MappedFile.h>
+#include <Objects/Mesh.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ModelImport;
+struct ModelNode;
+
+// Cooked model stored next to its source file (source path + ".cache"), so warm starts skip
+// ASSIMP import and mesh processing. File holds a versioned header, tables of meshes, materials
+// and nodes and blobs of processed vertices and indices (all levels of detail). Besides float
+// vertices kept on CPU, meshes store the geometry arena layout (quantized vertices, 16-bit indices
+// and position decode), aligned so that it is uploaded to GL straight from the memory mapped file.
+// Cache is valid for source file and files imported with it (.mtl libraries and such) of the same
+// size and modification time (or the same content hash, if only the time changed) and for the same
+// mesh processing options and vertex layout.
+class ModelCache
+{
+public:
+    // Must change whenever file layout or mesh processing changes
+    static const std::uint32_t VERSION = 3;
+
+    struct CachedMesh
+    {
+        ProcessedGeometry geometry;     // points into mapped file
+        unsigned int material;
+    };
+
+    struct CachedMaterial
+    {
+        float opacity;
+        float refraction;
+        std::vector<std::pair<TextureType, std::string>> textures;  // paths relative to model directory
+    };
+
+    static std::string getCachePath(const std::string& sourcePath);
+
+    // Maps cache of source file, returns false if it is missing, stale or broken
+    bool open(const std::string& sourcePath);
+
+    std::size_t getMeshCount() const;
+    CachedMesh getMesh(std::size_t index) const;
+
+    std::size_t getMaterialCount() const;
+    CachedMaterial getMaterial(std::size_t index) const;
+
+    // Nodes in depth-first order, global transforms are not stored
+    std::size_t getNodeCount() const;
+    ModelNode getNode(std::size_t index) const;
+
+    // Cooks model imported from source file, returns false if cache can't be written.
+    // Doesn't touch GL, so it is written by the import stage.
+    static bool write(const std::string& sourcePath, const ModelImport& model);
+
+private:
+    bool validate() const;
+
+    template <typename T>
+    const T* at(std::uint64_t offset) const { return reinterpret_cast<const T*>(m_file.getData() + offset); }
+
+    std::string getString(std::uint32_t offset, std::uint32_t length) const;
+
+private:
+    MappedFile m_file;
+};
+
+#endif
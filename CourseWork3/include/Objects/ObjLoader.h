@@ -0,0 +1,56 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <Core/JobSystem.h>
+#include <Objects/Mesh.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Material of MTL library, only properties used by Mesh are read
+struct ObjMaterial
+{
+    std::string name;
+    float opacity = 1.0f;       // d
+    float refraction = 1.0f;    // Ni
+    // Paths relative to model directory in order of appearance. Maps get the same types as
+    // ASSIMP texture types give them in Model: map_Kd - albedo, map_Ks - metallic,
+    // map_Bump (bump) - normal, map_Kn (norm) - roughness.
+    std::vector<std::pair<TextureType, std::string>> textures;
+};
+
+// Triangles of one object with one material. Every face corner has its own vertex, as ASSIMP
+// imports them, so meshes are welded by the same optimization as imported ones.
+struct ObjMesh
+{
+    std::string name;           // of the object
+    unsigned int material;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Object or group of faces
+struct ObjObject
+{
+    std::string name;
+    std::vector<unsigned int> meshes;
+};
+
+struct ObjModel
+{
+    // The first one is the default material of faces without known usemtl
+    std::vector<ObjMaterial> materials;
+    std::vector<ObjMesh> meshes;
+    std::vector<ObjObject> objects;
+    // Paths of MTL libraries named by mtllib, missing ones included
+    std::vector<std::string> libraries;
+};
+
+// Loads OBJ file and MTL libraries it references. File is memory mapped and split into chunks
+// of whole lines, which are parsed in parallel by jobs (if given), then faces of all chunks are
+// triangulated (as fans) into meshes split by object and material like ASSIMP does.
+// Returns false and prints error if file can't be read or is malformed.
+bool loadObj(const std::string& path, ObjModel& model, JobSystem* jobs = nullptr);
+
+#endif
@@ -2,39 +2,54 @@
 #define OBJECT_H
 
 #include <Objects/Model.h>
+#include <Core/Handle.h>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+class Object;
+using ObjectHandle = Handle<Object>;
+
 class Object
 {
 public:    
 
-    Object(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, const std::shared_ptr<Model>& model):
+    Object(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, ModelHandle model):
         _model(model), 
         _position(position),
         _rotation(rotation),
         _scale(scale) {}
 
-    std::shared_ptr<Model> getModel() { return _model ? _model : nullptr; }
+    // Handle of model in Scene, model itself is resolved through Scene::getModel
+    ModelHandle getModel() const { return _model; }
 
-    void setModel(const std::shared_ptr<Model>& model) { _model = model; };
+    void setModel(ModelHandle model) { _model = model; };
 
     glm::vec3 getPosition() { return _position; }
 
     void setPosition(glm::vec3 position) { _position = position; }
 
+    glm::vec3 getRotation() { return _rotation; }
+
+    void setRotation(glm::vec3 rotation) { _rotation = rotation; }
+
     glm::vec3 getScale() { return _scale; }
 
     void setScale(glm::vec3 scale) { _scale = scale; }
 
+    ObjectHandle getParent() const { return _parent; }
+
     // Returns translated, rotated and scaled model matrix
     glm::mat4 getModelMatrix();
 
 private:
-    std::shared_ptr<Model> _model;
+    friend class Scene;
+
+    ModelHandle _model;
+    ObjectHandle _parent;
+    std::uint32_t _node = 0; // node of object in scene graph
     glm::vec3 _position;
     glm::vec3 _rotation;
     glm::vec3 _scale;
 };
 
-#endif
\ No newline at end of file
+#endif
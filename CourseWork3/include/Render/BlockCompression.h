@@ -0,0 +1,41 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encoders of block compressed texture formats (4x4 texel blocks), GPU decodes them when sampling.
+// BC1 and BC3 are GL_EXT_texture_compression_s3tc (DXT1, DXT5), BC4 and BC5 are RGTC1 and RGTC2.
+namespace bc
+{
+    enum class Format
+    {
+        BC1,    // RGB, 8 bytes per block
+        BC3,    // RGBA, 16 bytes per block: BC4 alpha and BC1 color
+        BC4,    // one channel (red), 8 bytes per block
+        BC5     // two channels (red, green), 16 bytes per block
+    };
+
+    std::size_t getBlockSize(Format format);
+
+    // Size of image of given dimensions, partial blocks at the edges take whole blocks
+    std::size_t getCompressedSize(Format format, int width, int height);
+
+    // Texels are 4 bytes (RGBA), row by row. Color is fitted along principal axis of the block.
+    void encodeBC1(const std::uint8_t* rgba, std::uint8_t* block);
+
+    void encodeBC3(const std::uint8_t* rgba, std::uint8_t* block);
+
+    // 16 values, each one is read with stride bytes between them
+    void encodeBC4(const std::uint8_t* values, std::size_t stride, std::uint8_t* block);
+
+    // Texels are 2 bytes (red, green)
+    void encodeBC5(const std::uint8_t* rg, std::uint8_t* block);
+
+    // Compresses image of 8-bit texels with 1 to 4 components. Missing color components
+    // are replicated from red, missing alpha is opaque. BC4 takes red, BC5 red and green.
+    std::vector<std::uint8_t> compress(Format format, const std::uint8_t* pixels, int width, int height, int components);
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <Geometry/Frustum.h>
+#include <Render/RenderQueue.h>
+#include <Render/RingBuffer.h>
+#include <Scene/Scene.h>
+#include <Shader.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Per-draw data, layout matches std430 DrawConstantsData struct of shaders/draw_constants.glsl. Instanced draws
+// read model and normal matrix of every instance as instanced attributes.
+struct DrawConstants
+{
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3];  // columns of mat3 are padded to vec4 in std430
+    float opacityRatio;
+    float refractionRatio;
+    float padding[2];
+};
+
+// Shader storage buffer binding point of DrawConstants of all draws of a multi-draw list
+// (set in shaders as well)
+const unsigned int DRAW_CONSTANTS_BINDING = 0;
+
+// Layout of glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;    // index of draw in list, shaders read it as draw id
+};
+
+// Input of GPU culling for one draw, layout matches std430 struct of culling.comp
+struct DrawCullData
+{
+    glm::vec3 boundsMin;            // world space bounds of mesh instance or meshlet
+    std::uint32_t batch;            // index of batch the draw belongs to
+    glm::vec3 boundsMax;
+    std::uint32_t batchFirstDraw;   // index of the first draw of that batch
+    glm::vec4 sphere;               // world space bounding sphere (center, radius)
+    glm::vec4 cone;                 // normal cone of meshlet (axis, cutoff), see mesh::Meshlet
+};
+
+// Picks mesh levels of detail by their error projected to view
+struct LodSelection
+{
+    // Pixels covered by unit length at unit distance: viewport height / (2 tan(fovY / 2)).
+    // Zero draws full meshes.
+    float projectionScale = 0.0f;
+    // The coarsest level whose error stays within that many pixels is drawn
+    float maxPixelError = 1.0f;
+};
+
+// View a draw list is recorded for
+struct DrawView
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    // Meshlets outside of frustum or range sphere around position are skipped when they are given
+    const Frustum* frustum = nullptr;
+    float range = 0.0f;
+    LodSelection lods;
+};
+
+// Sorted list of draws recorded once per view (camera or light) and replayed by every pass
+// rendered from that view. Building resolves meshes and sort keys and writes per-draw constants
+// to ring buffer, so replay only binds buffer ranges and state which differs from the previous
+// draw and issues draw calls. Neighbouring draws of the same mesh are merged into one instanced
+// draw, so copies of a model cost one draw call per mesh. Level of detail of every instance
+// is picked by its projected error. Full detail meshes split into meshlets are culled by meshlet
+// (frustum, range and back-facing normal cone), visible runs of meshlets become separate draws.
+// Neighbouring instances of such a mesh are drawn whole instead, so they stay one instanced draw.
+// With GL 4.3 list can be recorded for multi-draw indirect: constants of all draws form one
+// array in shader storage buffer and draw commands are written to indirect buffer, so replay
+// issues one glMultiDrawElementsIndirect per run of draws sharing material, VAO and index type. Instances
+// are not merged there, every one (and every visible meshlet) keeps its own command to be culled
+// separately, its base instance is index of its constants.
+// Such list can be culled on GPU (see GpuCulling), then replay draws compacted commands.
+// Recorded draws point into scene data and stay valid until the next Scene::update().
+class DrawList
+{
+public:
+    struct Draw
+    {
+        const Mesh* mesh;
+        std::size_t constantsOffset;    // offset of DrawConstants of the first instance in ring buffer
+        GLsizei instanceCount;          // constants of instances follow each other
+        unsigned int vao;
+        unsigned int indexCount;
+        const void* indexOffset;        // first index of mesh in geometry arena
+        GLenum indexType;
+        GLint baseVertex;
+        unsigned int material;
+    };
+
+    // Consecutive draws with the same material, VAO and index type submitted by one multi-draw
+    struct Batch
+    {
+        const Mesh* mesh;
+        unsigned int vao;
+        GLenum indexType;
+        std::size_t firstDraw;
+        std::size_t drawCount;
+    };
+
+    // Records mesh instances of scene sorted by state and distance from view position,
+    // their constants are written to ring buffer. If indirect commands buffer is given, list is
+    // recorded for multi-draw indirect (shaders must be compiled with MULTI_DRAW_INDIRECT).
+    // List is left empty if a ring buffer runs out of space (see RingBuffer::hasOverflowed), it
+    // must be built again after the buffer grows. Can be called from job threads.
+    void build(const Scene& scene, const std::vector<std::uint32_t>& instances, const DrawView& view,
+        RingBuffer& constants, RingBuffer* commands = nullptr);
+
+    // Issues recorded draws with pass shader, which must be already in use
+    void replay(const Shader& shader) const;
+
+    void clear();
+
+    const std::vector<Draw>& getDraws() const { return m_draws; }
+    const std::vector<Batch>& getBatches() const { return m_batches; }
+    bool isMultiDraw() const { return m_multiDraw; }
+
+    // Triangles of recorded draws, and how many there would be with full meshes
+    std::size_t getTriangleCount() const { return m_triangleCount; }
+    std::size_t getFullTriangleCount() const { return m_fullTriangleCount; }
+
+    GLuint getConstantsBuffer() const { return m_constantsBuffer; }
+    std::size_t getCullDataOffset() const { return m_cullDataOffset; }
+    GLuint getCommandsBuffer() const { return m_commandsBuffer; }
+    std::size_t getCommandsOffset() const { return m_commandsOffset; }
+
+    // Makes replay draw commands compacted by GPU culling: commands of every batch start at the
+    // same place as in input, number of visible ones is in counts buffer (one uint per batch).
+    // Reset by the next build().
+    void setCulledCommands(GLuint commandsBuffer, GLuint countsBuffer, std::size_t countsOffset);
+    bool isCulled() const { return m_culledCommandsBuffer != 0; }
+    std::size_t size() const { return m_draws.size(); }
+    bool empty() const { return m_draws.empty(); }
+
+private:
+    void recordBatches();
+    void writeCullData(RingBuffer& constants);
+    void bindMaterial(const Shader& shader, const Mesh* mesh, const Mesh* previous) const;
+    void replayMultiDraw(const Shader& shader) const;
+
+private:
+    RenderQueue m_queue;
+    std::vector<Draw> m_draws;
+    std::vector<Batch> m_batches;
+    GLuint m_constantsBuffer = 0;
+    std::size_t m_constantsOffset = 0;  // constants array of all instances
+    std::size_t m_constantsCount = 0;
+    std::size_t m_triangleCount = 0;
+    std::size_t m_fullTriangleCount = 0;
+
+    // Multi-draw indirect data: commands of all draws
+    bool m_multiDraw = false;
+    GLuint m_commandsBuffer = 0;
+    std::size_t m_commandsOffset = 0;
+    std::size_t m_cullDataOffset = 0;
+    std::vector<DrawCullData> m_cullData;   // of every draw, batch fields are filled by writeCullData
+
+    // Output of GPU culling
+    GLuint m_culledCommandsBuffer = 0;
+    GLuint m_countsBuffer = 0;
+    std::size_t m_countsOffset = 0;
+};
+
+#endif
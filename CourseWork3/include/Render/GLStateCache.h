@@ -0,0 +1,88 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of OpenGL binding and fixed function state.
+// Calls which would set state to the value it already has are dropped before reaching driver.
+// Texture unit selection is lazy: activeTexture() only remembers the unit, glActiveTexture is
+// issued when a texture bind on that unit actually has to happen.
+// All code that runs in render loop must change this state through the cache, code which
+// calls GL directly (e.g. resource loading) must be followed by invalidate().
+class GLStateCache
+{
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    struct Stats
+    {
+        unsigned int issued = 0;    // calls passed to driver
+        unsigned int skipped = 0;   // redundant calls dropped
+    };
+
+    GLStateCache() { invalidate(); }
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+
+    void activeTexture(GLenum unit);    // GL_TEXTURE0 + i
+    void bindTexture(GLenum target, GLuint texture);
+
+    // Deletes textures, units they were bound to get 0 as GL binds there. Otherwise a name recycled
+    // by GL would match a stale cached binding and its bind would be dropped.
+    void deleteTextures(GLsizei count, const GLuint* textures);
+
+    // GL_FRAMEBUFFER binds both read and draw framebuffers
+    void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+    // Cached for depth test, blending and face culling, other capabilities are passed through
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+
+    void depthFunc(GLenum function);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // Forgets all cached values, so next call of every kind reaches driver
+    void invalidate();
+
+    const Stats& getStats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+
+private:
+    struct Capability
+    {
+        bool enabled = false;
+        bool known = false;
+    };
+
+    Capability* findCapability(GLenum capability);
+    void setCapability(GLenum capability, bool enabled);
+    int textureTargetIndex(GLenum target) const;
+    bool update(GLuint& cached, GLuint value);
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+    static const int TEXTURE_TARGETS = 2;   // GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP
+
+    GLuint m_program;
+    GLuint m_vao;
+    GLuint m_readFramebuffer;
+    GLuint m_drawFramebuffer;
+    GLuint m_selectedUnit;                  // unit requested by activeTexture()
+    GLuint m_activeUnit;                    // unit really active in driver
+    GLuint m_textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+
+    Capability m_depthTest;
+    Capability m_blend;
+    Capability m_cullFace;
+    GLuint m_depthFunc;
+    GLint m_viewport[4];
+    bool m_viewportKnown;
+
+    Stats m_stats;
+};
+
+// State cache of the (only) GL context
+GLStateCache& getGLState();
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <Core/RangeAllocator.h>
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct VertexAttribute
+{
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    std::size_t offset;
+};
+
+// Layout of interleaved vertices, all meshes of one format share a VAO
+struct VertexFormat
+{
+    GLsizei stride;
+    std::vector<VertexAttribute> attributes;
+};
+
+// Place of mesh geometry in arena buffers. Range is returned to arena when the last
+// owner releases it, so geometry of unloaded models is reused by models loaded later.
+struct GeometryRange
+{
+    std::uint32_t id;           // unique for ranges allocated from arena, groups draws of the same geometry
+    GLint baseVertex;           // added to every index by glDrawElementsBaseVertex
+    std::size_t vertexCount;
+    std::size_t firstIndex;     // in units of index type, as firstIndex of indirect commands
+    std::size_t indexCount;
+    GLenum indexType;           // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+
+    std::size_t getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t); }
+
+    // Byte offset of the first index, passed to draw calls as indices pointer
+    const void* getIndexOffset() const { return reinterpret_cast<const void*>(firstIndex * getIndexSize()); }
+};
+
+// Shared vertex and index buffers for all meshes of one vertex format.
+// Meshes get ranges of the buffers from best-fit sub-allocators and are drawn with
+// glDrawElementsBaseVertex under the single VAO of the arena, so switching between meshes
+// doesn't change any GL state. Buffers grow (by copying on GPU) when they run out of space.
+// Indices are relative to mesh's first vertex, 32 or 16-bit per mesh. Index buffer is allocated
+// in 32-bit blocks, so 16-bit indices of a mesh always start at even index.
+// For multi-draw indirect VAO also has an instanced attribute with draw index: it reads
+// identity buffer at base instance of indirect command, since gl_DrawID needs GL 4.6.
+// Instanced draws read per-instance data from attributes starting at INSTANCE_LOCATION,
+// which are pointed at caller's buffer by bindInstances().
+// Allocation and upload must happen on the GL thread, ranges may be released on any thread.
+class GeometryArena
+{
+public:
+    static const GLuint DRAW_ID_LOCATION = 3;
+    static const GLuint INSTANCE_LOCATION = 4;
+
+    GeometryArena(const VertexFormat& format, std::size_t vertexCapacity, std::size_t indexCapacity);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // Uploads vertices (vertexCount * stride bytes) and indices of given type into free ranges of the buffers
+    std::shared_ptr<const GeometryRange> allocate(const void* vertices, std::size_t vertexCount, const void* indices, std::size_t indexCount,
+        GLenum indexType = GL_UNSIGNED_INT);
+
+    // Makes draw id attribute valid for base instances [0, count)
+    void reserveDrawIds(std::size_t count);
+
+    // Points instanced attributes (divisor 1) of format at buffer + offset, VAO must be bound.
+    // Attribute locations of format start at INSTANCE_LOCATION, format must be the same in all calls:
+    // attributes are enabled and get their divisor on the first call, later ones only move pointers.
+    void bindInstances(const VertexFormat& format, GLuint buffer, std::size_t offset);
+
+    // Deletes GL objects, must be called while the context still exists.
+    // Ranges may still be released after that.
+    void release();
+
+    GLuint getVAO() const { return m_vao; }
+    GLuint getVertexBuffer() const { return m_vertexBuffer; }
+    GLuint getIndexBuffer() const { return m_indexBuffer; }
+    const VertexFormat& getFormat() const { return m_format; }
+
+    std::size_t getVertexCapacity() const;
+    std::size_t getUsedVertices() const;
+    // In 32-bit blocks
+    std::size_t getIndexCapacity() const;
+    std::size_t getUsedIndices() const;
+
+private:
+    void free(const GeometryRange& range);
+
+    // Index buffer blocks holding indices of range
+    static std::size_t getIndexBlockCount(std::size_t indexCount, std::size_t indexSize);
+
+    // Reserves range, grows buffer if needed. Must be called with mutex locked.
+    std::size_t reserve(RangeAllocator& allocator, GLuint& buffer, std::size_t elementSize, std::size_t count);
+    void growBuffer(GLuint& buffer, std::size_t oldSize, std::size_t newSize);
+    void setupVertexArray();
+
+private:
+    VertexFormat m_format;
+    GLuint m_vao = 0;
+    GLuint m_vertexBuffer = 0;
+    GLuint m_indexBuffer = 0;
+    GLuint m_drawIdBuffer = 0;
+    std::size_t m_drawIdCapacity = 0;
+    bool m_instancesEnabled = false;
+    std::uint32_t m_nextRangeId = 0;
+
+    mutable std::mutex m_mutex;
+    RangeAllocator m_vertices;
+    RangeAllocator m_indices;
+};
+
+#endif
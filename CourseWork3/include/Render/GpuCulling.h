@@ -0,0 +1,64 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include <Geometry/Frustum.h>
+#include <Render/DrawList.h>
+#include <Render/HiZPyramid.h>
+#include <Shader.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Culls draws of multi-draw lists on GPU with compute shader (GL 4.3). Bounds of every draw are
+// tested against view frustum, light range and hierarchical depth of previous frame, normal cones
+// of meshlet draws against view position. Commands
+// of visible draws are compacted within their batch to output buffer.
+// Output buffer mirrors indirect commands ring buffer, so culled commands of a list are at the
+// same offset as its input commands.
+class GpuCulling
+{
+public:
+    struct View
+    {
+        bool frustumTest = false;
+        Frustum frustum;
+        bool sphereTest = false;
+        glm::vec3 sphereCenter = glm::vec3(0.0f);
+        float sphereRadius = 0.0f;
+        // Meshlets facing away from view position are culled
+        bool coneTest = false;
+        glm::vec3 viewPosition = glm::vec3(0.0f);
+        const HiZPyramid* occlusion = nullptr;  // ignored if pyramid is not built yet
+    };
+
+    // commandsSize is size of indirect commands ring buffer, maxBatches is number of batches
+    // of all lists culled in one frame
+    GpuCulling(std::size_t commandsSize, std::size_t maxBatches);
+    ~GpuCulling();
+
+    GpuCulling(const GpuCulling&) = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    // Follows growth of indirect commands ring buffer, must be called before lists in it are culled
+    void resize(std::size_t commandsSize);
+
+    // Starts new frame of culling, counts of previous frame are reused
+    void beginFrame();
+
+    // Culls draws recorded by list, list replays compacted commands afterwards.
+    // Lists beyond output buffer are left to CPU culling.
+    void cull(DrawList& list, const View& view);
+
+private:
+    GLuint m_commandsBuffer = 0;
+    GLuint m_countsBuffer = 0;
+    std::size_t m_commandsSize;
+    std::size_t m_countsSize;
+    std::size_t m_countsHead = 0;
+    std::size_t m_storageAlignment;
+    Shader m_cullingShader;
+};
+
+#endif
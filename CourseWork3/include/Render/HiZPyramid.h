@@ -0,0 +1,46 @@
+#ifndef HI_Z_PYRAMID_H
+#define HI_Z_PYRAMID_H
+
+#include <Shader.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Hierarchical depth buffer: mip chain of R32F texture where every texel holds the farthest
+// depth of the area it covers. Built by compute shaders (GL 4.3) from depth of a framebuffer,
+// used by GPU culling to reject draws hidden behind geometry already rendered.
+// Depth is copied by blit, so source depth must be GL_DEPTH_COMPONENT24.
+class HiZPyramid
+{
+public:
+    HiZPyramid(int width, int height);
+    ~HiZPyramid();
+
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+    // Copies depth of framebuffer rendered with viewProjection and reduces it to all levels
+    void build(GLuint sourceFramebuffer, const glm::mat4& viewProjection);
+
+    bool isBuilt() const { return m_built; }
+    GLuint getTexture() const { return m_pyramid; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    int getLevels() const { return m_levels; }
+    const glm::mat4& getViewProjection() const { return m_viewProjection; }
+
+private:
+    int m_width;
+    int m_height;
+    int m_levels;
+
+    GLuint m_depthTexture = 0;
+    GLuint m_depthFramebuffer = 0;
+    GLuint m_pyramid = 0;
+    Shader m_reduceShader;
+
+    glm::mat4 m_viewProjection;
+    bool m_built = false;
+};
+
+#endif
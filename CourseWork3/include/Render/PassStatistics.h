@@ -0,0 +1,60 @@
+#ifndef PASS_STATISTICS_H
+#define PASS_STATISTICS_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Counts vertex shader invocations of render passes with pipeline statistics queries
+// (GL 4.6 or ARB_pipeline_statistics_query). Results are read back only when available, so they
+// lag a few frames behind and never stall the pipeline. Without support all calls do nothing.
+// Queries of one kind can't be nested, so passes must not overlap.
+class PassStatistics
+{
+public:
+    explicit PassStatistics(std::vector<std::string> passNames);
+    ~PassStatistics();
+
+    PassStatistics(const PassStatistics&) = delete;
+    PassStatistics& operator=(const PassStatistics&) = delete;
+
+    static bool isSupported();
+
+    // False if queries are not supported by context
+    bool isEnabled() const { return m_supported; }
+
+    // Pass may be begun several times per frame, all its invocations are summed
+    void begin(unsigned int pass);
+    void end();
+
+    // Adds results of finished queries to totals
+    void collect();
+
+    std::size_t getPassCount() const { return m_passNames.size(); }
+    const std::string& getPassName(unsigned int pass) const { return m_passNames[pass]; }
+
+    // Invocations of pass collected since last reset
+    unsigned long long getInvocations(unsigned int pass) const { return m_invocations[pass]; }
+
+    void resetTotals();
+
+private:
+    struct PendingQuery
+    {
+        GLuint query;
+        unsigned int pass;
+    };
+
+    bool m_supported;
+    std::vector<std::string> m_passNames;
+    std::vector<unsigned long long> m_invocations;
+    std::vector<GLuint> m_freeQueries;
+    std::vector<GLuint> m_allQueries;
+    // In order of issue, results become available in the same order
+    std::vector<PendingQuery> m_pending;
+    bool m_active = false;
+};
+
+#endif
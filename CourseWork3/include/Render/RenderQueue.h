@@ -0,0 +1,50 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+// List of draws ordered by 64-bit sort keys.
+// Key packs everything that causes state change, most expensive change in the highest bits:
+//
+//   opaque:      | layer 2 | shader 6 | material 16 | geometry 16 | depth 24 |
+//   translucent: | layer 2 | shader 6 | inverted depth 24 | material 16 | geometry 16 |
+//
+// so sorted opaque draws are grouped by shader, material and geometry (draws of one mesh become
+// neighbours and can be instanced) and go front to back inside a group (for early depth test),
+// while translucent draws go back to front.
+class RenderQueue
+{
+public:
+    enum class Layer : std::uint8_t
+    {
+        Opaque = 0,
+        Translucent = 1
+    };
+
+    struct Item
+    {
+        std::uint64_t key;
+        std::uint32_t instance; // index of mesh instance in scene
+    };
+
+    // Depth is distance from viewer, negative values are clamped to zero
+    static std::uint64_t makeKey(Layer layer, std::uint32_t shader, std::uint32_t material, std::uint32_t geometry, float depth);
+
+    void clear() { m_items.clear(); }
+
+    void push(std::uint64_t key, std::uint32_t instance) { m_items.push_back({ key, instance }); }
+
+    // Sorts items by key with LSD radix sort
+    void sort();
+
+    const std::vector<Item>& getItems() const { return m_items; }
+    std::size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+
+private:
+    std::vector<Item> m_items;
+    std::vector<Item> m_sortBuffer;
+};
+
+#endif
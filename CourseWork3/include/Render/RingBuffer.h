@@ -0,0 +1,75 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// GPU buffer for data written by CPU every frame (e.g. per-draw constants).
+// Buffer is split into several regions, one per frame in flight. CPU writes current frame
+// region while GPU reads regions of previous frames; a fence placed at the end of frame guards
+// region from being overwritten before GPU has finished with it.
+// With GL 4.4 buffer is created with glBufferStorage and stays persistently mapped (coherent),
+// so allocation returns pointer straight into GPU visible memory. Otherwise data is written to
+// CPU copy of the region and uploaded by flush().
+// allocate() may be called from several threads at once. Allocations which don't fit are still
+// counted, so after a frame overflowed the buffer can be grown to fit it and the frame written again.
+class RingBuffer
+{
+public:
+    // alignment of every allocation, e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform buffers
+    RingBuffer(GLenum target, std::size_t regionSize, std::size_t alignment, unsigned int regions = 3);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Moves to the next region, waits until GPU has finished reading it
+    void beginFrame();
+
+    // Places fence after commands which read current region
+    void endFrame();
+
+    // Returns pointer to memory for size bytes and its offset in buffer or nullptr if region is full
+    void* allocate(std::size_t size, std::size_t& offset);
+
+    // Uploads data written to current region, does nothing if buffer is persistently mapped
+    void flush();
+
+    // Empties current region, so data of the frame can be written again
+    void restartFrame() { m_head = 0; }
+
+    // True if some allocation of current frame didn't fit in region
+    bool hasOverflowed() const { return m_head.load() > m_regionSize; }
+
+    // Replaces buffer with one whose regions fit everything allocated in current frame (at least twice
+    // the old size) and empties current region, so data of the frame must be written again. GPU keeps
+    // reading previous frames from the old buffer, GL deletes it once they are done. GL thread only.
+    void grow();
+
+    GLuint getBuffer() const { return m_buffer; }
+    std::size_t getSize() const { return m_regionSize * m_regions; }
+    GLenum getTarget() const { return m_target; }
+    bool isPersistent() const { return m_mapped != nullptr; }
+
+private:
+    void create();
+
+private:
+    GLenum m_target;
+    GLuint m_buffer = 0;
+    std::size_t m_regionSize;
+    std::size_t m_alignment;
+    unsigned int m_regions;
+
+    unsigned int m_currentRegion = 0;
+    std::atomic<std::size_t> m_head{ 0 };   // used bytes of current region
+    std::vector<GLsync> m_fences;
+
+    char* m_mapped = nullptr;               // persistently mapped buffer
+    std::vector<char> m_staging;            // CPU copy of current region without buffer storage
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <Core/MappedFile.h>
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// S3TC is an extension, loader generated for core profile may not define its formats
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// How texture content is encoded by cooking
+enum class TextureUsage : std::uint32_t
+{
+    Color,      // sRGB color (albedo): BC1, or BC3 if it has alpha
+    Normal,     // tangent space normal: BC5 of x and y, shaders reconstruct z
+    Mask        // single value in red (metallic, roughness): BC4
+};
+
+// Mip level of cooked texture, offset is relative to the first level
+struct CookedLevel
+{
+    int width;
+    int height;
+    std::size_t offset;
+    std::size_t size;
+};
+
+// Texture with all mip levels ready for upload
+struct CookedTexture
+{
+    GLenum format = 0;          // compressed internal format, or GL_RGBA8 without S3TC support
+    bool compressed = false;
+    std::vector<CookedLevel> levels;        // the finest first
+    std::vector<unsigned char> data;
+};
+
+// Cooked texture stored next to its source image (source path + usage + ".cache", e.g.
+// "brick.png.normal.cache"), so an image used both as color and as mask keeps both. Later loads skip
+// decoding, mip generation and compression and upload levels straight from the memory mapped file.
+// Mip levels are filtered in linear space: color is converted from sRGB and back, averaged normals
+// are renormalized. Cache is valid for source file of the same size and modification time (or the
+// same content hash, if only the time changed), the same usage and the same color compression.
+class TextureCache
+{
+public:
+    // Must change whenever file layout, mip filtering or encoders change
+    static const std::uint32_t VERSION = 1;
+
+    static std::string getCachePath(const std::string& sourcePath, TextureUsage usage);
+
+    // True if context supports S3TC (BC1, BC3) needed for compressed color, GL thread only.
+    // BC4 and BC5 (RGTC) are core since GL 3.0.
+    static bool isColorCompressionSupported();
+
+    // Maps cache of source file, returns false if it is missing, stale, broken or cooked differently
+    bool open(const std::string& sourcePath, TextureUsage usage, bool colorCompression);
+
+    GLenum getFormat() const;
+    bool isCompressed() const;
+    std::vector<CookedLevel> getLevels() const;
+    // Data of the first level, offsets of levels are relative to it
+    const unsigned char* getData() const;
+
+    // Decodes source image, builds its mip chain and compresses every level. Without color compression
+    // color textures stay uncompressed RGBA. Returns false if image can't be decoded. Doesn't touch GL,
+    // so it runs on loading threads or offline.
+    static bool cook(const std::string& sourcePath, TextureUsage usage, bool colorCompression, CookedTexture& result);
+
+    // Returns false if cache can't be written
+    static bool write(const std::string& sourcePath, TextureUsage usage, bool colorCompression, const CookedTexture& texture);
+
+private:
+    bool validate() const;
+
+    template <typename T>
+    const T* at(std::uint64_t offset) const { return reinterpret_cast<const T*>(m_file.getData() + offset); }
+
+private:
+    MappedFile m_file;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <Render/TextureCache.h>
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Identity of texture source: canonical path of its file(s), hash of their content and usage,
+// since the same image is encoded differently as color and as normal map or mask
+struct TextureKey
+{
+    std::string path;               // empty if file doesn't exist
+    std::uint64_t contentHash = 0;  // 0 if file can't be read
+    TextureUsage usage = TextureUsage::Color;
+};
+
+// Process-wide set of textures loaded from files, shared by all models and GL thread loaders.
+// Texture of the same usage is found by canonical path first, then by content hash, so copies of the
+// same image in different directories are loaded once. Users hold references and release them, texture
+// is deleted with the last one. Used from the GL thread only, keys can be made on any thread.
+class TextureRegistry
+{
+public:
+    // Deletes texture when its last reference is released, deleted through GL state cache if not given
+    using Deleter = std::function<void(GLuint)>;
+
+    TextureRegistry() = default;
+    TextureRegistry(const TextureRegistry&) = delete;
+    TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+    // Reads file to hash its content, can be called on any thread
+    static TextureKey makeKey(const std::string& path, TextureUsage usage = TextureUsage::Color);
+    // Key of texture made of several files (e.g. cubemap faces)
+    static TextureKey makeKey(const std::vector<std::string>& paths, TextureUsage usage = TextureUsage::Color);
+
+    // Returns texture of key with a reference added, 0 if it isn't loaded yet
+    GLuint acquire(const TextureKey& key);
+
+    // Registers texture loaded for key with one reference. size is its estimated video memory.
+    void add(const TextureKey& key, GLuint texture, std::size_t size, Deleter deleter = nullptr);
+
+    // Adds reference to texture got from acquire or add, false if it isn't registered
+    bool addReference(GLuint texture);
+
+    // Drops reference, texture is deleted with the last one. Unregistered textures are ignored.
+    void release(GLuint texture);
+
+    // Deletes all textures regardless of references, must be called while context still exists
+    void releaseAll();
+
+    std::size_t getTextureCount() const { return m_entries.size(); }
+    // Video memory of registered textures
+    std::size_t getLoadedBytes() const { return m_loadedBytes; }
+    // Video memory textures served by acquire would have taken as separate copies
+    std::size_t getSavedBytes() const { return m_savedBytes; }
+    // How many acquire calls were served by path and by content of another path
+    unsigned long long getPathHits() const { return m_pathHits; }
+    unsigned long long getContentHits() const { return m_contentHits; }
+
+private:
+    struct Entry
+    {
+        TextureKey key;
+        std::size_t size;
+        unsigned int references;
+        Deleter deleter;
+    };
+
+    void remove(GLuint texture, Entry& entry);
+
+    // Keys of lookup maps, textures of different usage never match
+    static std::string getPathKey(const TextureKey& key);
+    static std::uint64_t getContentKey(const TextureKey& key);
+
+    std::unordered_map<GLuint, Entry> m_entries;
+    std::unordered_map<std::string, GLuint> m_byPath;
+    std::unordered_map<std::uint64_t, GLuint> m_byContent;
+    std::size_t m_loadedBytes = 0;
+    std::size_t m_savedBytes = 0;
+    unsigned long long m_pathHits = 0;
+    unsigned long long m_contentHits = 0;
+};
+
+TextureRegistry& getTextureRegistry();
+
+#endif
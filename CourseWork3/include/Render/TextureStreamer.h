@@ -0,0 +1,183 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <Render/TextureCache.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Loads textures in background. Requested texture is created at once as 1x1 placeholder of given
+// color, image files are decoded by own threads (not by the job system, whose waiting thread would
+// pick up long decodes in the middle of a frame) and uploaded through a ring of pixel buffers with
+// a byte budget per frame. Uploaded image respecifies the same texture object, so ids copied to
+// meshes stay valid and textures fill in progressively.
+//
+// Mip levels are streamed as well. Decode threads build the whole mip chain, which stays in system
+// memory, but only the tail (levels up to TAIL_SIZE) is uploaded at first. Renderer reports the
+// finest level every texture needs (recordUse), finer levels are then uploaded one per texture per
+// frame and GL_TEXTURE_BASE_LEVEL is moved to them. Video memory of all levels is kept within budget:
+// levels finer than needed (or of textures not used lately) are released when room is needed, and
+// textures wait blurry when there is nothing to release.
+//
+// With cooking (default) images are loaded through TextureCache: mip chains are block compressed
+// for their usage once and cached next to the image, later runs upload levels straight from the
+// mapped cache and need about a quarter (BC3, BC5) or an eighth (BC1, BC4) of video memory.
+class TextureStreamer
+{
+public:
+    static constexpr std::size_t DEFAULT_FRAME_BUDGET = 8 * 1024 * 1024;
+    static constexpr std::size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+    static constexpr unsigned int UPLOAD_BUFFERS = 4;
+    // Levels of at most that size are always resident
+    static constexpr int TAIL_SIZE = 64;
+    // Texture not used for that many frames keeps only its tail, once its levels are needed elsewhere
+    static constexpr unsigned long long KEEP_FRAMES = 120;
+
+    // decodeThreads 0 uses half of hardware threads, the rest is left to the job system.
+    // At least one upload is done per frame even if it exceeds frameBudget.
+    explicit TextureStreamer(unsigned int decodeThreads = 0, std::size_t frameBudget = DEFAULT_FRAME_BUDGET,
+        std::size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Returns placeholder texture which is replaced by the image later, must be called on the GL thread.
+    // Texture stays placeholder if the file can't be decoded. Usage selects compressed format when cooking.
+    GLuint request(const std::string& path, glm::vec4 placeholder, TextureUsage usage = TextureUsage::Color);
+
+    // Uploads decoded images and needed mip levels within the budgets, called once per frame on the GL thread
+    void update();
+
+    // Deletes requested texture, its decode is dropped if it is still in progress. GL thread only.
+    void release(GLuint texture);
+
+    // Records that texture is sampled in this frame with one pixel covering that many texture
+    // coordinate units. Unknown textures are ignored. GL thread only.
+    void recordUse(GLuint texture, float texCoordsPerPixel);
+
+    // Without mip streaming every texture gets all its levels and memory budget is ignored
+    void setMipStreaming(bool enabled) { m_mipStreaming = enabled; }
+    bool isMipStreaming() const { return m_mipStreaming; }
+
+    // Without cooking images are decoded and uploaded uncompressed every run, affects later requests
+    void setCooking(bool enabled) { m_cooking = enabled; }
+    bool isCooking() const { return m_cooking; }
+
+    // Textures requested but not uploaded yet
+    std::size_t getPendingCount() const { return m_requested.size(); }
+    unsigned long long getUploadedCount() const { return m_uploaded; }
+
+    // Estimated video memory of resident levels (uncompressed RGB counted as RGBA)
+    std::size_t getResidentBytes() const { return m_residentBytes; }
+    // The same with all levels of every texture resident
+    std::size_t getFullBytes() const { return m_fullBytes; }
+
+private:
+    // Ticket tells request from a later one which got the same (deleted and reused) texture id
+    struct Request
+    {
+        GLuint texture;
+        std::uint64_t ticket;
+        std::string path;
+        TextureUsage usage;
+        bool cook;
+    };
+
+    struct MipLevel
+    {
+        int width;
+        int height;
+        std::size_t offset;     // in data of texture
+        std::size_t size;
+        std::size_t videoSize;
+    };
+
+    struct StreamedTexture
+    {
+        GLuint texture = 0;
+        std::uint64_t ticket = 0;
+        std::string path;
+        GLenum internalFormat = 0;
+        GLenum pixelFormat = 0;             // of uncompressed levels
+        bool compressed = false;
+        std::vector<unsigned char> pixels;  // all levels one after another, the finest first
+        std::unique_ptr<TextureCache> cache;    // holds levels instead of pixels when loaded from cache
+        std::vector<MipLevel> levels;
+        int tailLevel = 0;
+        int residentLevel = 0;              // the finest uploaded level
+        int wantedLevel = 0;                // the finest level recorded in usedFrame
+        unsigned long long usedFrame = 0;
+    };
+
+    struct UploadBuffer
+    {
+        GLuint buffer = 0;
+        GLsizeiptr size = 0;
+        GLsync fence = nullptr;     // set while GPU may still read the buffer
+    };
+
+    void decodeLoop();
+    // Fill format and levels of texture, false if image can't be decoded
+    bool loadImage(StreamedTexture& texture) const;
+    bool loadCooked(StreamedTexture& texture, TextureUsage usage) const;
+
+    // Finest level texture should have now
+    int getTargetLevel(const StreamedTexture& texture) const;
+
+    void streamLevels(std::size_t& uploaded);
+
+    // Releases levels of other textures until size fits in memory budget, false if it can't
+    bool makeRoom(std::size_t size, std::size_t except);
+    void releaseLevel(StreamedTexture& texture);
+    // Frees storage of level of bound texture
+    void clearLevel(const StreamedTexture& texture, int level);
+
+    std::size_t getVideoSize(const StreamedTexture& texture, int level) const;
+
+    // false if GPU still reads the next buffer or frame budget is spent
+    bool canUpload(std::size_t size, std::size_t uploaded);
+    // Uploads levels [first, last) through the next buffer
+    void upload(const StreamedTexture& texture, int first, int last);
+
+    std::size_t m_frameBudget;
+    std::size_t m_memoryBudget;
+    bool m_mipStreaming = true;
+    bool m_cooking = true;
+    bool m_colorCompression = false;    // S3TC is supported, read by decode threads
+    std::vector<std::thread> m_threads;
+
+    // Shared with decode threads
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::deque<Request> m_requests;
+    std::deque<StreamedTexture> m_decoded;
+    bool m_stopping = false;
+
+    // GL thread only
+    std::unordered_map<GLuint, std::uint64_t> m_requested;     // textures waiting for image, by ticket
+    std::uint64_t m_nextTicket = 1;
+    std::deque<StreamedTexture> m_ready;
+    std::vector<StreamedTexture> m_textures;
+    std::unordered_map<GLuint, std::size_t> m_textureIndices;   // texture id to index in m_textures
+    UploadBuffer m_buffers[UPLOAD_BUFFERS];
+    unsigned int m_nextBuffer = 0;
+    bool m_uploading = false;   // unpack state is changed in this update
+    unsigned long long m_frame = 0;
+    unsigned long long m_uploaded = 0;
+    std::size_t m_residentBytes = 0;
+    std::size_t m_fullBytes = 0;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <Aliases.h>
+#include <Core/Span.h>
+#include <Geometry/Bvh.h>
+#include <Geometry/Frustum.h>
+#include <Scene/SceneGraph.h>
+#include <Scene/TransformStore.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Holds all scene data: models, objects and lights.
+// Everything is stored in dense pools addressed by generational handles, so adding and
+// removing is O(1) and renderer iterates packed arrays. Object with dense index i has its
+// transform at index i of TransformStore.
+// Every mesh drawn by scene graph node is a mesh instance. Instances are indexed by BVH over
+// their world bounds, which is used for visibility and shadow caster queries and ray casts.
+class Scene
+{
+public:
+    struct MeshInstance
+    {
+        SceneGraph::NodeId node;
+        ModelHandle model;
+        std::uint32_t mesh;     // index in Model::meshes
+        AABB localBounds;
+        AABB worldBounds;
+    };
+
+    Scene();
+
+    ModelHandle addModel(Model model);
+
+    // Removes model together with all objects which use it
+    void removeModel(ModelHandle handle);
+
+    // Returns handle of model loaded from given directory or null handle
+    ModelHandle findModel(const std::string& directory) const;
+
+    Model* getModel(ModelHandle handle) { return m_models.get(handle); }
+    const Model* getModel(ModelHandle handle) const { return m_models.get(handle); }
+
+    // Adds object as child of parent object (or as root object if parent is null handle)
+    ObjectHandle addObject(const Object& object, ObjectHandle parent = ObjectHandle());
+
+    // Removes object, its child objects are attached to its parent
+    void removeObject(ObjectHandle handle);
+
+    Object* getObject(ObjectHandle handle) { return m_objects.get(handle); }
+
+    void setParent(ObjectHandle handle, ObjectHandle parent);
+
+    void setPosition(ObjectHandle handle, glm::vec3 position);
+    void setRotation(ObjectHandle handle, glm::vec3 rotation);
+    void setScale(ObjectHandle handle, glm::vec3 scale);
+
+    PointLightHandle addPointLight(const PointLight& light) { return m_pointLights.add(light); }
+    SpotLightHandle addSpotLight(const SpotLight& light) { return m_spotLights.add(light); }
+    DirectionalLightHandle addDirectionalLight(const DirectionalLight& light) { return m_directionalLights.add(light); }
+
+    void removePointLight(PointLightHandle handle) { m_pointLights.remove(handle); }
+    void removeSpotLight(SpotLightHandle handle) { m_spotLights.remove(handle); }
+    void removeDirectionalLight(DirectionalLightHandle handle) { m_directionalLights.remove(handle); }
+
+    // Propagates changed object transforms to the scene graph and updates BVH of mesh instances.
+    // Transform composition and instance bounds are computed on job system if it is given.
+    void update(JobSystem* jobs = nullptr);
+
+    const std::vector<MeshInstance>& getMeshInstances() const { return m_meshInstances; }
+    const Bvh& getBvh() const { return m_bvh; }
+
+    // Appends indices of mesh instances whose bounds intersect frustum
+    void queryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& result) const;
+
+    // Appends indices of mesh instances whose bounds intersect sphere, e.g. shadow casters of point light
+    void querySphere(glm::vec3 center, float radius, std::vector<std::uint32_t>& result) const;
+
+    // Returns index of the closest mesh instance hit by ray or -1, distance is set to hit distance.
+    // Meshes with triangle BVH are tested by triangles, others by their bounds.
+    int raycast(glm::vec3 origin, glm::vec3 direction, float& distance) const;
+
+    Models& getModels() { return m_models; }
+    Objects& getObjects() { return m_objects; }
+    PointLights& getPointLights() { return m_pointLights; }
+    SpotLights& getSpotLights() { return m_spotLights; }
+    DirectionalLights& getDirectionalLights() { return m_directionalLights; }
+    DirectionalLight& getSun() { return m_sun; }
+
+    // Packed arrays for renderer
+    Span<const Object> getObjectSpan() const { return m_objects.span(); }
+    Span<PointLight> getPointLightSpan() { return m_pointLights.span(); }
+    Span<SpotLight> getSpotLightSpan() { return m_spotLights.span(); }
+
+    const SceneGraph& getSceneGraph() const { return m_sceneGraph; }
+    const TransformStore& getTransforms() const { return m_transforms; }
+
+private:
+    Models m_models;
+    Objects m_objects;
+    PointLights m_pointLights;
+    SpotLights m_spotLights;
+    DirectionalLights m_directionalLights;
+    DirectionalLight m_sun;
+
+    TransformStore m_transforms;
+    SceneGraph m_sceneGraph;
+
+    std::vector<MeshInstance> m_meshInstances;
+    std::vector<AABB> m_instanceBounds;
+    Bvh m_bvh;
+    // Instances follow scene graph order, so instances of nodes [first, end) are
+    // [m_nodeInstances[first], m_nodeInstances[end])
+    std::vector<std::size_t> m_nodeInstances;
+    bool m_instancesDirty = false;      // instances were added, removed or reordered, BVH must be rebuilt
+
+private:
+    void rebuildMeshInstances();
+    void updateInstanceBounds(std::size_t first, std::size_t end, JobSystem* jobs = nullptr);
+};
+
+#endif
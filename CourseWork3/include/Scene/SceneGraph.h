@@ -0,0 +1,91 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <Objects/Model.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Transform hierarchy of the scene.
+// Nodes are kept in a flat array in depth-first order: every subtree occupies a contiguous
+// range [index, index + subtreeSize), and parent always precedes its children. This way
+// world transforms are propagated by a single forward pass, which touches only subtrees
+// below nodes whose local transform has changed.
+// Nodes are addressed by NodeId, which stays valid while nodes are moved inside the array.
+class SceneGraph
+{
+public:
+    using NodeId = std::uint32_t;
+    static const NodeId INVALID_NODE;
+
+    SceneGraph() = default;
+
+    // Adds node as last child of parent (or as a new root if parent is INVALID_NODE)
+    NodeId addNode(NodeId parent, const glm::mat4& localTransform);
+
+    // Adds node for every node of model hierarchy below parent, returns id of model root node
+    NodeId instantiateModel(const Model& model, ModelHandle handle, NodeId parent, const glm::mat4& localTransform);
+
+    // Removes node together with its subtree
+    void removeNode(NodeId node);
+
+    // Moves node with its subtree under new parent (INVALID_NODE makes it a root)
+    void setParent(NodeId node, NodeId parent);
+
+    NodeId getParent(NodeId node) const;
+
+    void setLocalTransform(NodeId node, const glm::mat4& localTransform);
+
+    const glm::mat4& getLocalTransform(NodeId node) const { return m_local[m_idToIndex[node]]; }
+
+    const glm::mat4& getWorldMatrix(NodeId node) const { return m_world[m_idToIndex[node]]; }
+
+    const glm::mat3& getNormalMatrix(NodeId node) const { return m_normal[m_idToIndex[node]]; }
+
+    // Recomputes world transforms of dirty subtrees
+    void update();
+
+    // Index ranges [first, end) of subtrees recomputed by the last update()
+    const std::vector<std::pair<std::size_t, std::size_t>>& getUpdatedRanges() const { return m_updatedRanges; }
+
+    // Dense access in depth-first order, used by renderer to walk all nodes
+    std::size_t size() const { return m_local.size(); }
+    const glm::mat4& getWorldMatrixAt(std::size_t index) const { return m_world[index]; }
+    const glm::mat3& getNormalMatrixAt(std::size_t index) const { return m_normal[index]; }
+    ModelHandle getModelAt(std::size_t index) const { return m_model[index]; }
+    // Index of node in Model::nodes or -1 if node doesn't belong to model hierarchy
+    int getModelNodeAt(std::size_t index) const { return m_modelNode[index]; }
+    NodeId getIdAt(std::size_t index) const { return m_indexToId[index]; }
+
+private:
+    // Inserts node at position in arrays, fixes subtree sizes of ancestors and parent indices
+    std::size_t insertNode(int parentIndex, const glm::mat4& localTransform, ModelHandle model, int modelNode);
+
+    // Removes range of nodes [first, first + count) which must be a whole subtree
+    void eraseRange(std::size_t first, std::size_t count);
+
+    void updateIdsFrom(std::size_t first);
+
+    NodeId allocateId();
+
+private:
+    std::vector<glm::mat4> m_local;
+    std::vector<glm::mat4> m_world;
+    std::vector<glm::mat3> m_normal;
+    std::vector<int> m_parent;                  // index of parent node, -1 for roots
+    std::vector<std::uint32_t> m_subtreeSize;   // number of nodes in subtree including node itself
+    std::vector<bool> m_dirty;
+    std::vector<ModelHandle> m_model;
+    std::vector<int> m_modelNode;
+    std::vector<NodeId> m_indexToId;
+
+    std::vector<std::uint32_t> m_idToIndex;
+    std::vector<NodeId> m_freeIds;
+    bool m_hasDirtyNodes = false;
+    std::vector<std::pair<std::size_t, std::size_t>> m_updatedRanges;
+};
+
+#endif
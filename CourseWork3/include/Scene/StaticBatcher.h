@@ -0,0 +1,75 @@
+#ifndef STATIC_BATCHER_H
+#define STATIC_BATCHER_H
+
+#include <Core/JobSystem.h>
+#include <Geometry/AABB.h>
+#include <Objects/Model.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Merges geometry of objects which never move into a few large meshes.
+// Vertices of added models are transformed to world space and gathered per material. build()
+// splits triangles of every material into spatially coherent chunks (median splits along the
+// longest axis) and makes one mesh of every chunk, so merged geometry is still culled by chunk
+// bounds while thousands of small meshes become a few dozen draws.
+class StaticBatcher
+{
+public:
+    // Chunk is split while it has more triangles than that
+    static const std::size_t MAX_CHUNK_TRIANGLES = 16 * 1024;
+    // Chunks with fewer triangles are not split only to make them smaller in space
+    static const std::size_t MIN_CHUNK_TRIANGLES = 1024;
+    // Chunk is split while it is longer than that part of the bounds of all batched geometry
+    static constexpr float MAX_CHUNK_EXTENT = 0.25f;
+
+    // Adds all meshes of model placed with given world matrix
+    void add(const Model& model, const glm::mat4& transform);
+
+    // Returns model whose meshes are chunks of merged geometry in world space, all attached to its
+    // root node with identity transform. Batcher is empty after that.
+    // Jobs (if given) optimize and process chunks in parallel, meshes are created on calling thread.
+    Model build(const std::string& name, JobSystem* jobs = nullptr);
+
+    bool isEmpty() const { return m_materials.empty(); }
+    std::size_t getSourceMeshCount() const { return m_sourceMeshes; }
+
+    void clear();
+
+private:
+    // Geometry of all added meshes with the same material
+    struct MaterialGroup
+    {
+        std::vector<Texture> textures;
+        float opacityRatio;
+        float refractionRatio;
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+    };
+
+    // Geometry of one chunk, raw after splitting and processed before mesh creation
+    struct Chunk
+    {
+        const MaterialGroup* group;
+        ProcessedMeshData data;
+    };
+
+    // Splits triangles [begin, end) of group until chunks are small enough, adds chunk geometry.
+    // remap maps group vertices to chunk vertices, it is filled with UNUSED_VERTEX between chunks.
+    void buildChunks(const MaterialGroup& group, std::vector<std::uint32_t>& triangles, std::size_t begin, std::size_t end,
+        float maxExtent, std::vector<std::uint32_t>& remap, std::vector<Chunk>& chunks) const;
+    void addChunk(const MaterialGroup& group, const std::uint32_t* triangles, std::size_t count,
+        std::vector<std::uint32_t>& remap, std::vector<Chunk>& chunks) const;
+    glm::vec3 getCentroid(const MaterialGroup& group, std::uint32_t triangle) const;
+
+private:
+    std::map<unsigned int, MaterialGroup> m_materials;  // by material id
+    AABB m_bounds;
+    std::size_t m_sourceMeshes = 0;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <Core/AlignedAllocator.h>
+#include <Core/JobSystem.h>
+#include <Geometry/AABB.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Structure-of-arrays storage of object transforms.
+// Every component (position, rotation quaternion, scale, local bounds) lives in its own
+// aligned array, so world matrices, normal matrices and world-space bounds of all objects
+// are composed in SIMD batches by update().
+class TransformStore
+{
+public:
+    using Index = std::uint32_t;
+
+    TransformStore() = default;
+
+    // Adds transform, rotation is given in degrees as euler angles (same as in Object)
+    Index add(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, const AABB& localBounds);
+
+    // Removes transform by moving the last transform into its slot (swap and pop)
+    void remove(Index index);
+
+    void clear();
+
+    std::size_t size() const { return m_count; }
+
+    void setPosition(Index index, glm::vec3 position);
+    void setRotation(Index index, glm::vec3 rotation);
+    void setScale(Index index, glm::vec3 scale);
+    void setLocalBounds(Index index, const AABB& bounds);
+
+    glm::vec3 getPosition(Index index) const { return glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]); }
+    glm::vec3 getScale(Index index) const { return glm::vec3(m_scaleX[index], m_scaleY[index], m_scaleZ[index]); }
+
+    // Recomposes world matrices, normal matrices and world bounds if any transform has changed.
+    // Batches are split between threads of job system if it is given.
+    void update(JobSystem* jobs = nullptr);
+
+    bool isDirty() const { return m_dirty; }
+
+    // Indices of transforms changed (or moved into by remove) since clearChanged(), each listed once.
+    // Lets users of the results refresh only what changed.
+    const std::vector<Index>& getChanged() const { return m_changed; }
+    void clearChanged();
+
+    const glm::mat4& getWorldMatrix(Index index) const { return m_worldMatrices[index]; }
+
+    // Inverse transposed upper 3x3 part of world matrix
+    const glm::mat3& getNormalMatrix(Index index) const { return m_normalMatrices[index]; }
+
+    AABB getWorldBounds(Index index) const;
+
+    const glm::mat4* getWorldMatrices() const { return m_worldMatrices.data(); }
+    const glm::mat3* getNormalMatrices() const { return m_normalMatrices.data(); }
+
+    // World bounds in structure-of-arrays form (arrays are padded to SIMD width)
+    const float* getWorldMinX() const { return m_worldMinX.data(); }
+    const float* getWorldMinY() const { return m_worldMinY.data(); }
+    const float* getWorldMinZ() const { return m_worldMinZ.data(); }
+    const float* getWorldMaxX() const { return m_worldMaxX.data(); }
+    const float* getWorldMaxY() const { return m_worldMaxY.data(); }
+    const float* getWorldMaxZ() const { return m_worldMaxZ.data(); }
+
+private:
+    // Grows all arrays to hold at least count elements, rounded up to SIMD width
+    void reserve(std::size_t count);
+
+    // Writes neutral values into slot, so padding lanes never produce NaNs
+    void resetSlot(std::size_t index);
+
+    void moveSlot(std::size_t from, std::size_t to);
+
+    void markChanged(Index index);
+
+    void updateBatch(std::size_t first);
+
+private:
+    std::size_t m_count = 0;
+    std::size_t m_capacity = 0;
+    bool m_dirty = false;
+    std::vector<Index> m_changed;
+    std::vector<std::uint8_t> m_changedFlags;
+
+    // Local transform
+    AlignedVector<float> m_positionX, m_positionY, m_positionZ;
+    AlignedVector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+    AlignedVector<float> m_scaleX, m_scaleY, m_scaleZ;
+
+    // Model-space bounds as center and half extents
+    AlignedVector<float> m_centerX, m_centerY, m_centerZ;
+    AlignedVector<float> m_extentX, m_extentY, m_extentZ;
+
+    // Results
+    AlignedVector<glm::mat4> m_worldMatrices;
+    AlignedVector<glm::mat3> m_normalMatrices;
+    AlignedVector<float> m_worldMinX, m_worldMinY, m_worldMinZ;
+    AlignedVector<float> m_worldMaxX, m_worldMaxY, m_worldMaxZ;
+};
+
+#endif
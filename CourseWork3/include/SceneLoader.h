@@ -7,6 +7,9 @@
 #include <Objects/Model.h>
 #include <Objects/Object.h>
 #include <Aliases.h>
+#include <Core/JobSystem.h>
+#include <Scene/Scene.h>
+#include <Scene/StaticBatcher.h>
 
 #include <iostream>
 #include <vector>
@@ -14,7 +17,9 @@
 #include <sstream>
 #include <memory>
 
-//TODO: convert this to class Scene which holds all scene data: lights, models, objects, etc...
+// Reads lights and objects descriptions and fills Scene with them.
+// Every object is given by position, rotation and scale lines followed by model path line,
+// path followed by " static" marks object which never moves (its geometry is batched).
 class SceneLoader
 {
     static const glm::vec3::value_type  MIN_ALLOWED_POSITION;
@@ -23,14 +28,16 @@ class SceneLoader
     static const glm::vec3::value_type  MAX_ALLOWED_COLOR;
     static const float                  MIN_ALLOWED_DEGREES_ANGLE;
     static const float                  MAX_ALLOWED_DEGREES_ANGLE;
+    // ends model path of objects which never move, such objects are merged by StaticBatcher
+    static const std::string            STATIC_FLAG;
+    static const std::string            STATIC_BATCH_NAME;
 
 public:
 
     SceneLoader() = default;
 
-    void loadScene(std::string lightsDataPath, std::string modelsDataPath
-        , DirectionalLights& dirLights, PointLights& pointLights, SpotLights& m_spotLights
-        , Models& models, Objects& objects);
+    // Jobs (if given) are used to parse model files and to process static batch chunks
+    void loadScene(std::string lightsDataPath, std::string modelsDataPath, Scene& scene, JobSystem* jobs = nullptr);
 
 private:
 
@@ -38,8 +45,6 @@ private:
     PointLight loadPointLight(std::stringstream& lightData, bool& good);
     SpotLight loadSpotLight(std::stringstream& lightData, bool& good);
 
-    int getModelIndex(std::string path, const Models& modles);
-
     glm::vec3 getVec3(std::stringstream& data);   
 
     bool checkRangeVec3(glm::vec3 vector, double left, double right, string message);
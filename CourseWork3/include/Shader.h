@@ -3,6 +3,7 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <Render/GLStateCache.h>
 
 #include <string>
 #include <fstream>
@@ -14,14 +15,23 @@ class Shader
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // header, if given, replaces #version line of every stage, so one source can be compiled
+    // for different GLSL versions and with defines (e.g. "#version 430 core\n#define NAME\n")
+    // vertexInclude, if given, is a file inserted into vertex stage after its header (leading
+    // # lines), so declarations shared by several vertex shaders are kept in one place
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* header = nullptr,
+        const char* vertexInclude = nullptr);
+
+    // compute shader program (GL 4.3)
+    // ------------------------------------------------------------------------
+    explicit Shader(const char* computePath);
 
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        getGLState().useProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
@@ -35,6 +45,11 @@ public:
         glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
     }
     // ------------------------------------------------------------------------
+    void setUint(const std::string &name, unsigned int value) const
+    {
+        glUniform1ui(glGetUniformLocation(ID, name.c_str()), value);
+    }
+    // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
@@ -48,6 +63,10 @@ public:
     {
         glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
     }
+    void setIVec2(const std::string &name, int x, int y) const
+    {
+        glUniform2i(glGetUniformLocation(ID, name.c_str()), x, y);
+    }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
@@ -81,8 +100,20 @@ public:
     {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
+    // ------------------------------------------------------------------------
+    void setUniformBlockBinding(const std::string &name, unsigned int binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
 
 private:
+    // replaces the first line of source (#version directive) with header
+    static void applyHeader(std::string& code, const char* header);
+    // inserts include after leading preprocessor lines (#version, #define) of source
+    static void applyInclude(std::string& code, const std::string& include);
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type);
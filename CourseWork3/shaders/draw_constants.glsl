@@ -0,0 +1,39 @@
+// Per-draw constants of vertex shaders rendering DrawList draws, inserted by Shader after the
+// #version line (see DrawList.h, DrawConstants is the C++ side of this layout). Defines model
+// and normalMatrix, which loadDrawConstants() fills for the current vertex.
+#ifdef MULTI_DRAW_INDIRECT
+// per-draw constants of all draws of a pass (std430, matches DrawConstants). Index of the draw
+// comes from base instance of indirect command through instanced attribute.
+layout (location = 3) in uint aDrawId;
+struct DrawConstantsData
+{
+    mat4 model;
+    mat3 normalMatrix;
+    float opacityRatio;
+    float refractionRatio;
+};
+layout (std430, binding = 0) readonly buffer DrawConstants
+{
+    DrawConstantsData drawConstants[];
+};
+mat4 model;
+mat3 normalMatrix;
+
+void loadDrawConstants()
+{
+    model = drawConstants[aDrawId].model;
+    normalMatrix = drawConstants[aDrawId].normalMatrix;
+}
+#else
+// per-instance matrices of instanced draw, read from DrawConstants written by DrawList to ring buffer
+layout (location = 4) in mat4 aModel;
+layout (location = 8) in mat3 aNormalMatrix;
+mat4 model;
+mat3 normalMatrix;
+
+void loadDrawConstants()
+{
+    model = aModel;
+    normalMatrix = aNormalMatrix;
+}
+#endif
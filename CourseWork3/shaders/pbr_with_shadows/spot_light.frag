@@ -38,8 +38,6 @@ uniform sampler2D texture_albedo1;
 uniform sampler2D texture_normal1;
 uniform sampler2D texture_metallic1;
 uniform sampler2D texture_roughness1;
-uniform float opacityRatio;
-uniform float refractionRatio;
 
 uniform vec3 cameraPos;
 
@@ -61,7 +59,9 @@ vec3 gridSamplingDisk[20] = vec3[]
 
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(texture_normal1, TexCoords).xyz * 2.0 - 1.0;
+    // z is reconstructed, so two channel (BC5) and RGB normal maps both work
+    vec2 tangentXY = texture(texture_normal1, TexCoords).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(1.0 - dot(tangentXY, tangentXY), 0.0)));
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
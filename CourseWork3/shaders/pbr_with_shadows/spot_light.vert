@@ -11,11 +11,11 @@ out vec3 Normal;
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
-uniform mat3 normalMatrix;
 
+// model, normalMatrix and loadDrawConstants() are inserted from draw_constants.glsl
 void main()
 {
+    loadDrawConstants();
     TexCoords = aTexCoords; 
     WorldPos = vec3(model * vec4(aPos, 1.0));          
     Normal = normalMatrix * aNormal; // Fix normals in case of non-uniform model scaling
@@ -6,8 +6,6 @@ uniform sampler2D texture_albedo1;
 uniform sampler2D texture_normal1;
 uniform sampler2D texture_metallic1;
 uniform sampler2D texture_roughness1;
-uniform float opacityRatio;
-uniform float refractionRatio;
 
 uniform vec3 lightPos;
 uniform float far_plane;
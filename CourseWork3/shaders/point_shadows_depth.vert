@@ -3,9 +3,9 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 model;
-
+// model, normalMatrix and loadDrawConstants() are inserted from draw_constants.glsl
 void main()
 {
+    loadDrawConstants();
     gl_Position = model * vec4(aPos, 1.0);
 }
\ No newline at end of file
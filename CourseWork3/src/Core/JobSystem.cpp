@@ -0,0 +1,164 @@
+#include <Core/JobSystem.h>
+
+#include <chrono>
+
+namespace
+{
+    // Worker index of current thread in the system which owns it
+    thread_local const JobSystem* currentSystem = nullptr;
+    thread_local unsigned int currentIndex = 0;
+}
+
+JobSystem::JobSystem(unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int i = 0; i < threads; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    currentSystem = this;
+    currentIndex = 0;
+    for (unsigned int i = 1; i < threads; ++i)
+        m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_sleepCondition.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+
+    if (currentSystem == this)
+        currentSystem = nullptr;
+}
+
+void JobSystem::run(Job job, JobCounter* counter, JobCounter* dependency)
+{
+    if (counter)
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (dependency)
+    {
+        // Checked under the lock, so that finishing job either sees the continuation or
+        // this thread sees the counter already finished
+        std::lock_guard<std::mutex> lock(dependency->m_mutex);
+        if (dependency->m_pending.load(std::memory_order_acquire) > 0)
+        {
+            dependency->m_continuations.push_back({ std::move(job), counter });
+            return;
+        }
+    }
+
+    push({ std::move(job), counter });
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    Task task;
+    while (!counter.isDone())
+    {
+        if (pop(task))
+            execute(task);
+        else
+            std::this_thread::yield();
+    }
+
+    // Finishing job may still hold the counter lock, counter must not be destroyed before it's released
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::push(Task task)
+{
+    Worker& worker = *m_workers[currentWorker()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+    m_sleepCondition.notify_one();
+}
+
+bool JobSystem::pop(Task& task)
+{
+    unsigned int index = currentWorker();
+
+    // Own jobs are taken from the back
+    {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Jobs of other workers are stolen from the front
+    for (std::size_t offset = 1; offset < m_workers.size(); ++offset)
+    {
+        Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Task& task)
+{
+    task.job();
+    task.job = nullptr;
+
+    JobCounter* counter = task.counter;
+    if (!counter)
+        return;
+
+    std::vector<JobCounter::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(counter->m_continuations);
+    }
+    for (JobCounter::Continuation& continuation : continuations)
+        push({ std::move(continuation.job), continuation.counter });
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentSystem = this;
+    currentIndex = index;
+
+    Task task;
+    while (!m_stop)
+    {
+        if (pop(task))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCondition.wait_for(lock, std::chrono::milliseconds(1), [this]()
+        {
+            return m_stop || m_queued.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+unsigned int JobSystem::currentWorker() const
+{
+    // Threads outside of the system push to the queue of worker 0
+    return currentSystem == this ? currentIndex : 0;
+}
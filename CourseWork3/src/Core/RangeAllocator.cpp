@@ -0,0 +1,104 @@
+#include <Core/RangeAllocator.h>
+
+RangeAllocator::RangeAllocator(std::size_t capacity)
+{
+    grow(capacity);
+}
+
+std::size_t RangeAllocator::allocate(std::size_t size)
+{
+    if (size == 0)
+        return 0;
+
+    auto best = m_bySize.lower_bound(size);
+    if (best == m_bySize.end())
+        return INVALID;
+
+    std::size_t rangeSize = best->first;
+    std::size_t offset = best->second;
+    eraseFree(m_byOffset.find(offset));
+
+    // Rest of the range stays free
+    if (rangeSize > size)
+        insertFree(offset + size, rangeSize - size);
+
+    m_used += size;
+    return offset;
+}
+
+void RangeAllocator::free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+        return;
+
+    m_used -= size;
+
+    // Merge with free neighbours
+    auto next = m_byOffset.lower_bound(offset);
+    if (next != m_byOffset.end() && offset + size == next->first)
+    {
+        size += next->second;
+        eraseFree(next);
+    }
+
+    auto previous = m_byOffset.lower_bound(offset);
+    if (previous != m_byOffset.begin())
+    {
+        --previous;
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            eraseFree(previous);
+        }
+    }
+
+    insertFree(offset, size);
+}
+
+void RangeAllocator::grow(std::size_t capacity)
+{
+    if (capacity <= m_capacity)
+        return;
+
+    std::size_t oldCapacity = m_capacity;
+    m_capacity = capacity;
+
+    // Added space is treated as a freed range, so it is merged with free tail
+    m_used += capacity - oldCapacity;
+    free(oldCapacity, capacity - oldCapacity);
+}
+
+void RangeAllocator::clear()
+{
+    m_byOffset.clear();
+    m_bySize.clear();
+    m_used = 0;
+    if (m_capacity > 0)
+        insertFree(0, m_capacity);
+}
+
+std::size_t RangeAllocator::getLargestFreeRange() const
+{
+    return m_bySize.empty() ? 0 : m_bySize.rbegin()->first;
+}
+
+void RangeAllocator::insertFree(std::size_t offset, std::size_t size)
+{
+    m_byOffset.emplace(offset, size);
+    m_bySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFree(std::map<std::size_t, std::size_t>::iterator range)
+{
+    auto sizes = m_bySize.equal_range(range->second);
+    for (auto it = sizes.first; it != sizes.second; ++it)
+    {
+        if (it->second == range->first)
+        {
+            m_bySize.erase(it);
+            break;
+        }
+    }
+    m_byOffset.erase(range);
+}
@@ -0,0 +1,372 @@
+#include <Geometry/Bvh.h>
+
+#include <future>
+#include <thread>
+
+namespace
+{
+    const int BINS_NUMBER = 16;
+
+    // Ranges bigger than this are split between threads
+    const std::uint32_t PARALLEL_BUILD_THRESHOLD = 4096;
+
+    // Subtree is rebuilt if its surface area grew that many times since build
+    const float REBUILD_AREA_RATIO = 2.0f;
+
+    float surfaceArea(const AABB& box)
+    {
+        if (box.isEmpty())
+            return 0.0f;
+        glm::vec3 size = box.max - box.min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+}
+
+// Nodes built by one thread. Subtrees built in parallel get their own context and are
+// appended to parent context when finished.
+struct Bvh::BuildContext
+{
+    std::vector<Node> nodes;
+    std::vector<std::array<float, 4>> buildArea;
+    unsigned int availableThreads = 1;
+
+    std::uint32_t allocate()
+    {
+        nodes.emplace_back();
+        buildArea.emplace_back();
+        return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+
+    // Appends nodes of other context, returns offset of its first node
+    std::int32_t append(const BuildContext& other)
+    {
+        std::int32_t offset = static_cast<std::int32_t>(nodes.size());
+        for (Node node : other.nodes)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                if (node.count[i] > 0 && node.child[i] != LEAF)
+                    node.child[i] += offset;
+            }
+            nodes.push_back(node);
+        }
+        buildArea.insert(buildArea.end(), other.buildArea.begin(), other.buildArea.end());
+        return offset;
+    }
+};
+
+void Bvh::build(const std::vector<AABB>& bounds, unsigned int threads)
+{
+    clear();
+    if (bounds.empty())
+        return;
+
+    m_threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    m_primitiveBounds = bounds;
+    m_centroids.resize(bounds.size());
+    m_primitiveIndices.resize(bounds.size());
+    for (std::uint32_t i = 0; i < bounds.size(); ++i)
+    {
+        m_centroids[i] = bounds[i].isEmpty() ? glm::vec3(0.0f) : bounds[i].getCenter();
+        m_primitiveIndices[i] = i;
+    }
+
+    BuildContext context;
+    context.availableThreads = m_threads;
+
+    // Root is always an internal node, so that traversal can start from node 0.
+    // Nodes are allocated before their children, so buildRange puts root at index 0.
+    std::uint32_t count = static_cast<std::uint32_t>(bounds.size());
+    if (count <= MAX_LEAF_SIZE)
+    {
+        std::uint32_t root = context.allocate();
+        AABB box = rangeBounds(0, count);
+        setChild(context.nodes[root], 0, box, LEAF, 0, count);
+        for (int i = 1; i < 4; ++i)
+            setChild(context.nodes[root], i, AABB(), LEAF, 0, 0);
+        context.buildArea[root][0] = surfaceArea(box);
+    }
+    else
+    {
+        buildRange(context, 0, count, 0);
+    }
+
+    m_nodes = std::move(context.nodes);
+    m_buildArea = std::move(context.buildArea);
+    m_nodesAfterBuild = m_nodes.size();
+}
+
+void Bvh::refit(const std::vector<AABB>& bounds)
+{
+    m_primitiveBounds = bounds;
+
+    // Children are always stored after their parents, so reverse order visits children first
+    for (std::size_t n = m_nodes.size(); n > 0; --n)
+    {
+        Node& node = m_nodes[n - 1];
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.count[i] == 0)
+                continue;
+
+            AABB box;
+            if (node.child[i] == LEAF)
+            {
+                box = rangeBounds(node.first[i], node.first[i] + node.count[i]);
+            }
+            else
+            {
+                const Node& child = m_nodes[node.child[i]];
+                for (int j = 0; j < 4; ++j)
+                {
+                    if (child.count[j] > 0)
+                    {
+                        box.expand(glm::vec3(child.minX[j], child.minY[j], child.minZ[j]));
+                        box.expand(glm::vec3(child.maxX[j], child.maxY[j], child.maxZ[j]));
+                    }
+                }
+            }
+            setChild(node, i, box, node.child[i], node.first[i], node.count[i]);
+        }
+    }
+}
+
+void Bvh::update(const std::vector<AABB>& bounds)
+{
+    if (bounds.size() != m_primitiveIndices.size() || m_nodes.size() > 2 * m_nodesAfterBuild)
+    {
+        build(bounds, m_threads);
+        return;
+    }
+
+    refit(bounds);
+    rebuildDegradedSubtrees();
+}
+
+void Bvh::clear()
+{
+    m_nodes.clear();
+    m_buildArea.clear();
+    m_primitiveIndices.clear();
+    m_primitiveBounds.clear();
+    m_centroids.clear();
+    m_nodesAfterBuild = 0;
+}
+
+void Bvh::rebuildDegradedSubtrees()
+{
+    for (std::uint32_t i = 0; i < m_primitiveBounds.size(); ++i)
+        m_centroids[i] = m_primitiveBounds[i].isEmpty() ? glm::vec3(0.0f) : m_primitiveBounds[i].getCenter();
+
+    // Top-down walk: once subtree is rebuilt, its new nodes don't need to be checked again
+    std::vector<std::int32_t> stack = { 0 };
+    while (!stack.empty())
+    {
+        std::int32_t index = stack.back();
+        stack.pop_back();
+        for (int i = 0; i < 4; ++i)
+        {
+            const Node& node = m_nodes[index];
+            if (node.count[i] == 0 || node.child[i] == LEAF)
+                continue;
+
+            AABB box(glm::vec3(node.minX[i], node.minY[i], node.minZ[i]), glm::vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+            if (surfaceArea(box) <= REBUILD_AREA_RATIO * m_buildArea[index][i])
+            {
+                stack.push_back(node.child[i]);
+                continue;
+            }
+
+            // Build subtree over the same primitive range and link it instead of the old one,
+            // old nodes stay in array until next full rebuild
+            std::uint32_t first = node.first[i];
+            std::uint32_t count = node.count[i];
+            BuildContext context;
+            context.availableThreads = 1;
+            std::int32_t child = buildRange(context, first, first + count, 1);
+            std::int32_t offset = static_cast<std::int32_t>(m_nodes.size());
+            for (Node& built : context.nodes)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    if (built.count[j] > 0 && built.child[j] != LEAF)
+                        built.child[j] += offset;
+                }
+            }
+            m_nodes.insert(m_nodes.end(), context.nodes.begin(), context.nodes.end());
+            m_buildArea.insert(m_buildArea.end(), context.buildArea.begin(), context.buildArea.end());
+
+            Node& parent = m_nodes[index];
+            std::int32_t newChild = child == LEAF ? LEAF : child + offset;
+            setChild(parent, i, rangeBounds(first, first + count), newChild, first, count);
+            m_buildArea[index][i] = surfaceArea(rangeBounds(first, first + count));
+        }
+    }
+}
+
+std::int32_t Bvh::buildRange(BuildContext& context, std::uint32_t begin, std::uint32_t end, unsigned int depth)
+{
+    if (end - begin <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+        return LEAF;
+
+    // Split range twice to get up to four children
+    std::uint32_t middle = partition(begin, end);
+    std::uint32_t ranges[5];
+    int rangesNumber = 0;
+    ranges[rangesNumber++] = begin;
+    if (middle - begin > MAX_LEAF_SIZE)
+        ranges[rangesNumber++] = partition(begin, middle);
+    ranges[rangesNumber++] = middle;
+    if (end - middle > MAX_LEAF_SIZE)
+        ranges[rangesNumber++] = partition(middle, end);
+    ranges[rangesNumber] = end;
+
+    std::uint32_t nodeIndex = context.allocate();
+    std::int32_t children[4];
+
+    bool parallel = context.availableThreads > 1 && end - begin > PARALLEL_BUILD_THRESHOLD;
+    if (parallel)
+    {
+        // Every child subtree gets its own context and share of remaining threads
+        unsigned int threadsPerChild = std::max(1u, context.availableThreads / rangesNumber);
+        std::vector<BuildContext> childContexts(rangesNumber);
+        std::vector<std::future<std::int32_t>> futures;
+        for (int i = 0; i < rangesNumber; ++i)
+        {
+            childContexts[i].availableThreads = threadsPerChild;
+            futures.push_back(std::async(std::launch::async, [this, &childContexts, &ranges, i, depth]()
+            {
+                return buildRange(childContexts[i], ranges[i], ranges[i + 1], depth + 1);
+            }));
+        }
+        for (int i = 0; i < rangesNumber; ++i)
+        {
+            std::int32_t child = futures[i].get();
+            std::int32_t offset = context.append(childContexts[i]);
+            children[i] = child == LEAF ? LEAF : child + offset;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < rangesNumber; ++i)
+            children[i] = buildRange(context, ranges[i], ranges[i + 1], depth + 1);
+    }
+
+    Node& node = context.nodes[nodeIndex];
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i < rangesNumber)
+        {
+            AABB box = rangeBounds(ranges[i], ranges[i + 1]);
+            setChild(node, i, box, children[i], ranges[i], ranges[i + 1] - ranges[i]);
+            context.buildArea[nodeIndex][i] = surfaceArea(box);
+        }
+        else
+        {
+            setChild(node, i, AABB(), LEAF, 0, 0);
+            context.buildArea[nodeIndex][i] = 0.0f;
+        }
+    }
+    return static_cast<std::int32_t>(nodeIndex);
+}
+
+std::uint32_t Bvh::partition(std::uint32_t begin, std::uint32_t end)
+{
+    AABB centroidBounds;
+    for (std::uint32_t i = begin; i < end; ++i)
+        centroidBounds.expand(m_centroids[m_primitiveIndices[i]]);
+
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestBin = 0;
+
+    // Binned SAH: primitives are distributed into bins by centroid, split candidates are bin borders
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float axisMin = centroidBounds.min[axis];
+        float axisExtent = centroidBounds.max[axis] - axisMin;
+        if (axisExtent <= 0.0f)
+            continue;
+
+        AABB binBounds[BINS_NUMBER];
+        std::uint32_t binCount[BINS_NUMBER] = {};
+        float scale = BINS_NUMBER / axisExtent;
+        for (std::uint32_t i = begin; i < end; ++i)
+        {
+            std::uint32_t primitive = m_primitiveIndices[i];
+            int bin = std::min(BINS_NUMBER - 1, static_cast<int>((m_centroids[primitive][axis] - axisMin) * scale));
+            ++binCount[bin];
+            binBounds[bin].expand(m_primitiveBounds[primitive]);
+        }
+
+        // Sweep from the right to accumulate right side areas
+        float rightArea[BINS_NUMBER];
+        std::uint32_t rightCount[BINS_NUMBER];
+        AABB accumulated;
+        std::uint32_t count = 0;
+        for (int bin = BINS_NUMBER - 1; bin > 0; --bin)
+        {
+            accumulated.expand(binBounds[bin]);
+            count += binCount[bin];
+            rightArea[bin] = surfaceArea(accumulated);
+            rightCount[bin] = count;
+        }
+
+        accumulated = AABB();
+        count = 0;
+        for (int bin = 0; bin < BINS_NUMBER - 1; ++bin)
+        {
+            accumulated.expand(binBounds[bin]);
+            count += binCount[bin];
+            float cost = surfaceArea(accumulated) * count + rightArea[bin + 1] * rightCount[bin + 1];
+            if (count > 0 && rightCount[bin + 1] > 0 && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    std::uint32_t* first = m_primitiveIndices.data() + begin;
+    std::uint32_t* last = m_primitiveIndices.data() + end;
+    std::uint32_t* middle;
+    if (bestAxis < 0)
+    {
+        // All centroids coincide, split by count
+        middle = first + (end - begin) / 2;
+    }
+    else
+    {
+        float axisMin = centroidBounds.min[bestAxis];
+        float scale = BINS_NUMBER / (centroidBounds.max[bestAxis] - axisMin);
+        middle = std::partition(first, last, [this, bestAxis, bestBin, axisMin, scale](std::uint32_t primitive)
+        {
+            int bin = std::min(BINS_NUMBER - 1, static_cast<int>((m_centroids[primitive][bestAxis] - axisMin) * scale));
+            return bin <= bestBin;
+        });
+    }
+    return static_cast<std::uint32_t>(middle - m_primitiveIndices.data());
+}
+
+AABB Bvh::rangeBounds(std::uint32_t begin, std::uint32_t end) const
+{
+    AABB box;
+    for (std::uint32_t i = begin; i < end; ++i)
+        box.expand(m_primitiveBounds[m_primitiveIndices[i]]);
+    return box;
+}
+
+void Bvh::setChild(Node& node, int slot, const AABB& bounds, std::int32_t child, std::uint32_t first, std::uint32_t count) const
+{
+    // Empty boxes are stored inverted, so they never pass intersection tests
+    node.minX[slot] = bounds.min.x;
+    node.minY[slot] = bounds.min.y;
+    node.minZ[slot] = bounds.min.z;
+    node.maxX[slot] = bounds.max.x;
+    node.maxY[slot] = bounds.max.y;
+    node.maxZ[slot] = bounds.max.z;
+    node.child[slot] = child;
+    node.first[slot] = first;
+    node.count[slot] = count;
+}
@@ -0,0 +1,722 @@
+#include <Geometry/MeshOptimizer.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    const std::uint32_t INVALID_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+    // Forsyth scoring parameters, cache model of the algorithm is LRU and bigger than the real one
+    const int FORSYTH_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    float getVertexScore(int cachePosition, std::uint32_t remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // Vertices of the last triangle get fixed score, so that the next triangle doesn't
+            // prefer them over the rest of cache
+            if (cachePosition < 3)
+                score = LAST_TRIANGLE_SCORE;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / float(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        // Vertices with few triangles left are finished first, so they leave the cache for good
+        score += VALENCE_BOOST_SCALE * std::pow(float(remainingTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // FIFO post-transform cache. Every miss loads one vertex and evicts the oldest one, so vertex
+    // is cached while fewer than cache size misses happened after it was loaded.
+    class CacheSimulation
+    {
+    public:
+        CacheSimulation(std::size_t vertexCount, unsigned int cacheSize) :
+            m_loadedAt(vertexCount, 0),
+            m_time(cacheSize),
+            m_cacheSize(cacheSize)
+        {
+        }
+
+        // Returns number of vertices of triangle which missed the cache
+        unsigned int access(const std::uint32_t* triangle)
+        {
+            unsigned int misses = 0;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t vertex = triangle[corner];
+                if (m_time - m_loadedAt[vertex] >= m_cacheSize)
+                {
+                    m_loadedAt[vertex] = m_time++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+
+        // Evicts all vertices
+        void flush() { m_time += m_cacheSize; }
+
+    private:
+        std::vector<std::size_t> m_loadedAt;
+        std::size_t m_time;
+        unsigned int m_cacheSize;
+    };
+
+    glm::vec3 getPosition(const void* vertices, std::size_t stride, std::uint32_t vertex)
+    {
+        glm::vec3 position;
+        std::memcpy(&position, static_cast<const char*>(vertices) + vertex * stride, sizeof(position));
+        return position;
+    }
+
+    std::uint32_t hashBytes(const char* data, std::size_t size)
+    {
+        // FNV-1a
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // Sum of squared distances to planes, weighted by triangle areas:
+    // error(p) = p^T A p + 2 b^T p + c, A is symmetric
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0;
+
+        void addPlane(glm::vec3 normal, float distance, float planeWeight)
+        {
+            double w = planeWeight;
+            a00 += w * normal.x * normal.x; a01 += w * normal.x * normal.y; a02 += w * normal.x * normal.z;
+            a11 += w * normal.y * normal.y; a12 += w * normal.y * normal.z; a22 += w * normal.z * normal.z;
+            b0 += w * normal.x * distance; b1 += w * normal.y * distance; b2 += w * normal.z * distance;
+            c += w * distance * distance;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Squared distance averaged over planes
+        float getError(glm::vec3 p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double error = x * (a00 * x + a01 * y + a02 * z) + y * (a01 * x + a11 * y + a12 * z) + z * (a02 * x + a12 * y + a22 * z)
+                + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? static_cast<float>(std::fabs(error) / weight) : 0.0f;
+        }
+    };
+
+    struct Collapse
+    {
+        std::uint32_t from;
+        std::uint32_t to;
+        float error;
+    };
+
+    // Maps every vertex to the first vertex with the same position
+    std::vector<std::uint32_t> buildPositionRemap(const void* vertices, std::size_t vertexCount, std::size_t stride)
+    {
+        const char* data = static_cast<const char*>(vertices);
+        std::size_t tableSize = 16;
+        while (tableSize < vertexCount * 2)
+            tableSize *= 2;
+        std::vector<std::uint32_t> table(tableSize, INVALID_INDEX);
+        std::vector<std::uint32_t> remap(vertexCount);
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            const char* position = data + i * stride;
+            std::size_t slot = hashBytes(position, sizeof(glm::vec3)) & (tableSize - 1);
+            while (table[slot] != INVALID_INDEX && std::memcmp(data + table[slot] * stride, position, sizeof(glm::vec3)) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == INVALID_INDEX)
+                table[slot] = static_cast<std::uint32_t>(i);
+            remap[i] = table[slot];
+        }
+        return remap;
+    }
+}
+
+namespace mesh
+{
+    VertexCacheStats analyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount, unsigned int cacheSize)
+    {
+        VertexCacheStats stats;
+        if (indexCount < 3)
+            return stats;
+
+        CacheSimulation cache(vertexCount, cacheSize);
+        std::vector<bool> used(vertexCount, false);
+        std::size_t usedCount = 0;
+        for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            stats.misses += cache.access(indices + i);
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                if (!used[indices[i + corner]])
+                {
+                    used[indices[i + corner]] = true;
+                    ++usedCount;
+                }
+            }
+        }
+        stats.acmr = float(stats.misses) / float(indexCount / 3);
+        stats.atvr = float(stats.misses) / float(usedCount);
+        return stats;
+    }
+
+    std::size_t weldVertices(void* vertices, std::size_t vertexCount, std::size_t stride, std::uint32_t* indices, std::size_t indexCount)
+    {
+        char* data = static_cast<char*>(vertices);
+
+        // Open addressing table of unique vertices, kept at most half full
+        std::size_t tableSize = 16;
+        while (tableSize < vertexCount * 2)
+            tableSize *= 2;
+        std::vector<std::uint32_t> table(tableSize, INVALID_INDEX);
+        std::vector<std::uint32_t> remap(vertexCount);
+
+        std::size_t unique = 0;
+        for (std::size_t i = 0; i < vertexCount; ++i)
+        {
+            const char* vertex = data + i * stride;
+            std::size_t slot = hashBytes(vertex, stride) & (tableSize - 1);
+            while (table[slot] != INVALID_INDEX && std::memcmp(data + table[slot] * stride, vertex, stride) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+
+            if (table[slot] == INVALID_INDEX)
+            {
+                // Unique vertices are compacted in place, destination was already read
+                if (unique != i)
+                    std::memcpy(data + unique * stride, vertex, stride);
+                table[slot] = static_cast<std::uint32_t>(unique++);
+            }
+            remap[i] = table[slot];
+        }
+
+        for (std::size_t i = 0; i < indexCount; ++i)
+            indices[i] = remap[indices[i]];
+        return unique;
+    }
+
+    void optimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount)
+    {
+        std::size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+            return;
+
+        // Triangles of every vertex, emitted triangles are moved past the end of vertex's range
+        std::vector<std::uint32_t> remaining(vertexCount, 0);
+        for (std::size_t i = 0; i < triangleCount * 3; ++i)
+            ++remaining[indices[i]];
+        std::vector<std::uint32_t> firstTriangle(vertexCount + 1, 0);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+        std::vector<std::uint32_t> vertexTriangles(triangleCount * 3);
+        std::vector<std::uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (std::size_t t = 0; t < triangleCount; ++t)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+                vertexTriangles[filled[indices[3 * t + corner]]++] = static_cast<std::uint32_t>(t);
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            vertexScore[v] = getVertexScore(-1, remaining[v]);
+
+        std::vector<float> triangleScore(triangleCount);
+        for (std::size_t t = 0; t < triangleCount; ++t)
+            triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+
+        std::vector<std::uint32_t> result;
+        result.reserve(triangleCount * 3);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<std::uint32_t> cache, newCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+        std::size_t best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+        std::size_t nextUnemitted = 0;
+        for (std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+        {
+            // No triangle touches cached vertices, restart from the next one in input order
+            if (best == INVALID_INDEX)
+            {
+                while (emitted[nextUnemitted])
+                    ++nextUnemitted;
+                best = nextUnemitted;
+            }
+
+            const std::uint32_t* triangle = indices + 3 * best;
+            result.insert(result.end(), triangle, triangle + 3);
+            emitted[best] = true;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t vertex = triangle[corner];
+                std::uint32_t* begin = vertexTriangles.data() + firstTriangle[vertex];
+                std::uint32_t* end = begin + remaining[vertex];
+                std::swap(*std::find(begin, end, static_cast<std::uint32_t>(best)), *(end - 1));
+                --remaining[vertex];
+            }
+
+            // Triangle vertices go to the front of LRU cache, the rest move back
+            newCache.assign(triangle, triangle + 3);
+            for (std::uint32_t vertex : cache)
+            {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                    newCache.push_back(vertex);
+            }
+            std::swap(cache, newCache);
+
+            // Scores change only for vertices which are or were in cache
+            best = INVALID_INDEX;
+            float bestScore = -1.0f;
+            for (std::size_t i = 0; i < cache.size(); ++i)
+            {
+                std::uint32_t vertex = cache[i];
+                cachePosition[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+                float score = getVertexScore(cachePosition[vertex], remaining[vertex]);
+                float delta = score - vertexScore[vertex];
+                vertexScore[vertex] = score;
+
+                const std::uint32_t* adjacent = vertexTriangles.data() + firstTriangle[vertex];
+                for (std::uint32_t j = 0; j < remaining[vertex]; ++j)
+                {
+                    std::uint32_t t = adjacent[j];
+                    triangleScore[t] += delta;
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+            if (cache.size() > FORSYTH_CACHE_SIZE)
+                cache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    void optimizeOverdraw(std::uint32_t* indices, std::size_t indexCount, const void* vertices, std::size_t vertexCount,
+        std::size_t stride, float threshold)
+    {
+        std::size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+            return;
+
+        // Hard boundaries are where cache optimized order starts over: all three vertices miss
+        CacheSimulation cache(vertexCount, VERTEX_CACHE_SIZE);
+        std::vector<std::size_t> hardBoundaries;
+        for (std::size_t t = 0; t < triangleCount; ++t)
+        {
+            if (cache.access(indices + 3 * t) == 3 || t == 0)
+                hardBoundaries.push_back(t);
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // Hard clusters are split further at points where ACMR of the part so far is within
+        // threshold of the whole cluster, the incomplete tail is merged with the last part
+        std::vector<std::size_t> boundaries;
+        for (std::size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+        {
+            std::size_t begin = hardBoundaries[c], end = hardBoundaries[c + 1];
+            cache.flush();
+            std::size_t clusterMisses = 0;
+            for (std::size_t t = begin; t < end; ++t)
+                clusterMisses += cache.access(indices + 3 * t);
+            float clusterThreshold = threshold * float(clusterMisses) / float(end - begin);
+
+            boundaries.push_back(begin);
+            cache.flush();
+            std::size_t misses = 0, triangles = 0;
+            for (std::size_t t = begin; t < end; ++t)
+            {
+                misses += cache.access(indices + 3 * t);
+                ++triangles;
+                if (float(misses) / float(triangles) <= clusterThreshold)
+                {
+                    boundaries.push_back(t + 1);
+                    cache.flush();
+                    misses = triangles = 0;
+                }
+            }
+            if (boundaries.back() != begin)
+                boundaries.pop_back();
+        }
+        boundaries.push_back(triangleCount);
+
+        // Clusters facing away from the mesh center are drawn first
+        std::size_t clusterCount = boundaries.size() - 1;
+        std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+        std::vector<float> areas(clusterCount, 0.0f);
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (std::size_t c = 0; c < clusterCount; ++c)
+        {
+            for (std::size_t t = boundaries[c]; t < boundaries[c + 1]; ++t)
+            {
+                glm::vec3 a = getPosition(vertices, stride, indices[3 * t]);
+                glm::vec3 b = getPosition(vertices, stride, indices[3 * t + 1]);
+                glm::vec3 d = getPosition(vertices, stride, indices[3 * t + 2]);
+                glm::vec3 normal = glm::cross(b - a, d - a);
+                float area = glm::length(normal);
+                centroids[c] += (a + b + d) * (area / 3.0f);
+                normals[c] += normal;
+                areas[c] += area;
+            }
+            meshCentroid += centroids[c];
+            meshArea += areas[c];
+            centroids[c] = areas[c] > 0.0f ? centroids[c] / areas[c] : centroids[c];
+        }
+        meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+        std::vector<float> sortKeys(clusterCount);
+        for (std::size_t c = 0; c < clusterCount; ++c)
+        {
+            float length = glm::length(normals[c]);
+            glm::vec3 normal = length > 0.0f ? normals[c] / length : normals[c];
+            sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normal);
+        }
+        std::vector<std::uint32_t> order(clusterCount);
+        for (std::size_t c = 0; c < clusterCount; ++c)
+            order[c] = static_cast<std::uint32_t>(c);
+        std::stable_sort(order.begin(), order.end(), [&sortKeys](std::uint32_t a, std::uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<std::uint32_t> result;
+        result.reserve(triangleCount * 3);
+        for (std::uint32_t c : order)
+            result.insert(result.end(), indices + 3 * boundaries[c], indices + 3 * boundaries[c + 1]);
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    std::size_t simplify(std::uint32_t* destination, const std::uint32_t* indices, std::size_t indexCount,
+        const void* vertices, std::size_t vertexCount, std::size_t stride,
+        std::size_t targetIndexCount, float targetError, float* resultError)
+    {
+        std::vector<std::uint32_t> result(indices, indices + indexCount / 3 * 3);
+        float maxError = 0.0f;
+
+        // Positions are scaled to unit bounds, so that errors don't depend on mesh size
+        glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+        for (std::uint32_t index : result)
+        {
+            glm::vec3 position = getPosition(vertices, stride, index);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+            }
+        }
+        float extent = result.empty() ? 0.0f : std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+        float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+        std::vector<glm::vec3> positions(vertexCount, glm::vec3(0.0f));
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            positions[v] = (getPosition(vertices, stride, static_cast<std::uint32_t>(v)) - boundsMin) * scale;
+
+        // Vertices with the same position are wedges of one position with different attributes
+        std::vector<std::uint32_t> remap = buildPositionRemap(vertices, vertexCount, stride);
+        std::vector<std::uint32_t> wedges(vertexCount, 0);
+        std::vector<bool> used(vertexCount, false);
+        for (std::uint32_t index : result)
+        {
+            if (!used[index])
+            {
+                used[index] = true;
+                ++wedges[remap[index]];
+            }
+        }
+
+        // Positions on attribute seams and open borders are never moved. Edge is on border if
+        // no triangle has it in opposite direction.
+        std::vector<bool> locked(vertexCount, false);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            locked[v] = wedges[v] > 1;
+        std::unordered_set<std::uint64_t> edges;
+        auto edgeKey = [&remap](std::uint32_t a, std::uint32_t b) { return (std::uint64_t(remap[a]) << 32) | remap[b]; };
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+                edges.insert(edgeKey(result[i + corner], result[i + (corner + 1) % 3]));
+        }
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t a = result[i + corner], b = result[i + (corner + 1) % 3];
+                if (edges.count(edgeKey(b, a)) == 0)
+                    locked[remap[a]] = locked[remap[b]] = true;
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            glm::vec3 p0 = positions[result[i]], p1 = positions[result[i + 1]], p2 = positions[result[i + 2]];
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            if (area == 0.0f)
+                continue;
+            normal = normal / area;
+            float distance = -glm::dot(normal, p0);
+            for (int corner = 0; corner < 3; ++corner)
+                quadrics[remap[result[i + corner]]].addPlane(normal, distance, area);
+        }
+
+        // Every pass collapses cheapest edges whose neighbourhoods don't overlap, then drops
+        // degenerate triangles
+        const float maxSquaredError = targetError * targetError;
+        std::vector<std::uint32_t> firstTriangle(vertexCount + 1), vertexTriangles;
+        std::vector<Collapse> collapses;
+        std::vector<std::uint32_t> collapseTarget(vertexCount);
+        std::vector<bool> passLocked(vertexCount);
+        while (result.size() > targetIndexCount)
+        {
+            std::size_t triangleCount = result.size() / 3;
+            std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+            for (std::uint32_t index : result)
+                ++firstTriangle[index + 1];
+            for (std::size_t v = 0; v < vertexCount; ++v)
+                firstTriangle[v + 1] += firstTriangle[v];
+            vertexTriangles.resize(result.size());
+            std::vector<std::uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+            for (std::size_t i = 0; i < result.size(); ++i)
+                vertexTriangles[filled[result[i]]++] = static_cast<std::uint32_t>(i / 3);
+
+            // Merged quadric is evaluated at the position vertex moves to
+            collapses.clear();
+            for (std::size_t i = 0; i < result.size(); ++i)
+            {
+                std::uint32_t from = result[i], to = result[i - i % 3 + (i + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction, std::swap(from, to))
+                {
+                    if (locked[remap[from]] || remap[from] == remap[to])
+                        continue;
+                    Quadric merged = quadrics[remap[from]];
+                    merged += quadrics[remap[to]];
+                    float error = merged.getError(positions[to]);
+                    if (error <= maxSquaredError)
+                        collapses.push_back({ from, to, error });
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+            // Collapse removes two triangles in closed mesh
+            std::size_t collapseLimit = std::max<std::size_t>((result.size() - targetIndexCount) / 6, 1);
+            std::size_t collapsed = 0;
+            for (std::size_t v = 0; v < vertexCount; ++v)
+                collapseTarget[v] = static_cast<std::uint32_t>(v);
+            std::fill(passLocked.begin(), passLocked.end(), false);
+            for (const Collapse& collapse : collapses)
+            {
+                if (collapsed >= collapseLimit)
+                    break;
+                if (passLocked[remap[collapse.from]] || passLocked[remap[collapse.to]])
+                    continue;
+
+                // Triangles which stay must not flip
+                bool flips = false;
+                const std::uint32_t* fan = vertexTriangles.data() + firstTriangle[collapse.from];
+                std::size_t fanSize = firstTriangle[collapse.from + 1] - firstTriangle[collapse.from];
+                for (std::size_t j = 0; j < fanSize && !flips; ++j)
+                {
+                    const std::uint32_t* triangle = result.data() + 3 * fan[j];
+                    glm::vec3 before[3], after[3];
+                    bool degenerates = false;
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        before[corner] = positions[triangle[corner]];
+                        after[corner] = triangle[corner] == collapse.from ? positions[collapse.to] : before[corner];
+                        degenerates = degenerates || remap[triangle[corner]] == remap[collapse.to];
+                    }
+                    if (degenerates)
+                        continue;
+                    glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    flips = glm::dot(normalBefore, normalAfter) <= 1e-2f * glm::length(normalBefore) * glm::length(normalAfter);
+                }
+                if (flips)
+                    continue;
+
+                collapseTarget[collapse.from] = collapse.to;
+                quadrics[remap[collapse.to]] += quadrics[remap[collapse.from]];
+                maxError = std::max(maxError, collapse.error);
+                ++collapsed;
+
+                // Neighbours of moved vertex can't move in this pass, their flip tests would be stale
+                for (std::size_t j = 0; j < fanSize; ++j)
+                {
+                    for (int corner = 0; corner < 3; ++corner)
+                        passLocked[remap[result[3 * fan[j] + corner]]] = true;
+                }
+            }
+            if (collapsed == 0)
+                break;
+
+            std::size_t written = 0;
+            for (std::size_t t = 0; t < triangleCount; ++t)
+            {
+                std::uint32_t a = collapseTarget[result[3 * t]];
+                std::uint32_t b = collapseTarget[result[3 * t + 1]];
+                std::uint32_t c = collapseTarget[result[3 * t + 2]];
+                if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+                    continue;
+                result[written++] = a;
+                result[written++] = b;
+                result[written++] = c;
+            }
+            result.resize(written);
+        }
+
+        std::copy(result.begin(), result.end(), destination);
+        if (resultError)
+            *resultError = std::sqrt(maxError);
+        return result.size();
+    }
+
+    std::vector<Meshlet> buildMeshlets(const std::uint32_t* indices, std::size_t indexCount,
+        const void* vertices, std::size_t vertexCount, std::size_t stride,
+        std::size_t maxVertices, std::size_t maxTriangles)
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<std::uint32_t> meshletOf(vertexCount, INVALID_INDEX);
+        std::size_t triangleCount = indexCount / 3;
+        std::size_t first = 0, meshletVertices = 0;
+        auto closeMeshlet = [&](std::size_t end)
+        {
+            Meshlet meshlet;
+            meshlet.firstIndex = static_cast<std::uint32_t>(first * 3);
+            meshlet.indexCount = static_cast<std::uint32_t>((end - first) * 3);
+
+            glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+            for (std::size_t i = first * 3; i < end * 3; ++i)
+            {
+                glm::vec3 position = getPosition(vertices, stride, indices[i]);
+                boundsMin = glm::min(boundsMin, position);
+                boundsMax = glm::max(boundsMax, position);
+            }
+            meshlet.center = (boundsMin + boundsMax) * 0.5f;
+            float radius = 0.0f;
+            for (std::size_t i = first * 3; i < end * 3; ++i)
+                radius = std::max(radius, glm::length(getPosition(vertices, stride, indices[i]) - meshlet.center));
+            meshlet.radius = radius;
+
+            // Cone around average normal, it is usable when all normals are within 90 degrees of it
+            std::vector<glm::vec3> normals;
+            glm::vec3 normalSum(0.0f);
+            for (std::size_t t = first; t < end; ++t)
+            {
+                glm::vec3 a = getPosition(vertices, stride, indices[3 * t]);
+                glm::vec3 b = getPosition(vertices, stride, indices[3 * t + 1]);
+                glm::vec3 c = getPosition(vertices, stride, indices[3 * t + 2]);
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float length = glm::length(normal);
+                if (length == 0.0f)
+                    continue;
+                normals.push_back(normal / length);
+                normalSum += normals.back();
+            }
+            float sumLength = glm::length(normalSum);
+            float minDot = 1.0f;
+            glm::vec3 axis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f);
+            for (const glm::vec3& normal : normals)
+                minDot = std::min(minDot, glm::dot(normal, axis));
+            if (sumLength == 0.0f || minDot <= 0.0f)
+            {
+                meshlet.coneAxis = glm::vec3(0.0f);
+                meshlet.coneCutoff = 1.0f;
+            }
+            else
+            {
+                // View direction within 90 - angle of the cone from its axis sees backs of all triangles
+                meshlet.coneAxis = axis;
+                meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+            meshlets.push_back(meshlet);
+        };
+
+        for (std::size_t t = 0; t < triangleCount; ++t)
+        {
+            std::uint32_t meshletIndex = static_cast<std::uint32_t>(meshlets.size());
+            std::size_t newVertices = 0;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t vertex = indices[3 * t + corner];
+                bool repeated = (corner > 0 && indices[3 * t] == vertex) || (corner > 1 && indices[3 * t + 1] == vertex);
+                if (meshletOf[vertex] != meshletIndex && !repeated)
+                    ++newVertices;
+            }
+            if (t > first && (meshletVertices + newVertices > maxVertices || t - first >= maxTriangles))
+            {
+                closeMeshlet(t);
+                first = t;
+                meshletVertices = 0;
+                meshletIndex = static_cast<std::uint32_t>(meshlets.size());
+            }
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t vertex = indices[3 * t + corner];
+                if (meshletOf[vertex] != meshletIndex)
+                {
+                    meshletOf[vertex] = meshletIndex;
+                    ++meshletVertices;
+                }
+            }
+        }
+        if (triangleCount > first)
+            closeMeshlet(triangleCount);
+        return meshlets;
+    }
+
+    std::size_t optimizeVertexFetch(void* vertices, std::size_t vertexCount, std::size_t stride, std::uint32_t* indices, std::size_t indexCount)
+    {
+        std::vector<std::uint32_t> remap(vertexCount, INVALID_INDEX);
+        std::uint32_t next = 0;
+        for (std::size_t i = 0; i < indexCount; ++i)
+        {
+            std::uint32_t& vertex = remap[indices[i]];
+            if (vertex == INVALID_INDEX)
+                vertex = next++;
+            indices[i] = vertex;
+        }
+
+        char* data = static_cast<char*>(vertices);
+        std::vector<char> source(data, data + vertexCount * stride);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+        {
+            if (remap[v] != INVALID_INDEX)
+                std::memcpy(data + remap[v] * stride, source.data() + v * stride, stride);
+        }
+        return next;
+    }
+}
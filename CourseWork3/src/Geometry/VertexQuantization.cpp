@@ -0,0 +1,59 @@
+#include <Geometry/VertexQuantization.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mesh
+{
+    std::uint16_t quantizeUnorm16(float value)
+    {
+        float clamped = std::min(std::max(value, 0.0f), 1.0f);
+        return static_cast<std::uint16_t>(std::lround(clamped * 65535.0f));
+    }
+
+    std::uint32_t packSnorm10(glm::vec3 value)
+    {
+        std::uint32_t packed = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            float clamped = std::min(std::max(value[i], -1.0f), 1.0f);
+            std::int32_t component = static_cast<std::int32_t>(std::lround(clamped * 511.0f));
+            packed |= (static_cast<std::uint32_t>(component) & 0x3FFu) << (10 * i);
+        }
+        return packed;
+    }
+
+    std::uint16_t floatToHalf(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+        std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+        // NaN stays NaN, infinity and values too big for half become infinity
+        if (magnitude > 0x7F800000u)
+            return sign | 0x7E00u;
+        if (magnitude >= 0x47800000u)
+            return sign | 0x7C00u;
+
+        // Too small even for half denormal
+        if (magnitude < 0x33000000u)
+            return sign;
+
+        std::int32_t exponent = static_cast<std::int32_t>(magnitude >> 23) - 127 + 15;
+        std::uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        // Normal half keeps 10 of 23 mantissa bits, denormal loses more
+        int shift = exponent > 0 ? 13 : 14 - exponent;
+        std::uint32_t result = exponent > 0
+            ? (static_cast<std::uint32_t>(exponent) << 10) | ((mantissa >> 13) & 0x3FFu)
+            : mantissa >> shift;
+
+        // Round to nearest even, carry into exponent is correct rounding as well
+        std::uint32_t rest = mantissa & ((1u << shift) - 1u);
+        std::uint32_t half = 1u << (shift - 1);
+        if (rest > half || (rest == half && (result & 1u)))
+            ++result;
+        return static_cast<std::uint16_t>(sign | result);
+    }
+}
@@ -1,7 +1,126 @@
 #include <Objects/Mesh.h>
+#include <Render/GLStateCache.h>
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 using namespace std;
 
+namespace
+{
+    // Initial size of the geometry arena, it grows when models need more
+    const size_t ARENA_VERTEX_CAPACITY = 1 << 20;
+    const size_t ARENA_INDEX_CAPACITY = 1 << 22;
+
+    // Every level of detail aims at half of triangles of the previous one, chain ends when
+    // simplification can't keep up with that or mesh gets small enough
+    const size_t MAX_LOD_COUNT = 5;
+    const size_t MIN_LOD_TRIANGLES = 64;
+    const float LOD_REDUCTION = 0.5f;
+    const float MIN_LOD_REDUCTION = 0.8f;
+    // Largest error of one simplification step relative to mesh size
+    const float MAX_LOD_STEP_ERROR = 0.05f;
+
+    VertexLayout vertexLayout = VertexLayout::Float;
+    bool arenaCreated = false;
+
+    // Called once when arena is created, layout can't change after that.
+    // Shaders read the same vec3 position, vec3 normal and vec2 texture coordinates from
+    // both layouts, quantized ones are converted by vertex fetch.
+    VertexFormat createArenaFormat()
+    {
+        arenaCreated = true;
+        if (vertexLayout == VertexLayout::Quantized)
+        {
+            return VertexFormat{
+                sizeof(QuantizedVertex),
+                {
+                    { 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(QuantizedVertex, Position) },
+                    { 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(QuantizedVertex, Normal) },
+                    { 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(QuantizedVertex, TexCoords) }
+                }
+            };
+        }
+        return VertexFormat{
+            sizeof(Vertex),
+            {
+                { 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position) },
+                { 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal) },
+                { 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords) }
+            }
+        };
+    }
+
+    // Every level of detail is simplified from the previous one, indices of levels after the full one
+    // are appended to lodIndices
+    vector<MeshLod> buildLods(const vector<Vertex>& vertices, const vector<unsigned int>& indices, const AABB& bounds,
+        vector<unsigned int>& lodIndices)
+    {
+        vector<MeshLod> lods(1, MeshLod{ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+        if (!Mesh::generateLods || indices.size() / 3 < 2 * MIN_LOD_TRIANGLES)
+            return lods;
+
+        glm::vec3 extent = bounds.max - bounds.min;
+        float size = std::max(std::max(extent.x, extent.y), extent.z);
+
+        // Errors of levels add up
+        vector<uint32_t> source(indices.begin(), indices.end());
+        vector<uint32_t> simplified(source.size());
+        float error = 0.0f;
+        while (lods.size() < MAX_LOD_COUNT && source.size() / 3 >= 2 * MIN_LOD_TRIANGLES)
+        {
+            size_t target = static_cast<size_t>(source.size() / 3 * LOD_REDUCTION) * 3;
+            float stepError = 0.0f;
+            size_t count = mesh::simplify(simplified.data(), source.data(), source.size(),
+                vertices.data(), vertices.size(), sizeof(Vertex), target, MAX_LOD_STEP_ERROR, &stepError);
+            if (count == 0 || count > source.size() * MIN_LOD_REDUCTION)
+                break;
+
+            mesh::optimizeVertexCache(simplified.data(), count, vertices.size());
+            error += stepError * size;
+            lods.push_back(MeshLod{ static_cast<unsigned int>(indices.size() + lodIndices.size()), static_cast<unsigned int>(count), error });
+            lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.begin() + count);
+            source.assign(simplified.begin(), simplified.begin() + count);
+        }
+        return lods;
+    }
+
+    // Fills arena layout of processed geometry. Float layout is uploaded from vertices and indices as they are.
+    void encodeForArena(ProcessedMeshData& data, const AABB& bounds)
+    {
+        if (vertexLayout == VertexLayout::Float)
+            return;
+
+        // Positions are stored relative to bounds, draws put decode transform before model matrix
+        glm::vec3 boundsMin = data.vertices.empty() ? glm::vec3(0.0f) : bounds.min;
+        glm::vec3 extent = data.vertices.empty() ? glm::vec3(0.0f) : bounds.max - bounds.min;
+        data.positionDecode = glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), extent);
+        glm::vec3 encodeScale;
+        for (int axis = 0; axis < 3; ++axis)
+            encodeScale[axis] = extent[axis] > 0.0f ? 1.0f / extent[axis] : 0.0f;
+
+        data.quantizedVertices.resize(data.vertices.size());
+        for (size_t i = 0; i < data.vertices.size(); ++i)
+        {
+            const Vertex& vertex = data.vertices[i];
+            QuantizedVertex& quantized = data.quantizedVertices[i];
+            glm::vec3 position = (vertex.Position - boundsMin) * encodeScale;
+            for (int axis = 0; axis < 3; ++axis)
+                quantized.Position[axis] = mesh::quantizeUnorm16(position[axis]);
+            quantized.Position[3] = 0;
+            quantized.Normal = mesh::packSnorm10(vertex.Normal);
+            quantized.TexCoords[0] = mesh::floatToHalf(vertex.TexCoords.x);
+            quantized.TexCoords[1] = mesh::floatToHalf(vertex.TexCoords.y);
+        }
+
+        if (data.vertices.size() <= numeric_limits<uint16_t>::max() + 1)
+            data.shortIndices.assign(data.indices.begin(), data.indices.end());
+    }
+}
+
 std::string to_string(TextureType type)
 {
     string result;
@@ -19,15 +138,65 @@ std::string to_string(TextureType type)
 }
 
 Mesh::Mesh(const vector<Vertex>& vertices, const vector<unsigned int>& indices, const vector<Texture>& textures):
-    _vertices(vertices),
-    _indices(indices),
     _textures(textures)
 {
+    ProcessedMeshData data = processGeometry(vertices, indices);
+    initialize(data.view());
+}
+
+Mesh::Mesh(const ProcessedGeometry& geometry, const vector<Texture>& textures):
+    _textures(textures)
+{
+    initialize(geometry);
+}
+
+void Mesh::initialize(const ProcessedGeometry& geometry)
+{
+    _vertices.assign(geometry.vertices, geometry.vertices + geometry.vertexCount);
+    _lods.assign(geometry.lods, geometry.lods + geometry.lodCount);
+    _meshlets.assign(geometry.meshlets, geometry.meshlets + geometry.meshletCount);
+    if (_lods.empty())
+        _lods.push_back(MeshLod{ 0, static_cast<unsigned int>(geometry.indexCount), 0.0f });
+    size_t fullIndexCount = _lods[0].indexCount;
+    _indices.assign(geometry.indices, geometry.indices + fullIndexCount);
+
+    for (const Vertex& vertex : _vertices)
+        _bounds.expand(vertex.Position);
+
+    // Ratio of texture and surface areas, square root turns it into ratio of lengths
+    double surfaceArea = 0.0;
+    double texCoordArea = 0.0;
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3)
+    {
+        const Vertex& a = _vertices[_indices[i]];
+        const Vertex& b = _vertices[_indices[i + 1]];
+        const Vertex& c = _vertices[_indices[i + 2]];
+        surfaceArea += 0.5 * glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position));
+        glm::vec2 ab = b.TexCoords - a.TexCoords;
+        glm::vec2 ac = c.TexCoords - a.TexCoords;
+        texCoordArea += 0.5 * std::abs(ab.x * ac.y - ab.y * ac.x);
+    }
+    if (surfaceArea > 0.0)
+        _texCoordDensity = static_cast<float>(std::sqrt(texCoordArea / surfaceArea));
+
+    updateMaterialId();
+
     // Set the vertex buffers and it's attribute pointers.
-    setupMesh();
+    setupMesh(geometry.arena);
 }
 
-void Mesh::Draw(Shader shader)
+void Mesh::Draw(Shader shader) const
+{
+    bindMaterial(shader);
+
+    // draw mesh
+    getGLState().bindVertexArray(getVAO());
+    glDrawElementsBaseVertex(GL_TRIANGLES, getIndexCount(), _geometry->indexType, _geometry->getIndexOffset(), _geometry->baseVertex);
+
+    unbindMaterial(shader);
+}
+
+void Mesh::bindMaterial(const Shader& shader) const
 {
     // Bind appropriate textures
 
@@ -45,7 +214,7 @@ void Mesh::Draw(Shader shader)
     //      and so on...
      for (unsigned int i = 0; i < _textures.size(); i++)
      {
-         glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+         getGLState().activeTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
                                            // retrieve texture number (the N in diffuse_textureN)
          unsigned int number;       
         
@@ -68,56 +237,213 @@ void Mesh::Draw(Shader shader)
          // Set the sampler to the correct texture unit           
          shader.setInt(to_string(_textures[i].type) + to_string(number), i);
          // Bind the texture
-         glBindTexture(GL_TEXTURE_2D, _textures[i].id);
+         getGLState().bindTexture(GL_TEXTURE_2D, _textures[i].id);
      }
     
     shader.setFloat("opacityRatio", _opacityRatio);
     shader.setFloat("refractionRatio", _refractionRatio);
+}
 
-    // draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, _indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
+void Mesh::unbindMaterial(const Shader& shader) const
+{
     // set textures to default
     for (unsigned int i = 0; i < _textures.size(); ++i)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        getGLState().activeTexture(GL_TEXTURE0 + i);
+        getGLState().bindTexture(GL_TEXTURE_2D, 0);
     }
 
     //set material properties to default
     shader.setFloat("opacityRatio", 0.0);
     shader.setFloat("refractionRatio", 0.0);
+}
+
+void Mesh::setOpacityRatio(float opacity)
+{
+    _opacityRatio = opacity;
+    updateMaterialId();
+}
+
+void Mesh::setRefractionRatio(float refraction)
+{
+    _refractionRatio = refraction;
+    updateMaterialId();
+}
+
+void Mesh::updateMaterialId()
+{
+    // Meshes with the same textures and material constants get the same id,
+    // so render queue can skip material binding between them
+    using MaterialDescription = tuple<vector<unsigned int>, float, float>;
+    static map<MaterialDescription, unsigned int> materials;
+    static mutex materialsMutex;
+
+    vector<unsigned int> textures;
+    for (const Texture& texture : _textures)
+        textures.push_back(texture.id);
+
+    lock_guard<mutex> lock(materialsMutex);
+    auto inserted = materials.emplace(MaterialDescription(textures, _opacityRatio, _refractionRatio), static_cast<unsigned int>(materials.size()));
+    _materialId = inserted.first->second;
+}
+
+void Mesh::buildTriangleBvh()
+{
+    vector<AABB> triangleBounds(_indices.size() / 3);
+    for (size_t i = 0; i < triangleBounds.size(); ++i)
+    {
+        triangleBounds[i].expand(_vertices[_indices[3 * i + 0]].Position);
+        triangleBounds[i].expand(_vertices[_indices[3 * i + 1]].Position);
+        triangleBounds[i].expand(_vertices[_indices[3 * i + 2]].Position);
+    }
+
+    auto bvh = make_shared<Bvh>();
+    bvh->build(triangleBounds);
+    _triangleBvh = bvh;
+}
+
+float Mesh::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance) const
+{
+    // Moller-Trumbore ray-triangle intersection
+    auto intersect = [this, origin, direction](uint32_t triangle, float maxDistance) -> float
+    {
+        const glm::vec3& a = _vertices[_indices[3 * triangle + 0]].Position;
+        const glm::vec3& b = _vertices[_indices[3 * triangle + 1]].Position;
+        const glm::vec3& c = _vertices[_indices[3 * triangle + 2]].Position;
+
+        glm::vec3 edge1 = b - a;
+        glm::vec3 edge2 = c - a;
+        glm::vec3 p = glm::cross(direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (std::abs(determinant) < 1e-8f)
+            return -1.0f;
+
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = origin - a;
+        float u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f)
+            return -1.0f;
+
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f)
+            return -1.0f;
+
+        float t = glm::dot(edge2, q) * inverseDeterminant;
+        return t >= 0.0f && t < maxDistance ? t : -1.0f;
+    };
+
+    float distance = maxDistance;
+    if (_triangleBvh)
+        return _triangleBvh->raycast(origin, direction, distance, intersect) >= 0 ? distance : -1.0f;
+
+    // Without triangle BVH only mesh bounds are tested. Inverse of zero component is finite as in
+    // Bvh::raycast, so origin on a slab plane gives 0 instead of NaN (0 / 0).
+    const float infinity = std::numeric_limits<float>::max();
+    glm::vec3 inverse(
+        direction.x != 0 ? 1.0f / direction.x : infinity,
+        direction.y != 0 ? 1.0f / direction.y : infinity,
+        direction.z != 0 ? 1.0f / direction.z : infinity
+    );
+    glm::vec3 t1 = (_bounds.min - origin) * inverse;
+    glm::vec3 t2 = (_bounds.max - origin) * inverse;
+    glm::vec3 tMin = glm::min(t1, t2);
+    glm::vec3 tMax = glm::max(t1, t2);
+    float tNear = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    float tFar = std::min(std::min(tMax.x, tMax.y), tMax.z);
+    return tNear <= tFar && tNear < maxDistance ? tNear : -1.0f;
+}
+
+pair<mesh::VertexCacheStats, mesh::VertexCacheStats> Mesh::optimizeGeometry(vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "mesh optimizer works with 32-bit indices");
+    // Vertices are compared byte by byte, so there must be no padding
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "vertex must be tightly packed");
+
+    uint32_t* triangles = reinterpret_cast<uint32_t*>(indices.data());
+    mesh::VertexCacheStats before = mesh::analyzeVertexCache(triangles, indices.size(), vertices.size());
 
-    glActiveTexture(GL_TEXTURE0); //set active texture to default
+    size_t vertexCount = mesh::weldVertices(vertices.data(), vertices.size(), sizeof(Vertex), triangles, indices.size());
+    mesh::optimizeVertexCache(triangles, indices.size(), vertexCount);
+    mesh::optimizeOverdraw(triangles, indices.size(), vertices.data(), vertexCount, sizeof(Vertex));
+    vertexCount = mesh::optimizeVertexFetch(vertices.data(), vertexCount, sizeof(Vertex), triangles, indices.size());
+    vertices.resize(vertexCount);
+
+    return make_pair(before, mesh::analyzeVertexCache(triangles, indices.size(), vertices.size()));
 }
 
-void Mesh::setupMesh()
+void Mesh::setVertexLayout(VertexLayout layout)
 {
-    // Create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    if (arenaCreated && layout != vertexLayout)
+    {
+        cout << "ERROR::MESH::VERTEX_LAYOUT_CHANGED_AFTER_ARENA_CREATION" << endl;
+        return;
+    }
+    vertexLayout = layout;
+}
 
-    glBindVertexArray(VAO);
-    // Load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(Vertex), &_vertices[0], GL_STATIC_DRAW);
+VertexLayout Mesh::getVertexLayout()
+{
+    return vertexLayout;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(unsigned int), &_indices[0], GL_STATIC_DRAW);
+size_t Mesh::getArenaVertexSize()
+{
+    return vertexLayout == VertexLayout::Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
 
-    // Set the vertex attribute pointers
-    // Positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // Normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // Texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+ProcessedGeometry ProcessedMeshData::view() const
+{
+    ArenaGeometry arena = { vertices.data(), vertices.size(), indices.data(), indices.size(), GL_UNSIGNED_INT, positionDecode };
+    if (!quantizedVertices.empty())
+        arena.vertices = quantizedVertices.data();
+    if (!shortIndices.empty())
+    {
+        arena.indices = shortIndices.data();
+        arena.indexType = GL_UNSIGNED_SHORT;
+    }
+    return ProcessedGeometry{ vertices.data(), vertices.size(), indices.data(), indices.size(),
+        lods.data(), lods.size(), meshlets.data(), meshlets.size(), arena };
+}
 
-    glBindVertexArray(0);
-}
\ No newline at end of file
+ProcessedMeshData Mesh::processGeometry(vector<Vertex> vertices, vector<unsigned int> indices)
+{
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "mesh optimizer works with 32-bit indices");
+    AABB bounds;
+    for (const Vertex& vertex : vertices)
+        bounds.expand(vertex.Position);
+
+    ProcessedMeshData result;
+    if (generateMeshlets)
+    {
+        result.meshlets = mesh::buildMeshlets(reinterpret_cast<const uint32_t*>(indices.data()), indices.size(),
+            vertices.data(), vertices.size(), sizeof(Vertex));
+        if (result.meshlets.size() < 2)
+            result.meshlets.clear();
+    }
+
+    // Levels of detail follow full mesh in one index range
+    vector<unsigned int> lodIndices;
+    result.lods = buildLods(vertices, indices, bounds, lodIndices);
+    result.indices = std::move(indices);
+    result.indices.insert(result.indices.end(), lodIndices.begin(), lodIndices.end());
+    result.vertices = std::move(vertices);
+    encodeForArena(result, bounds);
+    return result;
+}
+
+bool Mesh::generateLods = true;
+bool Mesh::generateMeshlets = true;
+
+GeometryArena& Mesh::getGeometryArena()
+{
+    static GeometryArena arena(createArenaFormat(), ARENA_VERTEX_CAPACITY, ARENA_INDEX_CAPACITY);
+    return arena;
+}
+
+void Mesh::setupMesh(const ArenaGeometry& geometry)
+{
+    _positionDecode = geometry.positionDecode;
+    _geometry = getGeometryArena().allocate(geometry.vertices, geometry.vertexCount, geometry.indices, geometry.indexCount,
+        geometry.indexType);
+}
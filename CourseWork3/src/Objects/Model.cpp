@@ -1,10 +1,186 @@
-
 #include <Objects/Model.h>
+#include <Objects/ModelCache.h>
+#include <Objects/ObjLoader.h>
+#include <Render/GLStateCache.h>
+#include <Render/TextureStreamer.h>
+
+#include <assimp/DefaultIOSystem.h>
+
+#include <algorithm>
+#include <chrono>
+
+bool Model::optimizeMeshes = true;
+bool Model::useGeometryCache = true;
+bool Model::useObjLoader = true;
+TextureStreamer* Model::textureStreamer = nullptr;
+
+namespace
+{
+    // Neutral values shown while streamed texture is loading
+    glm::vec4 placeholderColor(TextureType type)
+    {
+        switch (type)
+        {
+        case TextureType::Normal: return glm::vec4(0.5f, 0.5f, 1.0f, 1.0f);
+        case TextureType::Metallic: return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        case TextureType::Roughness: return glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+        default: return glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+        }
+    }
+
+    TextureUsage textureUsage(TextureType type)
+    {
+        switch (type)
+        {
+        case TextureType::Normal: return TextureUsage::Normal;
+        case TextureType::Metallic:
+        case TextureType::Roughness: return TextureUsage::Mask;
+        default: return TextureUsage::Color;
+        }
+    }
+
+    // File system of ASSIMP which remembers files opened besides the source one (materials, buffers)
+    class RecordingIOSystem : public Assimp::DefaultIOSystem
+    {
+    public:
+        RecordingIOSystem(const string& source, vector<string>& files) :
+            m_source(source),
+            m_files(files)
+        {
+        }
+
+        Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+        {
+            if (file != m_source && find(m_files.begin(), m_files.end(), file) == m_files.end())
+                m_files.push_back(file);
+            return DefaultIOSystem::Open(file, mode);
+        }
 
+    private:
+        string m_source;
+        vector<string>& m_files;
+    };
+}
 
-Model::Model(string const & path)
+Model::Model(string const & path, JobSystem* jobs) :
+    Model(import(path, jobs))
 {   
-    loadModel(path);
+}
+
+Model::Model(ModelImport && imported) :
+    directory(imported.directory)
+{
+    if (!imported.loaded)
+    {
+        cout << imported.error << endl;
+        glfwTerminate();
+        //cin.ignore();
+        cin.get();
+        exit(-1);
+    }
+    auto start = chrono::steady_clock::now();
+
+    // Textures loaded by other models (or by this one from another path) are shared
+    TextureRegistry& registry = getTextureRegistry();
+    for (TextureImage& image : imported.textures)
+    {
+        Texture texture;
+        texture.id = registry.acquire(image.key);
+        if (texture.id == 0 && textureStreamer)
+        {
+            TextureStreamer* streamer = textureStreamer;
+            texture.id = streamer->request(imported.directory + '/' + image.path, placeholderColor(image.type),
+                textureUsage(image.type));
+            registry.add(image.key, texture.id, image.videoSize, [streamer](GLuint id) { streamer->release(id); });
+        }
+        else if (texture.id == 0)
+        {
+            texture.id = uploadTexture(image);
+            registry.add(image.key, texture.id, image.videoSize);
+        }
+        texture.type = image.type;
+        texture.path = image.path;
+        textures_loaded.push_back(texture);
+        image.pixels.reset();
+    }
+
+    meshes.reserve(imported.meshes.size());
+    for (const ImportedMesh& mesh : imported.meshes)
+    {
+        vector<Texture> textures;
+        for (unsigned int texture : mesh.textures)
+            textures.push_back(textures_loaded[texture]);
+
+        Mesh result(mesh.getGeometry(), textures);
+        result.setOpacityRatio(mesh.opacity);
+        result.setRefractionRatio(mesh.refraction);
+        meshes.push_back(std::move(result));
+    }
+    nodes = std::move(imported.nodes);
+
+    cout << "MODEL::UPLOADED " << imported.path << " in " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+}
+
+Model::Model(string const & name, vector<Mesh> meshes) :
+    meshes(std::move(meshes)),
+    directory(name)
+{
+    ModelNode root;
+    root.name = name;
+    root.transform = glm::mat4(1.0f);
+    root.globalTransform = glm::mat4(1.0f);
+    root.parent = -1;
+    for (unsigned int i = 0; i < this->meshes.size(); ++i)
+    {
+        root.meshes.push_back(i);
+        // textures are shared with the models meshes came from
+        for (const Texture& texture : this->meshes[i].getTextures())
+        {
+            bool known = false;
+            for (const Texture& loaded : textures_loaded)
+                known = known || loaded.id == texture.id;
+            if (!known && getTextureRegistry().addReference(texture.id))
+                textures_loaded.push_back(texture);
+        }
+    }
+    nodes.push_back(root);
+}
+
+Model::~Model()
+{
+    releaseTextures();
+}
+
+Model::Model(Model && other) noexcept :
+    textures_loaded(std::move(other.textures_loaded)),
+    meshes(std::move(other.meshes)),
+    nodes(std::move(other.nodes)),
+    directory(std::move(other.directory)),
+    path(std::move(other.path))
+{
+    other.textures_loaded.clear();
+}
+
+Model& Model::operator=(Model && other) noexcept
+{
+    if (this != &other)
+    {
+        releaseTextures();
+        textures_loaded = std::move(other.textures_loaded);
+        other.textures_loaded.clear();
+        meshes = std::move(other.meshes);
+        nodes = std::move(other.nodes);
+        directory = std::move(other.directory);
+        path = std::move(other.path);
+    }
+    return *this;
+}
+
+void Model::releaseTextures()
+{
+    for (const Texture& texture : textures_loaded)
+        getTextureRegistry().release(texture.id);
+    textures_loaded.clear();
 }
 
 void Model::Draw(Shader shader)
@@ -13,50 +189,291 @@ void Model::Draw(Shader shader)
         meshes[i].Draw(shader);
 }
 
-void Model::loadModel(string const& path)
+AABB Model::getBounds() const
+{
+    AABB bounds;
+    for (const ModelNode& node : nodes)
+    {
+        for (unsigned int mesh : node.meshes)
+            bounds.expand(meshes[mesh].getBounds().transformed(node.globalTransform));
+    }
+    return bounds;
+}
+
+ModelImport Model::import(string const& path, JobSystem* jobs)
+{
+    auto start = chrono::steady_clock::now();
+    ModelImport result;
+    result.path = path;
+    // retrieve the directory path of the filepath
+    result.directory = path.substr(0, path.find_last_of('/'));
+
+    const char* source = "geometry cache";
+    bool cached = useGeometryCache && importCached(result);
+    if (!cached)
+    {
+        // .obj files are parsed by own loader, ASSIMP is left for other formats and files it can't parse
+        bool isObj = path.size() > 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+        source = "ObjLoader";
+        if (!(useObjLoader && isObj && importObj(result, jobs)))
+        {
+            source = "ASSIMP";
+            if (!importAssimp(result))
+                return result;
+        }
+        processMeshes(result, jobs);
+    }
+    identifyTextures(result, jobs);
+    if (!textureStreamer)
+        decodeTextures(result, jobs);
+    result.loaded = true;
+
+    if (useGeometryCache && !cached)
+        ModelCache::write(path, result);
+
+    ostringstream message;
+    message << "MODEL::IMPORTED " << path << " (" << source << ") in "
+            << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+    cout << message.str();
+    return result;
+}
+
+bool Model::importCached(ModelImport& result)
+{
+    auto cache = make_shared<ModelCache>();
+    if (!cache->open(result.path))
+        return false;
+
+    vector<ModelCache::CachedMaterial> materials;
+    vector<vector<unsigned int>> materialTextures;
+    for (size_t i = 0; i < cache->getMaterialCount(); ++i)
+    {
+        materials.push_back(cache->getMaterial(i));
+        materialTextures.emplace_back();
+        for (const auto& texture : materials.back().textures)
+            materialTextures.back().push_back(addTexture(result, texture.second, texture.first));
+    }
+
+    for (size_t i = 0; i < cache->getMeshCount(); ++i)
+    {
+        ModelCache::CachedMesh cachedMesh = cache->getMesh(i);
+        ImportedMesh mesh;
+        mesh.fromCache = true;
+        mesh.cached = cachedMesh.geometry;
+        mesh.textures = materialTextures[cachedMesh.material];
+        mesh.opacity = materials[cachedMesh.material].opacity;
+        mesh.refraction = materials[cachedMesh.material].refraction;
+        result.meshes.push_back(std::move(mesh));
+    }
+
+    for (size_t i = 0; i < cache->getNodeCount(); ++i)
+    {
+        ModelNode node = cache->getNode(i);
+        if (node.parent >= 0)
+            node.globalTransform = result.nodes[node.parent].globalTransform * node.transform;
+        result.nodes.push_back(std::move(node));
+    }
+    result.cache = cache;
+    return true;
+}
+
+bool Model::importObj(ModelImport& result, JobSystem* jobs)
+{
+    ObjModel obj;
+    if (!loadObj(result.path, obj, jobs))
+        return false;
+
+    // textures of materials used by meshes are ordered by type as processMesh orders them
+    const TextureType textureOrder[] = { TextureType::Albedo, TextureType::Metallic, TextureType::Normal, TextureType::Roughness };
+    vector<vector<unsigned int>> materialTextures(obj.materials.size());
+    vector<bool> materialUsed(obj.materials.size(), false);
+    for (const ObjMesh& mesh : obj.meshes)
+    {
+        if (materialUsed[mesh.material])
+            continue;
+        materialUsed[mesh.material] = true;
+        for (TextureType type : textureOrder)
+        {
+            for (const auto& texture : obj.materials[mesh.material].textures)
+            {
+                if (texture.first == type)
+                    materialTextures[mesh.material].push_back(addTexture(result, texture.second, type));
+            }
+        }
+    }
+
+    result.dependencies = obj.libraries;
+    result.meshes.reserve(obj.meshes.size());
+    for (ObjMesh& objMesh : obj.meshes)
+    {
+        const ObjMaterial& material = obj.materials[objMesh.material];
+        ImportedMesh mesh;
+        mesh.name = objMesh.name;
+        mesh.data.vertices = std::move(objMesh.vertices);
+        mesh.data.indices = std::move(objMesh.indices);
+        mesh.textures = materialTextures[objMesh.material];
+        mesh.opacity = material.opacity;
+        mesh.refraction = material.refraction;
+        result.meshes.push_back(std::move(mesh));
+    }
+
+    // the same hierarchy as ASSIMP builds: root node with a child node for every object
+    ModelNode root;
+    root.name = result.path.substr(result.path.find_last_of('/') + 1);
+    root.transform = glm::mat4(1.0f);
+    root.globalTransform = glm::mat4(1.0f);
+    root.parent = -1;
+    result.nodes.push_back(root);
+    for (const ObjObject& object : obj.objects)
+    {
+        ModelNode node = root;
+        node.name = object.name;
+        node.parent = 0;
+        node.meshes = object.meshes;
+        result.nodes.push_back(node);
+    }
+    return true;
+}
+
+bool Model::importAssimp(ModelImport& result)
 {
-    // read file via ASSIMP
+    // read file via ASSIMP, importer owns the file system
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate /*| aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices*/);
+    result.dependencies.clear();
+    importer.SetIOHandler(new RecordingIOSystem(result.path, result.dependencies));
+    const aiScene* scene = importer.ReadFile(result.path, aiProcess_Triangulate /*| aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices*/);
     // check for errors
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
     {
-        cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-        glfwTerminate();
-        //cin.ignore();
-        cin.get();
-        exit(-1);
+        result.error = string("ERROR::ASSIMP:: ") + importer.GetErrorString();
+        return false;
     }
-    // retrieve the directory path of the filepath
-    directory = path.substr(0, path.find_last_of('/'));
 
     // process ASSIMP's root node recursively
-    processNode(scene->mRootNode, scene);
+    map<unsigned int, unsigned int> processedMeshes;
+    processNode(scene->mRootNode, scene, -1, result, processedMeshes);
+    return true;
+}
+
+void Model::processMeshes(ModelImport& result, JobSystem* jobs)
+{
+    auto process = [&result](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            ImportedMesh& mesh = result.meshes[i];
+            vector<Vertex>& vertices = mesh.data.vertices;
+            vector<unsigned int>& indices = mesh.data.indices;
+            // optimize geometry for post-transform cache, overdraw and vertex fetch
+            if (optimizeMeshes && !indices.empty())
+            {
+                size_t sourceVertexCount = vertices.size();
+                auto stats = Mesh::optimizeGeometry(vertices, indices);
+                // whole line is written at once, since meshes are processed on several threads
+                ostringstream message;
+                message << "Mesh " << mesh.name << ": vertices " << sourceVertexCount << " -> " << vertices.size()
+                        << ", ACMR " << stats.first.acmr << " -> " << stats.second.acmr
+                        << ", ATVR " << stats.first.atvr << " -> " << stats.second.atvr << endl;
+                cout << message.str();
+            }
+            mesh.data = Mesh::processGeometry(std::move(vertices), std::move(indices));
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(0, result.meshes.size(), 1, process);
+    else
+        process(0, result.meshes.size());
+}
+
+void Model::identifyTextures(ModelImport& result, JobSystem* jobs)
+{
+    auto identify = [&result](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            TextureImage& image = result.textures[i];
+            string filename = result.directory + '/' + image.path;
+            image.key = TextureRegistry::makeKey(filename, textureUsage(image.type));
+            int width = 0, height = 0, components = 0;
+            if (stbi_info(filename.c_str(), &width, &height, &components))
+                image.videoSize = getTextureSize(width, height, components);
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(0, result.textures.size(), 1, identify);
+    else
+        identify(0, result.textures.size());
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::decodeTextures(ModelImport& result, JobSystem* jobs)
 {
+    auto decode = [&result](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            TextureImage& image = result.textures[i];
+            string filename = result.directory + '/' + image.path;
+            image.pixels.reset(stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0));
+            if (!image.pixels)
+            {
+                ostringstream message;
+                message << "Texture failed to load at path: " << image.path << endl;
+                cout << message.str();
+            }
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(0, result.textures.size(), 1, decode);
+    else
+        decode(0, result.textures.size());
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, int parent, ModelImport& result, map<unsigned int, unsigned int>& processedMeshes)
+{
+    // ASSIMP matrices are row-major, glm matrices are column-major
+    const aiMatrix4x4& m = node->mTransformation;
+    ModelNode modelNode;
+    modelNode.name = node->mName.C_Str();
+    modelNode.transform = glm::mat4(
+        glm::vec4(m.a1, m.b1, m.c1, m.d1),
+        glm::vec4(m.a2, m.b2, m.c2, m.d2),
+        glm::vec4(m.a3, m.b3, m.c3, m.d3),
+        glm::vec4(m.a4, m.b4, m.c4, m.d4)
+    );
+    modelNode.globalTransform = parent < 0 ? modelNode.transform : result.nodes[parent].globalTransform * modelNode.transform;
+    modelNode.parent = parent;
+
     // process each mesh located at the current node
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         // the node object only contains indices to index the actual objects in the scene. 
         // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        unsigned int meshIndex = node->mMeshes[i];
+        auto processed = processedMeshes.find(meshIndex);
+        if (processed == processedMeshes.end())
+        {
+            result.meshes.push_back(processMesh(scene->mMeshes[meshIndex], scene, result));
+            processed = processedMeshes.emplace(meshIndex, result.meshes.size() - 1).first;
+        }
+        modelNode.meshes.push_back(processed->second);
     }
+
+    int index = static_cast<int>(result.nodes.size());
+    result.nodes.push_back(modelNode);
+
     // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, index, result, processedMeshes);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+ImportedMesh Model::processMesh(aiMesh* mesh, const aiScene* scene, ModelImport& result)
 {
     // data to fill
     vector<Vertex> vertices;
     vector<unsigned int> indices;
-    vector<Texture> textures;
+    vector<unsigned int> textures;
 
     // Walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -104,84 +521,96 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];  
 
     // albedo maps
-    vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Albedo); // map_Kd in .mtl
+    vector<unsigned int> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Albedo, result); // map_Kd in .mtl
     textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
     // metallic maps
-    vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Metallic); // map_Ks in .mtl
+    vector<unsigned int> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Metallic, result); // map_Ks in .mtl
     textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     // normal maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal); // map_Bump in .mtl
+    vector<unsigned int> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal, result); // map_Bump in .mtl
     textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
     // roughness maps
-    std::vector<Texture> roughnessMaps = loadMaterialTextures(material, aiTextureType_NORMALS, TextureType::Roughness); // map_Kn in .mtl
+    vector<unsigned int> roughnessMaps = loadMaterialTextures(material, aiTextureType_NORMALS, TextureType::Roughness, result); // map_Kn in .mtl
     textures.insert(textures.end(), roughnessMaps.begin(), roughnessMaps.end());
 
-    Mesh result(vertices, indices, textures);
-    
     float opacity;
     material->Get(AI_MATKEY_OPACITY, opacity);
-    result.setOpacityRatio(opacity);
 
     float refraction;
     material->Get(AI_MATKEY_REFRACTI, refraction);
-    result.setRefractionRatio(refraction);
-    // return a mesh object created from the extracted mesh data
-    return result;
+    // return a mesh object created from the extracted mesh data, it is processed later
+    ImportedMesh imported;
+    imported.name = mesh->mName.C_Str();
+    imported.data.vertices = std::move(vertices);
+    imported.data.indices = std::move(indices);
+    imported.textures = std::move(textures);
+    imported.opacity = opacity;
+    imported.refraction = refraction;
+    return imported;
 }
 
-vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, TextureType typeName)
+vector<unsigned int> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, TextureType typeName, ModelImport& result)
 {
-    vector<Texture> textures;
+    vector<unsigned int> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true; // a texture with the same filepath has already been loaded, continue to next one.
-                break;
-            }
-        }
-        if (!skip)
-        {   // if texture hasn't been loaded already, load it
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure that there is no duplications.
-        }
+        textures.push_back(addTexture(result, str.C_Str(), typeName));
     }
     return textures;
 }
 
+unsigned int Model::addTexture(ModelImport& result, const string& path, TextureType typeName)
+{
+    // check if texture was added before and if so, return it: skip loading a new texture
+    auto added = result.textureIndices.emplace(path, static_cast<unsigned int>(result.textures.size()));
+    if (!added.second)
+        return added.first->second;
+    // if texture hasn't been added already, it is decoded with the others
+    TextureImage image;
+    image.path = path;
+    image.type = typeName;
+    result.textures.push_back(std::move(image));
+    return added.first->second;
+}
+
 unsigned int TextureFromFile(const char *path, const string &directory)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    TextureKey key = TextureRegistry::makeKey(filename);
+    unsigned int textureID = getTextureRegistry().acquire(key);
+    if (textureID != 0)
+        return textureID;
+
+    TextureImage image;
+    image.pixels.reset(stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0));
+    if (!image.pixels)
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    textureID = uploadTexture(image);
+    getTextureRegistry().add(key, textureID, getTextureSize(image.width, image.height, image.components));
+    return textureID;
+}
+
+unsigned int uploadTexture(const TextureImage &image)
+{
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    if (image.pixels)
     {
         GLenum format;
-        if (nrComponents == 1)
+        if (image.components == 1)
             format = GL_RED;
-        else if (nrComponents == 3)
+        else if (image.components == 3)
             format = GL_RGB;
-        else if (nrComponents == 4)
+        else if (image.components == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        getGLState().bindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -189,14 +618,14 @@ unsigned int TextureFromFile(const char *path, const string &directory)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        stbi_image_free(data);
-        glBindTexture(GL_TEXTURE_2D, 0);//set texture to default
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        getGLState().bindTexture(GL_TEXTURE_2D, 0);//set texture to default
     }
 
     return textureID;
-}
\ No newline at end of file
+}
+
+size_t getTextureSize(int width, int height, int components)
+{
+    size_t size = static_cast<size_t>(width) * height * (components == 3 ? 4 : components);
+    return size + size / 3;
+}
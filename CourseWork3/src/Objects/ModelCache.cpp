@@ -0,0 +1,596 @@
+#include <Objects/ModelCache.h>
+#include <Objects/Model.h>
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <type_traits>
+
+using namespace std;
+
+namespace
+{
+    const char MAGIC[8] = { 'C', 'W', '3', 'M', 'O', 'D', 'E', 'L' };
+    // Blobs are aligned for any vertex attribute and for SIMD loads
+    const size_t BLOB_ALIGNMENT = 16;
+
+    // Mesh processing options, cooked geometry depends on them
+    const uint32_t OPTION_OPTIMIZED = 1u << 0;
+    const uint32_t OPTION_LODS = 1u << 1;
+    const uint32_t OPTION_MESHLETS = 1u << 2;
+    // Arena layout of vertices and indices
+    const uint32_t OPTION_QUANTIZED = 1u << 3;
+
+    // All offsets are in bytes from the start of file
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t options;
+        uint64_t fileSize;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t sourceHash;
+        // Sizes of raw structures, so a change of them is noticed even without version bump
+        uint32_t vertexSize;
+        uint32_t lodSize;
+        uint32_t meshletSize;
+        uint32_t arenaVertexSize;
+        uint32_t meshCount;
+        uint32_t materialCount;
+        uint32_t textureCount;
+        uint32_t nodeCount;
+        uint32_t nodeMeshCount;
+        uint32_t dependencyCount;
+        uint64_t meshTable;
+        uint64_t materialTable;
+        uint64_t textureTable;
+        uint64_t nodeTable;
+        uint64_t nodeMeshTable;
+        uint64_t dependencyTable;
+        uint64_t strings;
+        uint64_t stringsSize;
+    };
+
+    struct MeshRecord
+    {
+        uint64_t vertices;
+        uint64_t indices;       // all levels of detail
+        uint64_t lods;
+        uint64_t meshlets;
+        uint64_t arenaVertices; // the same as vertices for float layout
+        uint64_t arenaIndices;  // the same as indices if they are 32-bit
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint32_t material;
+        uint32_t arenaIndexType;
+        float positionDecode[16];
+    };
+
+    struct MaterialRecord
+    {
+        float opacity;
+        float refraction;
+        uint32_t firstTexture;
+        uint32_t textureCount;
+    };
+
+    struct TextureRecord
+    {
+        uint32_t type;
+        uint32_t path;          // in strings
+        uint32_t pathLength;
+        uint32_t padding;
+    };
+
+    struct NodeRecord
+    {
+        float transform[16];    // column-major, relative to parent
+        int32_t parent;
+        uint32_t name;          // in strings
+        uint32_t nameLength;
+        uint32_t firstMesh;     // in node mesh table
+        uint32_t meshCount;
+        uint32_t padding;
+    };
+
+    // File read by import besides the source one, e.g. .mtl library of .obj
+    struct DependencyRecord
+    {
+        uint64_t size;
+        int64_t time;
+        uint64_t hash;
+        uint32_t path;          // in strings
+        uint32_t pathLength;
+        uint32_t exists;        // missing files are recorded too, since creating them changes the model
+        uint32_t padding;
+    };
+
+    static_assert(is_trivially_copyable<Vertex>::value && is_trivially_copyable<MeshLod>::value
+        && is_trivially_copyable<mesh::Meshlet>::value, "cooked structures are copied as bytes");
+
+    // Size and modification time identify source file cheaply, hash is checked only when time differs
+    struct SourceKey
+    {
+        uint64_t size;
+        int64_t time;
+    };
+
+    bool getSourceKey(const string& path, SourceKey& key)
+    {
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+            return false;
+        key.size = static_cast<uint64_t>(status.st_size);
+        key.time = static_cast<int64_t>(status.st_mtime);
+        return true;
+    }
+
+    // FNV-1a of file content, 0 if it can't be read
+    uint64_t hashFile(const string& path)
+    {
+        MappedFile file;
+        file.open(path);
+        return file.hash();
+    }
+
+    // File still exists (or is still missing) with the same size and time or, if only the time changed, content.
+    // In the latter case time is set to the current one.
+    bool isUnchanged(const string& path, bool existed, uint64_t size, int64_t& time, uint64_t hash)
+    {
+        SourceKey key;
+        if (!getSourceKey(path, key))
+            return !existed;
+        if (!existed || key.size != size)
+            return false;
+        if (key.time != time)
+        {
+            if (hashFile(path) != hash)
+                return false;
+            time = key.time;
+        }
+        return true;
+    }
+
+    // Overwrites modification times stored at given offsets of file
+    bool updateTimes(const string& path, const vector<pair<uint64_t, int64_t>>& times)
+    {
+        fstream file(path, ios::binary | ios::in | ios::out);
+        for (const auto& time : times)
+        {
+            file.seekp(static_cast<streamoff>(time.first));
+            file.write(reinterpret_cast<const char*>(&time.second), sizeof(time.second));
+        }
+        return static_cast<bool>(file);
+    }
+
+    uint32_t getOptions()
+    {
+        return (Model::optimizeMeshes ? OPTION_OPTIMIZED : 0u)
+            | (Mesh::generateLods ? OPTION_LODS : 0u)
+            | (Mesh::generateMeshlets ? OPTION_MESHLETS : 0u)
+            | (Mesh::getVertexLayout() == VertexLayout::Quantized ? OPTION_QUANTIZED : 0u);
+    }
+
+    size_t getIndexSize(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    // Appends blobs to a file image in memory
+    class FileBuilder
+    {
+    public:
+        uint64_t append(const void* data, size_t size, size_t alignment = BLOB_ALIGNMENT)
+        {
+            m_data.resize((m_data.size() + alignment - 1) / alignment * alignment);
+            uint64_t offset = m_data.size();
+            m_data.insert(m_data.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+            return offset;
+        }
+
+        template <typename T>
+        uint64_t append(const vector<T>& items)
+        {
+            return append(items.data(), items.size() * sizeof(T));
+        }
+
+        void overwrite(uint64_t offset, const void* data, size_t size)
+        {
+            memcpy(m_data.data() + offset, data, size);
+        }
+
+        const vector<unsigned char>& getData() const { return m_data; }
+
+    private:
+        vector<unsigned char> m_data;
+    };
+
+    // Range of count items of given size at offset lies within file and is aligned
+    bool isValidRange(uint64_t offset, uint64_t count, uint64_t size, uint64_t alignment, uint64_t fileSize)
+    {
+        return offset % alignment == 0 && offset <= fileSize && count <= (fileSize - offset) / size;
+    }
+
+    template <typename T>
+    bool isValidRange(uint64_t offset, uint64_t count, uint64_t fileSize)
+    {
+        return isValidRange(offset, count, sizeof(T), alignof(T), fileSize);
+    }
+}
+
+string ModelCache::getCachePath(const string& sourcePath)
+{
+    return sourcePath + ".cache";
+}
+
+bool ModelCache::open(const string& sourcePath)
+{
+    if (!m_file.open(getCachePath(sourcePath)))
+        return false;
+
+    if (!validate())
+    {
+        cout << "ERROR::MODEL_CACHE::INVALID_FILE " << getCachePath(sourcePath) << endl;
+        m_file.close();
+        return false;
+    }
+
+    // Files touched without changes (copied, checked out again) have their new times stored
+    vector<pair<uint64_t, int64_t>> touched;
+    const FileHeader& header = *at<FileHeader>(0);
+    int64_t time = header.sourceTime;
+    bool fresh = isUnchanged(sourcePath, true, header.sourceSize, time, header.sourceHash);
+    if (time != header.sourceTime)
+        touched.emplace_back(offsetof(FileHeader, sourceTime), time);
+    for (uint32_t i = 0; fresh && i < header.dependencyCount; ++i)
+    {
+        const DependencyRecord& dependency = at<DependencyRecord>(header.dependencyTable)[i];
+        time = dependency.time;
+        fresh = isUnchanged(getString(dependency.path, dependency.pathLength), dependency.exists != 0,
+            dependency.size, time, dependency.hash);
+        if (time != dependency.time)
+            touched.emplace_back(header.dependencyTable + i * sizeof(DependencyRecord) + offsetof(DependencyRecord, time), time);
+    }
+    if (!fresh || header.options != getOptions())
+    {
+        m_file.close();
+        return false;
+    }
+
+    // Without that every later open would hash them again. File is remapped after the update.
+    if (!touched.empty())
+    {
+        string cachePath = getCachePath(sourcePath);
+        m_file.close();
+        if (!updateTimes(cachePath, touched))
+            cout << "ERROR::MODEL_CACHE::FAILED_TO_WRITE " << cachePath << endl;
+        if (!m_file.open(cachePath) || !validate())
+        {
+            m_file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModelCache::validate() const
+{
+    uint64_t size = m_file.getSize();
+    if (size < sizeof(FileHeader))
+        return false;
+
+    const FileHeader& header = *at<FileHeader>(0);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.fileSize != size
+        || header.vertexSize != sizeof(Vertex) || header.lodSize != sizeof(MeshLod) || header.meshletSize != sizeof(mesh::Meshlet)
+        || header.arenaVertexSize != Mesh::getArenaVertexSize())
+        return false;
+
+    if (!isValidRange<MeshRecord>(header.meshTable, header.meshCount, size)
+        || !isValidRange<MaterialRecord>(header.materialTable, header.materialCount, size)
+        || !isValidRange<TextureRecord>(header.textureTable, header.textureCount, size)
+        || !isValidRange<NodeRecord>(header.nodeTable, header.nodeCount, size)
+        || !isValidRange<uint32_t>(header.nodeMeshTable, header.nodeMeshCount, size)
+        || !isValidRange<DependencyRecord>(header.dependencyTable, header.dependencyCount, size)
+        || !isValidRange<char>(header.strings, header.stringsSize, size))
+        return false;
+
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        const MeshRecord& record = at<MeshRecord>(header.meshTable)[i];
+        if (!isValidRange<Vertex>(record.vertices, record.vertexCount, size)
+            || !isValidRange<uint32_t>(record.indices, record.indexCount, size)
+            || !isValidRange<MeshLod>(record.lods, record.lodCount, size)
+            || !isValidRange<mesh::Meshlet>(record.meshlets, record.meshletCount, size)
+            || record.lodCount == 0 || record.material >= header.materialCount)
+            return false;
+
+        // 16-bit indices are only used for meshes they can address
+        bool shortIndices = record.arenaIndexType == GL_UNSIGNED_SHORT;
+        if ((!shortIndices && record.arenaIndexType != GL_UNSIGNED_INT) || (shortIndices && record.vertexCount > numeric_limits<uint16_t>::max() + 1u)
+            || !isValidRange(record.arenaVertices, record.vertexCount, header.arenaVertexSize, sizeof(uint32_t), size)
+            || !isValidRange(record.arenaIndices, record.indexCount, getIndexSize(record.arenaIndexType), getIndexSize(record.arenaIndexType), size))
+            return false;
+
+        const MeshLod* lods = at<MeshLod>(record.lods);
+        if (lods[0].firstIndex != 0)
+            return false;
+        for (uint32_t lod = 0; lod < record.lodCount; ++lod)
+        {
+            if (lods[lod].firstIndex > record.indexCount || lods[lod].indexCount > record.indexCount - lods[lod].firstIndex)
+                return false;
+        }
+        const mesh::Meshlet* meshlets = at<mesh::Meshlet>(record.meshlets);
+        for (uint32_t meshlet = 0; meshlet < record.meshletCount; ++meshlet)
+        {
+            if (meshlets[meshlet].firstIndex > lods[0].indexCount || meshlets[meshlet].indexCount > lods[0].indexCount - meshlets[meshlet].firstIndex)
+                return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.materialCount; ++i)
+    {
+        const MaterialRecord& record = at<MaterialRecord>(header.materialTable)[i];
+        if (record.firstTexture > header.textureCount || record.textureCount > header.textureCount - record.firstTexture)
+            return false;
+    }
+
+    for (uint32_t i = 0; i < header.textureCount; ++i)
+    {
+        const TextureRecord& record = at<TextureRecord>(header.textureTable)[i];
+        if (record.type > static_cast<uint32_t>(TextureType::Roughness)
+            || record.path > header.stringsSize || record.pathLength > header.stringsSize - record.path)
+            return false;
+    }
+
+    for (uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        const NodeRecord& record = at<NodeRecord>(header.nodeTable)[i];
+        // Parents precede their children
+        if (record.parent >= static_cast<int32_t>(i) || (record.parent < 0 && record.parent != -1)
+            || record.name > header.stringsSize || record.nameLength > header.stringsSize - record.name
+            || record.firstMesh > header.nodeMeshCount || record.meshCount > header.nodeMeshCount - record.firstMesh)
+            return false;
+        for (uint32_t mesh = 0; mesh < record.meshCount; ++mesh)
+        {
+            if (at<uint32_t>(header.nodeMeshTable)[record.firstMesh + mesh] >= header.meshCount)
+                return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.dependencyCount; ++i)
+    {
+        const DependencyRecord& record = at<DependencyRecord>(header.dependencyTable)[i];
+        if (record.path > header.stringsSize || record.pathLength > header.stringsSize - record.path)
+            return false;
+    }
+    return true;
+}
+
+size_t ModelCache::getMeshCount() const
+{
+    return at<FileHeader>(0)->meshCount;
+}
+
+ModelCache::CachedMesh ModelCache::getMesh(size_t index) const
+{
+    const MeshRecord& record = at<MeshRecord>(at<FileHeader>(0)->meshTable)[index];
+    CachedMesh result;
+    result.geometry.vertices = at<Vertex>(record.vertices);
+    result.geometry.vertexCount = record.vertexCount;
+    result.geometry.indices = at<unsigned int>(record.indices);
+    result.geometry.indexCount = record.indexCount;
+    result.geometry.lods = at<MeshLod>(record.lods);
+    result.geometry.lodCount = record.lodCount;
+    result.geometry.meshlets = at<mesh::Meshlet>(record.meshlets);
+    result.geometry.meshletCount = record.meshletCount;
+    result.geometry.arena.vertices = m_file.getData() + record.arenaVertices;
+    result.geometry.arena.vertexCount = record.vertexCount;
+    result.geometry.arena.indices = m_file.getData() + record.arenaIndices;
+    result.geometry.arena.indexCount = record.indexCount;
+    result.geometry.arena.indexType = record.arenaIndexType;
+    memcpy(&result.geometry.arena.positionDecode[0][0], record.positionDecode, sizeof(record.positionDecode));
+    result.material = record.material;
+    return result;
+}
+
+size_t ModelCache::getMaterialCount() const
+{
+    return at<FileHeader>(0)->materialCount;
+}
+
+ModelCache::CachedMaterial ModelCache::getMaterial(size_t index) const
+{
+    const FileHeader& header = *at<FileHeader>(0);
+    const MaterialRecord& record = at<MaterialRecord>(header.materialTable)[index];
+    CachedMaterial material;
+    material.opacity = record.opacity;
+    material.refraction = record.refraction;
+    for (uint32_t i = 0; i < record.textureCount; ++i)
+    {
+        const TextureRecord& texture = at<TextureRecord>(header.textureTable)[record.firstTexture + i];
+        material.textures.emplace_back(static_cast<TextureType>(texture.type), getString(texture.path, texture.pathLength));
+    }
+    return material;
+}
+
+size_t ModelCache::getNodeCount() const
+{
+    return at<FileHeader>(0)->nodeCount;
+}
+
+ModelNode ModelCache::getNode(size_t index) const
+{
+    const FileHeader& header = *at<FileHeader>(0);
+    const NodeRecord& record = at<NodeRecord>(header.nodeTable)[index];
+    ModelNode node;
+    node.name = getString(record.name, record.nameLength);
+    memcpy(&node.transform[0][0], record.transform, sizeof(record.transform));
+    node.globalTransform = node.transform;
+    node.parent = record.parent;
+    const uint32_t* meshes = at<uint32_t>(header.nodeMeshTable) + record.firstMesh;
+    node.meshes.assign(meshes, meshes + record.meshCount);
+    return node;
+}
+
+string ModelCache::getString(uint32_t offset, uint32_t length) const
+{
+    return string(at<char>(at<FileHeader>(0)->strings + offset), length);
+}
+
+bool ModelCache::write(const string& sourcePath, const ModelImport& model)
+{
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "indices are stored as 32-bit");
+
+    SourceKey key;
+    if (!getSourceKey(sourcePath, key))
+        return false;
+
+    FileHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.options = getOptions();
+    header.sourceSize = key.size;
+    header.sourceTime = key.time;
+    header.sourceHash = hashFile(sourcePath);
+    header.vertexSize = sizeof(Vertex);
+    header.lodSize = sizeof(MeshLod);
+    header.meshletSize = sizeof(mesh::Meshlet);
+    header.arenaVertexSize = static_cast<uint32_t>(Mesh::getArenaVertexSize());
+
+    FileBuilder file;
+    file.append(&header, sizeof(header));
+    string strings;
+    auto addString = [&strings](const string& value, uint32_t& offset, uint32_t& length)
+    {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(value.size());
+        strings += value;
+    };
+
+    // Meshes with equal textures and material constants share material record
+    using MaterialDescription = tuple<vector<unsigned int>, float, float>;
+    map<MaterialDescription, uint32_t> materialIndices;
+    vector<MaterialRecord> materials;
+    vector<TextureRecord> textures;
+    vector<MeshRecord> meshes;
+    for (const ImportedMesh& mesh : model.meshes)
+    {
+        auto material = materialIndices.emplace(MaterialDescription(mesh.textures, mesh.opacity, mesh.refraction),
+            static_cast<uint32_t>(materials.size()));
+        if (material.second)
+        {
+            MaterialRecord record = { mesh.opacity, mesh.refraction,
+                static_cast<uint32_t>(textures.size()), static_cast<uint32_t>(mesh.textures.size()) };
+            materials.push_back(record);
+            for (unsigned int texture : mesh.textures)
+            {
+                TextureRecord textureRecord = {};
+                textureRecord.type = static_cast<uint32_t>(model.textures[texture].type);
+                addString(model.textures[texture].path, textureRecord.path, textureRecord.pathLength);
+                textures.push_back(textureRecord);
+            }
+        }
+
+        // Levels of detail follow full mesh indices, so they are uploaded in one piece
+        ProcessedGeometry geometry = mesh.getGeometry();
+        MeshRecord record = {};
+        record.vertices = file.append(geometry.vertices, geometry.vertexCount * sizeof(Vertex));
+        record.indices = file.append(geometry.indices, geometry.indexCount * sizeof(unsigned int));
+        record.lods = file.append(geometry.lods, geometry.lodCount * sizeof(MeshLod));
+        record.meshlets = file.append(geometry.meshlets, geometry.meshletCount * sizeof(mesh::Meshlet));
+        // Arena layout is stored only where it differs, loads upload it straight from the mapped file
+        const ArenaGeometry& arena = geometry.arena;
+        record.arenaVertices = arena.vertices == geometry.vertices ? record.vertices
+            : file.append(arena.vertices, arena.vertexCount * Mesh::getArenaVertexSize());
+        record.arenaIndices = arena.indices == geometry.indices ? record.indices
+            : file.append(arena.indices, arena.indexCount * getIndexSize(arena.indexType));
+        record.arenaIndexType = arena.indexType;
+        memcpy(record.positionDecode, &arena.positionDecode[0][0], sizeof(record.positionDecode));
+        record.vertexCount = static_cast<uint32_t>(geometry.vertexCount);
+        record.indexCount = static_cast<uint32_t>(geometry.indexCount);
+        record.lodCount = static_cast<uint32_t>(geometry.lodCount);
+        record.meshletCount = static_cast<uint32_t>(geometry.meshletCount);
+        record.material = material.first->second;
+        meshes.push_back(record);
+    }
+
+    vector<NodeRecord> nodes;
+    vector<uint32_t> nodeMeshes;
+    for (const ModelNode& node : model.nodes)
+    {
+        NodeRecord record = {};
+        memcpy(record.transform, &node.transform[0][0], sizeof(record.transform));
+        record.parent = node.parent;
+        addString(node.name, record.name, record.nameLength);
+        record.firstMesh = static_cast<uint32_t>(nodeMeshes.size());
+        record.meshCount = static_cast<uint32_t>(node.meshes.size());
+        nodeMeshes.insert(nodeMeshes.end(), node.meshes.begin(), node.meshes.end());
+        nodes.push_back(record);
+    }
+
+    vector<DependencyRecord> dependencies;
+    for (const string& path : model.dependencies)
+    {
+        DependencyRecord record = {};
+        SourceKey dependencyKey;
+        if (getSourceKey(path, dependencyKey))
+        {
+            record.size = dependencyKey.size;
+            record.time = dependencyKey.time;
+            record.hash = hashFile(path);
+            record.exists = 1;
+        }
+        addString(path, record.path, record.pathLength);
+        dependencies.push_back(record);
+    }
+
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.textureCount = static_cast<uint32_t>(textures.size());
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.nodeMeshCount = static_cast<uint32_t>(nodeMeshes.size());
+    header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    header.meshTable = file.append(meshes);
+    header.materialTable = file.append(materials);
+    header.textureTable = file.append(textures);
+    header.nodeTable = file.append(nodes);
+    header.nodeMeshTable = file.append(nodeMeshes);
+    header.dependencyTable = file.append(dependencies);
+    header.strings = file.append(strings.data(), strings.size());
+    header.stringsSize = strings.size();
+    header.fileSize = file.getData().size();
+    file.overwrite(0, &header, sizeof(header));
+
+    // Written under temporary name, so a concurrent or interrupted run never sees a partial file
+    string cachePath = getCachePath(sourcePath);
+    string temporaryPath = cachePath + ".tmp";
+    {
+        ofstream output(temporaryPath, ios::binary | ios::trunc);
+        output.write(reinterpret_cast<const char*>(file.getData().data()), static_cast<streamsize>(file.getData().size()));
+        if (!output)
+        {
+            cout << "ERROR::MODEL_CACHE::FAILED_TO_WRITE " << temporaryPath << endl;
+            output.close();
+            remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    remove(cachePath.c_str());
+    if (rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+    {
+        cout << "ERROR::MODEL_CACHE::FAILED_TO_WRITE " << cachePath << endl;
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,500 @@
+#include <Objects/ObjLoader.h>
+#include <Core/MappedFile.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string_view>
+
+using namespace std;
+
+namespace
+{
+    // Lines of one chunk are parsed by one job
+    const size_t CHUNK_SIZE = 1 << 20;
+    const char* const DEFAULT_MATERIAL = "DefaultMaterial";
+    const char* const DEFAULT_OBJECT = "defaultobject";
+
+    enum CornerFlags : uint32_t
+    {
+        // Index of component i is present if bit PRESENT << i is set
+        PRESENT = 1u,
+        // Negative OBJ index, stored relative to the first element of chunk
+        RELATIVE = 1u << 3
+    };
+
+    // Indices of position, texture coordinates and normal of face corner
+    struct Corner
+    {
+        int32_t index[3];
+        uint32_t flags;
+    };
+
+    enum class StatementType
+    {
+        Object,     // o or g
+        Material,   // usemtl
+        Library     // mtllib
+    };
+
+    // Statement which changes state of faces following it
+    struct Statement
+    {
+        StatementType type;
+        string name;
+        // Numbers of polygons, corners and triangles of chunk before statement
+        size_t polygon;
+        size_t corner;
+        size_t triangle;
+    };
+
+    struct Chunk
+    {
+        vector<glm::vec3> positions;
+        vector<glm::vec2> texCoords;
+        vector<glm::vec3> normals;
+        vector<Corner> corners;
+        vector<uint32_t> polygonSizes;
+        size_t triangleCount = 0;
+        vector<Statement> statements;
+        string error;
+    };
+
+    const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            ++p;
+        return p;
+    }
+
+    const char* findSpace(const char* p, const char* end)
+    {
+        while (p < end && *p != ' ' && *p != '\t')
+            ++p;
+        return p;
+    }
+
+    // Rest of line without surrounding spaces
+    string trimmed(const char* p, const char* end)
+    {
+        p = skipSpaces(p, end);
+        while (end > p && (end[-1] == ' ' || end[-1] == '\t'))
+            --end;
+        return string(p, end);
+    }
+
+    bool parseFloat(const char*& p, const char* end, float& value)
+    {
+        p = skipSpaces(p, end);
+        // from_chars doesn't accept explicit plus sign
+        if (p < end && *p == '+')
+            ++p;
+        from_chars_result result = from_chars(p, end, value);
+        if (result.ec != errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    // Corners of face are "v", "v/vt", "v//vn" or "v/vt/vn", indices start at 1 or are negative
+    // (relative to the last element defined before)
+    bool parseFace(const char* p, const char* end, Chunk& chunk)
+    {
+        size_t counts[3] = { chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size() };
+        uint32_t size = 0;
+        for (p = skipSpaces(p, end); p < end; p = skipSpaces(p, end))
+        {
+            Corner corner = {};
+            for (int component = 0; component < 3; ++component)
+            {
+                if (component > 0)
+                {
+                    if (p == end || *p != '/')
+                        break;
+                    ++p;
+                }
+                if (p == end || *p == '/' || *p == ' ' || *p == '\t')
+                    continue;
+
+                int32_t value = 0;
+                from_chars_result result = from_chars(p, end, value);
+                if (result.ec != errc() || value == 0)
+                    return false;
+                p = result.ptr;
+                corner.flags |= PRESENT << component;
+                if (value > 0)
+                {
+                    corner.index[component] = value - 1;
+                }
+                else
+                {
+                    corner.index[component] = static_cast<int32_t>(counts[component]) + value;
+                    corner.flags |= RELATIVE << component;
+                }
+            }
+            if (!(corner.flags & PRESENT) || (p < end && *p != ' ' && *p != '\t'))
+                return false;
+            chunk.corners.push_back(corner);
+            ++size;
+        }
+        if (size < 3)
+            return false;
+
+        chunk.polygonSizes.push_back(size);
+        chunk.triangleCount += size - 2;
+        return true;
+    }
+
+    void parseChunk(const char* begin, const char* end, Chunk& chunk)
+    {
+        const char* next = begin;
+        for (const char* line = begin; line < end; line = next)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+            if (!lineEnd)
+                lineEnd = end;
+            next = lineEnd < end ? lineEnd + 1 : end;
+            if (lineEnd > line && lineEnd[-1] == '\r')
+                --lineEnd;
+
+            const char* p = skipSpaces(line, lineEnd);
+            const char* keywordEnd = findSpace(p, lineEnd);
+            string_view keyword(p, keywordEnd - p);
+            p = keywordEnd;
+
+            bool good = true;
+            if (keyword == "v")
+            {
+                glm::vec3 position;
+                good = parseFloat(p, lineEnd, position.x) && parseFloat(p, lineEnd, position.y) && parseFloat(p, lineEnd, position.z);
+                chunk.positions.push_back(position);
+            }
+            else if (keyword == "vt")
+            {
+                // v coordinate is optional
+                glm::vec2 texCoords(0.0f);
+                good = parseFloat(p, lineEnd, texCoords.x);
+                if (good && skipSpaces(p, lineEnd) < lineEnd)
+                    good = parseFloat(p, lineEnd, texCoords.y);
+                chunk.texCoords.push_back(texCoords);
+            }
+            else if (keyword == "vn")
+            {
+                glm::vec3 normal;
+                good = parseFloat(p, lineEnd, normal.x) && parseFloat(p, lineEnd, normal.y) && parseFloat(p, lineEnd, normal.z);
+                chunk.normals.push_back(normal);
+            }
+            else if (keyword == "f")
+            {
+                good = parseFace(p, lineEnd, chunk);
+            }
+            else if (keyword == "o" || keyword == "g" || keyword == "usemtl" || keyword == "mtllib")
+            {
+                StatementType type = keyword == "usemtl" ? StatementType::Material
+                    : keyword == "mtllib" ? StatementType::Library : StatementType::Object;
+                chunk.statements.push_back({ type, trimmed(p, lineEnd), chunk.polygonSizes.size(), chunk.corners.size(), chunk.triangleCount });
+            }
+            // comments, smoothing groups, lines, points and other statements don't affect meshes
+
+            if (!good && chunk.error.empty())
+                chunk.error = string(line, lineEnd);
+        }
+    }
+
+    // Adds materials of MTL file, missing library leaves faces with the default material
+    void loadMaterialLibrary(const string& path, vector<ObjMaterial>& materials)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            cout << "ERROR::OBJ_LOADER::FAILED_TO_OPEN_MATERIAL_LIBRARY " << path << endl;
+            return;
+        }
+
+        const char* data = reinterpret_cast<const char*>(file.getData());
+        const char* end = data + file.getSize();
+        ObjMaterial* material = nullptr;
+        const char* next = data;
+        for (const char* line = data; line < end; line = next)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+            if (!lineEnd)
+                lineEnd = end;
+            next = lineEnd < end ? lineEnd + 1 : end;
+            if (lineEnd > line && lineEnd[-1] == '\r')
+                --lineEnd;
+
+            const char* p = skipSpaces(line, lineEnd);
+            const char* keywordEnd = findSpace(p, lineEnd);
+            string_view keyword(p, keywordEnd - p);
+            p = keywordEnd;
+
+            if (keyword == "newmtl")
+            {
+                materials.emplace_back();
+                material = &materials.back();
+                material->name = trimmed(p, lineEnd);
+                continue;
+            }
+            if (!material)
+                continue;
+
+            if (keyword == "d")
+            {
+                parseFloat(p, lineEnd, material->opacity);
+                continue;
+            }
+            if (keyword == "Ni")
+            {
+                parseFloat(p, lineEnd, material->refraction);
+                continue;
+            }
+
+            TextureType type;
+            if (keyword == "map_Kd")
+                type = TextureType::Albedo;
+            else if (keyword == "map_Ks")
+                type = TextureType::Metallic;
+            else if (keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump")
+                type = TextureType::Normal;
+            else if (keyword == "map_Kn" || keyword == "norm")
+                type = TextureType::Roughness;
+            else
+                continue;
+
+            // Texture options (-bm 1 and so on) precede path
+            string arguments = trimmed(p, lineEnd);
+            size_t pathStart = arguments.find_last_of(" \t");
+            material->textures.emplace_back(type, pathStart == string::npos ? arguments : arguments.substr(pathStart + 1));
+        }
+    }
+
+    // Global index of corner component, -1 if it is missing or out of range
+    int64_t resolve(const Corner& corner, int component, size_t chunkBase, size_t count)
+    {
+        if (!(corner.flags & (PRESENT << component)))
+            return -1;
+        int64_t index = corner.index[component];
+        if (corner.flags & (RELATIVE << component))
+            index += static_cast<int64_t>(chunkBase);
+        return index >= 0 && index < static_cast<int64_t>(count) ? index : -1;
+    }
+}
+
+bool loadObj(const string& path, ObjModel& model, JobSystem* jobs)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        cout << "ERROR::OBJ_LOADER::FAILED_TO_OPEN " << path << endl;
+        return false;
+    }
+    const char* data = reinterpret_cast<const char*>(file.getData());
+    size_t size = file.getSize();
+
+    // Chunks end at line ends, so no line is split between jobs
+    vector<pair<size_t, size_t>> ranges;
+    for (size_t begin = 0; begin < size;)
+    {
+        size_t end = min(begin + CHUNK_SIZE, size);
+        if (end < size)
+        {
+            const void* lineEnd = memchr(data + end - 1, '\n', size - end + 1);
+            end = lineEnd ? static_cast<const char*>(lineEnd) - data + 1 : size;
+        }
+        ranges.emplace_back(begin, end);
+        begin = end;
+    }
+
+    vector<Chunk> chunks(ranges.size());
+    auto parse = [&chunks, &ranges, data](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+            parseChunk(data + ranges[i].first, data + ranges[i].second, chunks[i]);
+    };
+    if (jobs)
+        jobs->parallelFor(0, chunks.size(), 1, parse);
+    else
+        parse(0, chunks.size());
+
+    for (const Chunk& chunk : chunks)
+    {
+        if (!chunk.error.empty())
+        {
+            cout << "ERROR::OBJ_LOADER::MALFORMED_LINE " << path << ": " << chunk.error << endl;
+            return false;
+        }
+    }
+
+    // Elements of all chunks are concatenated, relative indices of chunk are resolved against its bases
+    struct Bases
+    {
+        size_t position;
+        size_t texCoord;
+        size_t normal;
+    };
+    vector<Bases> bases;
+    vector<glm::vec3> positions;
+    vector<glm::vec2> texCoords;
+    vector<glm::vec3> normals;
+    for (const Chunk& chunk : chunks)
+    {
+        bases.push_back({ positions.size(), texCoords.size(), normals.size() });
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+
+    model = ObjModel();
+    model.materials.emplace_back();
+    model.materials.back().name = DEFAULT_MATERIAL;
+
+    // Libraries are loaded before faces are assigned, so usemtl may precede mtllib
+    string directory = path.substr(0, path.find_last_of('/') + 1);
+    vector<string>& libraries = model.libraries;
+    for (const Chunk& chunk : chunks)
+    {
+        for (const Statement& statement : chunk.statements)
+        {
+            string library = directory + statement.name;
+            if (statement.type == StatementType::Library && find(libraries.begin(), libraries.end(), library) == libraries.end())
+            {
+                libraries.push_back(library);
+                loadMaterialLibrary(library, model.materials);
+            }
+        }
+    }
+    map<string, unsigned int> materialIndices;
+    for (unsigned int i = 0; i < model.materials.size(); ++i)
+        materialIndices.emplace(model.materials[i].name, i);
+
+    // Runs of polygons between statements go to one mesh. A new mesh is started by a new object
+    // or material, a new object by o and g statements.
+    struct Run
+    {
+        size_t chunk;
+        size_t firstPolygon;
+        size_t endPolygon;
+        size_t firstCorner;
+        unsigned int mesh;
+        size_t firstVertex;
+        size_t firstIndex;
+    };
+    vector<Run> runs;
+    vector<size_t> vertexCounts;
+    vector<size_t> indexCounts;
+    int object = -1;
+    int mesh = -1;
+    unsigned int material = 0;
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        const Chunk& chunk = chunks[c];
+        size_t polygon = 0, corner = 0, triangle = 0;
+        auto addRun = [&](size_t endPolygon, size_t endCorner, size_t endTriangle)
+        {
+            if (endPolygon == polygon)
+                return;
+            if (object < 0)
+            {
+                model.objects.push_back({ DEFAULT_OBJECT, {} });
+                object = static_cast<int>(model.objects.size()) - 1;
+            }
+            if (mesh < 0)
+            {
+                mesh = static_cast<int>(model.meshes.size());
+                model.meshes.emplace_back();
+                model.meshes.back().name = model.objects[object].name;
+                model.meshes.back().material = material;
+                model.objects[object].meshes.push_back(mesh);
+                vertexCounts.push_back(0);
+                indexCounts.push_back(0);
+            }
+            runs.push_back({ c, polygon, endPolygon, corner, static_cast<unsigned int>(mesh), vertexCounts[mesh], indexCounts[mesh] });
+            vertexCounts[mesh] += endCorner - corner;
+            indexCounts[mesh] += 3 * (endTriangle - triangle);
+            polygon = endPolygon;
+            corner = endCorner;
+            triangle = endTriangle;
+        };
+
+        for (const Statement& statement : chunk.statements)
+        {
+            addRun(statement.polygon, statement.corner, statement.triangle);
+            if (statement.type == StatementType::Object)
+            {
+                model.objects.push_back({ statement.name, {} });
+                object = static_cast<int>(model.objects.size()) - 1;
+                mesh = -1;
+            }
+            else if (statement.type == StatementType::Material)
+            {
+                auto found = materialIndices.find(statement.name);
+                unsigned int index = found != materialIndices.end() ? found->second : 0;
+                if (index != material)
+                    mesh = -1;
+                material = index;
+            }
+        }
+        addRun(chunk.polygonSizes.size(), chunk.corners.size(), chunk.triangleCount);
+    }
+
+    for (size_t i = 0; i < model.meshes.size(); ++i)
+    {
+        model.meshes[i].vertices.resize(vertexCounts[i]);
+        model.meshes[i].indices.resize(indexCounts[i]);
+    }
+
+    // Every corner gets its own vertex, polygons are triangulated as fans
+    atomic<bool> outOfRange(false);
+    auto fill = [&](size_t first, size_t last)
+    {
+        for (size_t r = first; r < last; ++r)
+        {
+            const Run& run = runs[r];
+            const Chunk& chunk = chunks[run.chunk];
+            const Bases& base = bases[run.chunk];
+            ObjMesh& target = model.meshes[run.mesh];
+            Vertex* vertex = target.vertices.data() + run.firstVertex;
+            unsigned int* index = target.indices.data() + run.firstIndex;
+            unsigned int vertexIndex = static_cast<unsigned int>(run.firstVertex);
+            const Corner* corner = chunk.corners.data() + run.firstCorner;
+            for (size_t polygon = run.firstPolygon; polygon < run.endPolygon; ++polygon)
+            {
+                uint32_t polygonSize = chunk.polygonSizes[polygon];
+                for (uint32_t i = 0; i < polygonSize; ++i, ++corner, ++vertex)
+                {
+                    int64_t position = resolve(*corner, 0, base.position, positions.size());
+                    int64_t texCoord = resolve(*corner, 1, base.texCoord, texCoords.size());
+                    int64_t normal = resolve(*corner, 2, base.normal, normals.size());
+                    if (position < 0 || (texCoord < 0 && (corner->flags & (PRESENT << 1))) || (normal < 0 && (corner->flags & (PRESENT << 2))))
+                        outOfRange.store(true, memory_order_relaxed);
+                    vertex->Position = position >= 0 ? positions[position] : glm::vec3(0.0f);
+                    vertex->TexCoords = texCoord >= 0 ? texCoords[texCoord] : glm::vec2(0.0f);
+                    vertex->Normal = normal >= 0 ? normals[normal] : glm::vec3(0.0f);
+                }
+                for (uint32_t i = 1; i + 1 < polygonSize; ++i)
+                {
+                    *index++ = vertexIndex;
+                    *index++ = vertexIndex + i;
+                    *index++ = vertexIndex + i + 1;
+                }
+                vertexIndex += polygonSize;
+            }
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(0, runs.size(), 1, fill);
+    else
+        fill(0, runs.size());
+
+    if (outOfRange)
+    {
+        cout << "ERROR::OBJ_LOADER::INDEX_OUT_OF_RANGE " << path << endl;
+        return false;
+    }
+    return true;
+}
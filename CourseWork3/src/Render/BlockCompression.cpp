@@ -0,0 +1,258 @@
+#include <Render/BlockCompression.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    struct Color
+    {
+        float r, g, b;
+    };
+
+    std::uint16_t packRgb565(Color color)
+    {
+        auto quantize = [](float value, float levels)
+        {
+            return static_cast<std::uint16_t>(std::lround(std::min(std::max(value, 0.0f), 255.0f) * levels / 255.0f));
+        };
+        return static_cast<std::uint16_t>((quantize(color.r, 31.0f) << 11) | (quantize(color.g, 63.0f) << 5) | quantize(color.b, 31.0f));
+    }
+
+    // Bits are replicated to low bits, as GPUs expand them
+    Color unpackRgb565(std::uint16_t packed)
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        return Color{ static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2)) };
+    }
+
+    float distance2(Color a, Color b)
+    {
+        return (a.r - b.r) * (a.r - b.r) + (a.g - b.g) * (a.g - b.g) + (a.b - b.b) * (a.b - b.b);
+    }
+
+    // Picks the closest of 4 palette colors for every texel, returns total squared error
+    float assignIndices(const Color* texels, std::uint16_t color0, std::uint16_t color1, std::uint8_t* indices)
+    {
+        Color c0 = unpackRgb565(color0);
+        Color c1 = unpackRgb565(color1);
+        const Color palette[4] = {
+            c0, c1,
+            Color{ (2.0f * c0.r + c1.r) / 3.0f, (2.0f * c0.g + c1.g) / 3.0f, (2.0f * c0.b + c1.b) / 3.0f },
+            Color{ (c0.r + 2.0f * c1.r) / 3.0f, (c0.g + 2.0f * c1.g) / 3.0f, (c0.b + 2.0f * c1.b) / 3.0f } };
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float best = distance2(texels[i], palette[0]);
+            indices[i] = 0;
+            for (std::uint8_t index = 1; index < 4; ++index)
+            {
+                float candidate = distance2(texels[i], palette[index]);
+                if (candidate < best)
+                {
+                    best = candidate;
+                    indices[i] = index;
+                }
+            }
+            error += best;
+        }
+        return error;
+    }
+
+    // Endpoints are ordered (color0 > color1) so that block is decoded in 4 color mode
+    void writeColorBlock(std::uint16_t color0, std::uint16_t color1, const std::uint8_t* indices, std::uint8_t* block)
+    {
+        static const std::uint8_t SWAPPED[4] = { 1, 0, 3, 2 };
+        bool swap = color0 < color1;
+        if (swap)
+            std::swap(color0, color1);
+        std::uint32_t bits = 0;
+        for (int i = 0; i < 16; ++i)
+            bits |= static_cast<std::uint32_t>(color0 == color1 ? 0 : swap ? SWAPPED[indices[i]] : indices[i]) << (2 * i);
+        block[0] = static_cast<std::uint8_t>(color0 & 0xFF);
+        block[1] = static_cast<std::uint8_t>(color0 >> 8);
+        block[2] = static_cast<std::uint8_t>(color1 & 0xFF);
+        block[3] = static_cast<std::uint8_t>(color1 >> 8);
+        for (int i = 0; i < 4; ++i)
+            block[4 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+
+    void encodeColor(const std::uint8_t* rgba, std::uint8_t* block)
+    {
+        Color texels[16];
+        Color mean = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i)
+        {
+            texels[i] = Color{ static_cast<float>(rgba[4 * i]), static_cast<float>(rgba[4 * i + 1]), static_cast<float>(rgba[4 * i + 2]) };
+            mean.r += texels[i].r / 16.0f;
+            mean.g += texels[i].g / 16.0f;
+            mean.b += texels[i].b / 16.0f;
+        }
+
+        // Principal axis of texel colors by power iteration on their covariance
+        float covariance[6] = {};
+        for (const Color& texel : texels)
+        {
+            float r = texel.r - mean.r, g = texel.g - mean.g, b = texel.b - mean.b;
+            covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+            covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+        }
+        Color axis = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            Color next = {
+                covariance[0] * axis.r + covariance[1] * axis.g + covariance[2] * axis.b,
+                covariance[1] * axis.r + covariance[3] * axis.g + covariance[4] * axis.b,
+                covariance[2] * axis.r + covariance[4] * axis.g + covariance[5] * axis.b };
+            float length = std::sqrt(next.r * next.r + next.g * next.g + next.b * next.b);
+            if (length < 1e-6f)
+                break;
+            axis = Color{ next.r / length, next.g / length, next.b / length };
+        }
+
+        // Endpoints are the extreme projections on the axis
+        float low = 0.0f, high = 0.0f;
+        for (const Color& texel : texels)
+        {
+            float t = (texel.r - mean.r) * axis.r + (texel.g - mean.g) * axis.g + (texel.b - mean.b) * axis.b;
+            low = std::min(low, t);
+            high = std::max(high, t);
+        }
+        std::uint16_t color0 = packRgb565(Color{ mean.r + axis.r * high, mean.g + axis.g * high, mean.b + axis.b * high });
+        std::uint16_t color1 = packRgb565(Color{ mean.r + axis.r * low, mean.g + axis.g * low, mean.b + axis.b * low });
+        std::uint8_t indices[16];
+        float error = assignIndices(texels, color0, color1, indices);
+
+        // One least squares refit of endpoints to the chosen indices
+        static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        Color ax = { 0.0f, 0.0f, 0.0f }, bx = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i)
+        {
+            float a = WEIGHTS[indices[i]], b = 1.0f - a;
+            aa += a * a; ab += a * b; bb += b * b;
+            ax.r += a * texels[i].r; ax.g += a * texels[i].g; ax.b += a * texels[i].b;
+            bx.r += b * texels[i].r; bx.g += b * texels[i].g; bx.b += b * texels[i].b;
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) > 1e-6f)
+        {
+            Color end0 = { (ax.r * bb - bx.r * ab) / determinant, (ax.g * bb - bx.g * ab) / determinant, (ax.b * bb - bx.b * ab) / determinant };
+            Color end1 = { (bx.r * aa - ax.r * ab) / determinant, (bx.g * aa - ax.g * ab) / determinant, (bx.b * aa - ax.b * ab) / determinant };
+            std::uint16_t refined0 = packRgb565(end0);
+            std::uint16_t refined1 = packRgb565(end1);
+            std::uint8_t refinedIndices[16];
+            if (assignIndices(texels, refined0, refined1, refinedIndices) < error)
+            {
+                color0 = refined0;
+                color1 = refined1;
+                std::memcpy(indices, refinedIndices, sizeof(indices));
+            }
+        }
+        writeColorBlock(color0, color1, indices, block);
+    }
+}
+
+namespace bc
+{
+    std::size_t getBlockSize(Format format)
+    {
+        return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+    }
+
+    std::size_t getCompressedSize(Format format, int width, int height)
+    {
+        return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+    }
+
+    void encodeBC1(const std::uint8_t* rgba, std::uint8_t* block)
+    {
+        encodeColor(rgba, block);
+    }
+
+    void encodeBC3(const std::uint8_t* rgba, std::uint8_t* block)
+    {
+        encodeBC4(rgba + 3, 4, block);
+        encodeColor(rgba, block + 8);
+    }
+
+    void encodeBC4(const std::uint8_t* values, std::size_t stride, std::uint8_t* block)
+    {
+        int low = 255, high = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            low = std::min<int>(low, values[i * stride]);
+            high = std::max<int>(high, values[i * stride]);
+        }
+
+        // high > low selects 8 value mode: both endpoints and 6 values between them
+        int palette[8] = { high, low };
+        for (int i = 2; i < 8; ++i)
+            palette[i] = ((8 - i) * high + (i - 1) * low + 3) / 7;
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int value = values[i * stride];
+            int best = 0;
+            for (int index = 1; index < 8; ++index)
+            {
+                if (std::abs(palette[index] - value) < std::abs(palette[best] - value))
+                    best = index;
+            }
+            bits |= static_cast<std::uint64_t>(high == low ? 0 : best) << (3 * i);
+        }
+        block[0] = static_cast<std::uint8_t>(high);
+        block[1] = static_cast<std::uint8_t>(low);
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+
+    void encodeBC5(const std::uint8_t* rg, std::uint8_t* block)
+    {
+        encodeBC4(rg, 2, block);
+        encodeBC4(rg + 1, 2, block + 8);
+    }
+
+    std::vector<std::uint8_t> compress(Format format, const std::uint8_t* pixels, int width, int height, int components)
+    {
+        std::vector<std::uint8_t> result(getCompressedSize(format, width, height));
+        std::uint8_t* block = result.data();
+        std::uint8_t texels[16 * 4];
+        for (int blockY = 0; blockY < height; blockY += 4)
+        {
+            for (int blockX = 0; blockX < width; blockX += 4)
+            {
+                // Texels beyond the edge repeat the last row and column
+                for (int y = 0; y < 4; ++y)
+                {
+                    for (int x = 0; x < 4; ++x)
+                    {
+                        const std::uint8_t* source = pixels
+                            + (static_cast<std::size_t>(std::min(blockY + y, height - 1)) * width + std::min(blockX + x, width - 1)) * components;
+                        std::uint8_t* texel = texels + 4 * (4 * y + x);
+                        texel[0] = source[0];
+                        texel[1] = components >= 3 ? source[1] : components == 2 && format == Format::BC5 ? source[1] : source[0];
+                        texel[2] = components >= 3 ? source[2] : source[0];
+                        texel[3] = components == 4 ? source[3] : components == 2 && format != Format::BC5 ? source[1] : 255;
+                    }
+                }
+
+                switch (format)
+                {
+                case Format::BC1: encodeBC1(texels, block); break;
+                case Format::BC3: encodeBC3(texels, block); break;
+                case Format::BC4: encodeBC4(texels, 4, block); break;
+                case Format::BC5:
+                    encodeBC4(texels, 4, block);
+                    encodeBC4(texels + 1, 4, block + 8);
+                    break;
+                }
+                block += getBlockSize(format);
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,372 @@
+#include <Render/DrawList.h>
+#include <Render/GLStateCache.h>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace
+{
+    // Model and normal matrix columns of DrawConstants read by instanced draws
+    const VertexFormat& getInstanceFormat()
+    {
+        static const VertexFormat format = []()
+        {
+            VertexFormat instanceFormat;
+            instanceFormat.stride = sizeof(DrawConstants);
+            GLuint location = GeometryArena::INSTANCE_LOCATION;
+            for (std::size_t column = 0; column < 4; ++column)
+                instanceFormat.attributes.push_back({ location++, 4, GL_FLOAT, GL_FALSE, offsetof(DrawConstants, model) + column * sizeof(glm::vec4) });
+            for (std::size_t column = 0; column < 3; ++column)
+                instanceFormat.attributes.push_back({ location++, 3, GL_FLOAT, GL_FALSE, offsetof(DrawConstants, normalMatrix) + column * sizeof(glm::vec4) });
+            return instanceFormat;
+        }();
+        return format;
+    }
+
+    // Index of the coarsest level of detail whose error projected from distance stays within limit
+    std::size_t selectLod(const std::vector<MeshLod>& lods, const LodSelection& selection, float worldScale, float distance)
+    {
+        if (selection.projectionScale <= 0.0f)
+            return 0;
+        float maxError = selection.maxPixelError * distance / (selection.projectionScale * worldScale);
+        std::size_t lod = 0;
+        while (lod + 1 < lods.size() && lods[lod + 1].error <= maxError)
+            ++lod;
+        return lod;
+    }
+}
+
+void DrawList::build(const Scene& scene, const std::vector<std::uint32_t>& instances, const DrawView& view,
+    RingBuffer& constants, RingBuffer* commands)
+{
+    const SceneGraph& sceneGraph = scene.getSceneGraph();
+    const std::vector<Scene::MeshInstance>& meshInstances = scene.getMeshInstances();
+
+    // Draw list doesn't depend on pass shader, so shader bits of the keys are left zero.
+    // Every meshlet may become a draw.
+    m_queue.clear();
+    std::size_t maxDraws = 0;
+    for (std::uint32_t index : instances)
+    {
+        const Scene::MeshInstance& instance = meshInstances[index];
+        const Mesh& mesh = scene.getModel(instance.model)->meshes[instance.mesh];
+        RenderQueue::Layer layer = mesh.getOpacityRatio() < 1.0f ? RenderQueue::Layer::Translucent : RenderQueue::Layer::Opaque;
+        float depth = glm::length(instance.worldBounds.getCenter() - view.position);
+        m_queue.push(RenderQueue::makeKey(layer, 0, mesh.getMaterialId(), mesh.getGeometry().id, depth), index);
+        maxDraws += std::max<std::size_t>(mesh.getMeshlets().size(), 1);
+    }
+    m_queue.sort();
+
+    m_draws.clear();
+    m_draws.reserve(m_queue.size());
+    m_cullData.clear();
+    m_constantsBuffer = constants.getBuffer();
+    m_multiDraw = commands != nullptr;
+    m_culledCommandsBuffer = 0;
+    m_triangleCount = m_fullTriangleCount = 0;
+    const std::vector<RenderQueue::Item>& items = m_queue.getItems();
+    m_constantsCount = items.size();
+    if (items.empty())
+    {
+        m_batches.clear();
+        return;
+    }
+
+    // Constants of the whole list form one array: instanced draws read their instances from it,
+    // multi-draw indexes it by draw id
+    // (list stays empty if ring buffer is full, it is built again once the buffer grows)
+    DrawConstants* drawConstants = static_cast<DrawConstants*>(constants.allocate(items.size() * sizeof(DrawConstants), m_constantsOffset));
+    if (!drawConstants)
+    {
+        m_batches.clear();
+        return;
+    }
+    DrawElementsIndirectCommand* multiDrawCommands = nullptr;
+    if (m_multiDraw)
+    {
+        multiDrawCommands = static_cast<DrawElementsIndirectCommand*>(commands->allocate(maxDraws * sizeof(DrawElementsIndirectCommand), m_commandsOffset));
+        m_commandsBuffer = commands->getBuffer();
+        if (!multiDrawCommands)
+        {
+            m_batches.clear();
+            return;
+        }
+    }
+
+    // Ranges of mesh indices to draw: the whole level of detail or visible meshlets of full mesh
+    struct Piece
+    {
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        DrawCullData cullData;
+    };
+    std::vector<Piece> pieces;
+
+    auto getMesh = [&](std::size_t item) -> const Mesh&
+    {
+        const Scene::MeshInstance& instance = meshInstances[items[item].instance];
+        return scene.getModel(instance.model)->meshes[instance.mesh];
+    };
+
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        const Scene::MeshInstance& instance = meshInstances[items[i].instance];
+        const Mesh& mesh = getMesh(i);
+
+        // Written straight to mapped memory, so only whole struct is stored at once
+        DrawConstants data;
+        const glm::mat3& normal = sceneGraph.getNormalMatrix(instance.node);
+        const glm::mat4& world = sceneGraph.getWorldMatrix(instance.node);
+        data.model = world * mesh.getPositionDecode();
+        for (int column = 0; column < 3; ++column)
+            data.normalMatrix[column] = glm::vec4(normal[column], 0.0f);
+        data.opacityRatio = mesh.getOpacityRatio();
+        data.refractionRatio = mesh.getRefractionRatio();
+        data.padding[0] = data.padding[1] = 0.0f;
+        drawConstants[i] = data;
+
+        // Error is measured from the closest point of instance bounds
+        const AABB& bounds = instance.worldBounds;
+        float worldScale = std::max(std::max(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1]))), glm::length(glm::vec3(world[2])));
+        float boundsRadius = 0.5f * glm::length(bounds.max - bounds.min);
+        float distance = std::max(glm::length(bounds.getCenter() - view.position) - boundsRadius, 0.0f);
+        std::size_t lodIndex = selectLod(mesh.getLods(), view.lods, worldScale, distance);
+        const MeshLod& lod = mesh.getLods()[lodIndex];
+        m_fullTriangleCount += mesh.getIndexCount() / 3;
+
+        // Visible meshlets differ between instances, so they can't share instanced draws. Instances of
+        // a run of the same mesh are drawn whole instead, multi-draw culls their meshlets on GPU.
+        bool instanced = !m_multiDraw && ((i > 0 && &getMesh(i - 1) == &mesh) || (i + 1 < items.size() && &getMesh(i + 1) == &mesh));
+
+        pieces.clear();
+        if (lodIndex != 0 || mesh.getMeshlets().empty() || instanced)
+        {
+            Piece piece;
+            piece.firstIndex = lod.firstIndex;
+            piece.indexCount = lod.indexCount;
+            piece.cullData.boundsMin = bounds.min;
+            piece.cullData.boundsMax = bounds.max;
+            piece.cullData.sphere = glm::vec4(bounds.getCenter(), boundsRadius);
+            piece.cullData.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            pieces.push_back(piece);
+        }
+        else
+        {
+            for (const mesh::Meshlet& meshlet : mesh.getMeshlets())
+            {
+                glm::vec3 center = glm::vec3(world * glm::vec4(meshlet.center, 1.0f));
+                float radius = meshlet.radius * worldScale;
+                glm::vec3 axis = normal * meshlet.coneAxis;
+                float axisLength = glm::length(axis);
+                axis = axisLength > 0.0f ? axis / axisLength : axis;
+                glm::vec3 offset = center - view.position;
+                if ((view.frustum && !view.frustum->intersects(center, radius))
+                    || (view.range > 0.0f && glm::length(offset) > view.range + radius)
+                    || glm::dot(offset, axis) >= meshlet.coneCutoff * glm::length(offset) + radius)
+                    continue;
+
+                // Neighbouring visible meshlets are drawn together unless they are culled on GPU
+                if (!m_multiDraw && !pieces.empty() && pieces.back().firstIndex + pieces.back().indexCount == meshlet.firstIndex)
+                {
+                    pieces.back().indexCount += meshlet.indexCount;
+                    continue;
+                }
+                Piece piece;
+                piece.firstIndex = meshlet.firstIndex;
+                piece.indexCount = meshlet.indexCount;
+                piece.cullData.boundsMin = center - glm::vec3(radius);
+                piece.cullData.boundsMax = center + glm::vec3(radius);
+                piece.cullData.sphere = glm::vec4(center, radius);
+                piece.cullData.cone = glm::vec4(axis, meshlet.coneCutoff);
+                pieces.push_back(piece);
+            }
+        }
+
+        const GeometryRange& geometry = mesh.getGeometry();
+        for (const Piece& piece : pieces)
+        {
+            m_triangleCount += piece.indexCount / 3;
+
+            // Next instance of the same mesh range joins instanced draw of the previous one. Instances
+            // read consecutive constants, so the draw must end right at this one: an instance in
+            // between drawn with another level of detail breaks the run.
+            const void* indexOffset = static_cast<const char*>(geometry.getIndexOffset()) + piece.firstIndex * geometry.getIndexSize();
+            const std::size_t constantsOffset = m_constantsOffset + i * sizeof(DrawConstants);
+            if (!m_multiDraw && !m_draws.empty() && &m_draws.back().mesh->getGeometry() == &geometry
+                && m_draws.back().material == mesh.getMaterialId() && m_draws.back().indexOffset == indexOffset
+                && m_draws.back().indexCount == piece.indexCount
+                && m_draws.back().constantsOffset + m_draws.back().instanceCount * sizeof(DrawConstants) == constantsOffset)
+            {
+                ++m_draws.back().instanceCount;
+                continue;
+            }
+
+            if (m_multiDraw)
+            {
+                DrawElementsIndirectCommand command;
+                command.count = piece.indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = static_cast<GLuint>(geometry.firstIndex + piece.firstIndex);
+                command.baseVertex = geometry.baseVertex;
+                command.baseInstance = static_cast<GLuint>(i);
+                multiDrawCommands[m_draws.size()] = command;
+                m_cullData.push_back(piece.cullData);
+            }
+
+            Draw draw;
+            draw.mesh = &mesh;
+            draw.constantsOffset = constantsOffset;
+            draw.instanceCount = 1;
+            draw.vao = mesh.getVAO();
+            draw.indexCount = piece.indexCount;
+            draw.indexOffset = indexOffset;
+            draw.indexType = geometry.indexType;
+            draw.baseVertex = geometry.baseVertex;
+            draw.material = mesh.getMaterialId();
+            m_draws.push_back(draw);
+        }
+    }
+
+    recordBatches();
+    if (m_multiDraw)
+        writeCullData(constants);
+}
+
+void DrawList::replay(const Shader& shader) const
+{
+    if (m_multiDraw)
+    {
+        replayMultiDraw(shader);
+        return;
+    }
+
+    GLStateCache& state = getGLState();
+    GeometryArena& arena = Mesh::getGeometryArena();
+    const Draw* currentMaterial = nullptr;
+    for (const Draw& draw : m_draws)
+    {
+        if (!currentMaterial || currentMaterial->material != draw.material)
+        {
+            bindMaterial(shader, draw.mesh, currentMaterial ? currentMaterial->mesh : nullptr);
+            currentMaterial = &draw;
+        }
+        state.bindVertexArray(draw.vao);
+        arena.bindInstances(getInstanceFormat(), m_constantsBuffer, draw.constantsOffset);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, draw.indexCount, draw.indexType, draw.indexOffset, draw.instanceCount, draw.baseVertex);
+    }
+}
+
+void DrawList::clear()
+{
+    m_queue.clear();
+    m_draws.clear();
+    m_batches.clear();
+}
+
+void DrawList::setCulledCommands(GLuint commandsBuffer, GLuint countsBuffer, std::size_t countsOffset)
+{
+    m_culledCommandsBuffer = commandsBuffer;
+    m_countsBuffer = countsBuffer;
+    m_countsOffset = countsOffset;
+}
+
+void DrawList::writeCullData(RingBuffer& constants)
+{
+    if (m_draws.empty())
+        return;
+
+    DrawCullData* data = static_cast<DrawCullData*>(constants.allocate(m_draws.size() * sizeof(DrawCullData), m_cullDataOffset));
+    if (!data)
+    {
+        m_draws.clear();
+        m_batches.clear();
+        return;
+    }
+
+    for (std::size_t batch = 0; batch < m_batches.size(); ++batch)
+    {
+        const Batch& range = m_batches[batch];
+        for (std::size_t i = range.firstDraw; i < range.firstDraw + range.drawCount; ++i)
+        {
+            DrawCullData cullData = m_cullData[i];
+            cullData.batch = static_cast<std::uint32_t>(batch);
+            cullData.batchFirstDraw = static_cast<std::uint32_t>(range.firstDraw);
+            data[i] = cullData;
+        }
+    }
+}
+
+void DrawList::recordBatches()
+{
+    m_batches.clear();
+    for (std::size_t i = 0; i < m_draws.size(); ++i)
+    {
+        const Draw& draw = m_draws[i];
+        if (m_batches.empty() || m_draws[i - 1].material != draw.material || m_draws[i - 1].vao != draw.vao
+            || m_draws[i - 1].indexType != draw.indexType)
+            m_batches.push_back({ draw.mesh, draw.vao, draw.indexType, i, 0 });
+        ++m_batches.back().drawCount;
+    }
+}
+
+void DrawList::bindMaterial(const Shader& shader, const Mesh* mesh, const Mesh* previous) const
+{
+    mesh->bindMaterial(shader);
+
+    // Units used only by previous material are cleared, so missing maps are sampled as black.
+    // Textures are not unbound after every material, cache drops bindings which don't change.
+    // The first material of a replay doesn't know what the previous pass left bound, so it clears
+    // all other units (2D target only, shadow and skybox cubemaps stay bound).
+    GLStateCache& state = getGLState();
+    unsigned int end = previous ? previous->getTextureCount() : GLStateCache::MAX_TEXTURE_UNITS;
+    for (unsigned int unit = mesh->getTextureCount(); unit < end; ++unit)
+    {
+        state.activeTexture(GL_TEXTURE0 + unit);
+        state.bindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+void DrawList::replayMultiDraw(const Shader& shader) const
+{
+    if (m_draws.empty())
+        return;
+
+    // Draw id attribute must cover base instances of all commands
+    Mesh::getGeometryArena().reserveDrawIds(m_constantsCount);
+
+    GLStateCache& state = getGLState();
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_CONSTANTS_BINDING, m_constantsBuffer, m_constantsOffset, m_constantsCount * sizeof(DrawConstants));
+
+    // Culled commands are compacted to the start of their batch. Without indirect count (GL 4.6)
+    // the whole batch is submitted, commands of culled draws are zeroed and draw nothing.
+    const bool culled = isCulled();
+    const bool useDrawCount = culled && GLAD_GL_VERSION_4_6;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culled ? m_culledCommandsBuffer : m_commandsBuffer);
+    if (useDrawCount)
+        glBindBuffer(GL_PARAMETER_BUFFER, m_countsBuffer);
+
+    const Mesh* previous = nullptr;
+    for (std::size_t i = 0; i < m_batches.size(); ++i)
+    {
+        const Batch& batch = m_batches[i];
+        bindMaterial(shader, batch.mesh, previous);
+        previous = batch.mesh;
+        state.bindVertexArray(batch.vao);
+
+        const std::size_t commandsOffset = m_commandsOffset + batch.firstDraw * sizeof(DrawElementsIndirectCommand);
+        if (useDrawCount)
+        {
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, batch.indexType, reinterpret_cast<const void*>(commandsOffset),
+                static_cast<GLintptr>(m_countsOffset + i * sizeof(GLuint)), static_cast<GLsizei>(batch.drawCount), 0);
+        }
+        else
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType, reinterpret_cast<const void*>(commandsOffset),
+                static_cast<GLsizei>(batch.drawCount), 0);
+        }
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    if (useDrawCount)
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+}
@@ -0,0 +1,204 @@
+#include <Render/GLStateCache.h>
+
+GLStateCache& getGLState()
+{
+    static GLStateCache state;
+    return state;
+}
+
+bool GLStateCache::update(GLuint& cached, GLuint value)
+{
+    if (cached == value)
+    {
+        ++m_stats.skipped;
+        return false;
+    }
+    cached = value;
+    ++m_stats.issued;
+    return true;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (update(m_program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (update(m_vao, vao))
+        glBindVertexArray(vao);
+}
+
+void GLStateCache::activeTexture(GLenum unit)
+{
+    m_selectedUnit = unit - GL_TEXTURE0;
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture)
+{
+    int targetIndex = textureTargetIndex(target);
+    if (targetIndex < 0 || m_selectedUnit >= MAX_TEXTURE_UNITS)
+    {
+        // Not tracked, unit is switched and binding is passed through
+        if (m_activeUnit != m_selectedUnit)
+        {
+            glActiveTexture(GL_TEXTURE0 + m_selectedUnit);
+            m_activeUnit = m_selectedUnit;
+            ++m_stats.issued;
+        }
+        glBindTexture(target, texture);
+        ++m_stats.issued;
+        return;
+    }
+
+    if (!update(m_textures[m_selectedUnit][targetIndex], texture))
+        return;
+
+    if (m_activeUnit != m_selectedUnit)
+    {
+        glActiveTexture(GL_TEXTURE0 + m_selectedUnit);
+        m_activeUnit = m_selectedUnit;
+        ++m_stats.issued;
+    }
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if (target == GL_FRAMEBUFFER)
+    {
+        if (m_readFramebuffer == framebuffer && m_drawFramebuffer == framebuffer)
+        {
+            ++m_stats.skipped;
+            return;
+        }
+        m_readFramebuffer = m_drawFramebuffer = framebuffer;
+        ++m_stats.issued;
+        glBindFramebuffer(target, framebuffer);
+    }
+    else if (target == GL_READ_FRAMEBUFFER)
+    {
+        if (update(m_readFramebuffer, framebuffer))
+            glBindFramebuffer(target, framebuffer);
+    }
+    else if (update(m_drawFramebuffer, framebuffer))
+    {
+        glBindFramebuffer(target, framebuffer);
+    }
+}
+
+void GLStateCache::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLStateCache::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    Capability* state = findCapability(capability);
+    if (state && state->known && state->enabled == enabled)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    if (state)
+    {
+        state->enabled = enabled;
+        state->known = true;
+    }
+
+    ++m_stats.issued;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLStateCache::depthFunc(GLenum function)
+{
+    if (update(m_depthFunc, function))
+        glDepthFunc(function);
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (m_viewportKnown && m_viewport[0] == x && m_viewport[1] == y && m_viewport[2] == width && m_viewport[3] == height)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+    m_viewport[0] = x;
+    m_viewport[1] = y;
+    m_viewport[2] = width;
+    m_viewport[3] = height;
+    m_viewportKnown = true;
+    ++m_stats.issued;
+    glViewport(x, y, width, height);
+}
+
+void GLStateCache::deleteTextures(GLsizei count, const GLuint* textures)
+{
+    glDeleteTextures(count, textures);
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        for (auto& unit : m_textures)
+        {
+            for (GLuint& texture : unit)
+            {
+                if (texture == textures[i])
+                    texture = 0;
+            }
+        }
+    }
+}
+
+void GLStateCache::invalidate()
+{
+    m_program = UNKNOWN;
+    m_vao = UNKNOWN;
+    m_readFramebuffer = UNKNOWN;
+    m_drawFramebuffer = UNKNOWN;
+    m_selectedUnit = 0;
+    m_activeUnit = UNKNOWN;
+    for (auto& unit : m_textures)
+    {
+        for (GLuint& texture : unit)
+            texture = UNKNOWN;
+    }
+    m_depthTest.known = m_blend.known = m_cullFace.known = false;
+    m_depthFunc = UNKNOWN;
+    m_viewportKnown = false;
+}
+
+GLStateCache::Capability* GLStateCache::findCapability(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_DEPTH_TEST:
+        return &m_depthTest;
+    case GL_BLEND:
+        return &m_blend;
+    case GL_CULL_FACE:
+        return &m_cullFace;
+    default:
+        return nullptr;
+    }
+}
+
+int GLStateCache::textureTargetIndex(GLenum target) const
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return 0;
+    case GL_TEXTURE_CUBE_MAP:
+        return 1;
+    default:
+        return -1;
+    }
+}
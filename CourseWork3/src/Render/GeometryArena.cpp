@@ -0,0 +1,207 @@
+#include <Render/GeometryArena.h>
+#include <Render/GLStateCache.h>
+
+#include <algorithm>
+#include <iostream>
+
+GeometryArena::GeometryArena(const VertexFormat& format, std::size_t vertexCapacity, std::size_t indexCapacity) :
+    m_format(format),
+    m_vertices(vertexCapacity),
+    m_indices(indexCapacity)
+{
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexCapacity * m_format.stride), nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_indexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexCapacity * sizeof(std::uint32_t)), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glGenVertexArrays(1, &m_vao);
+    setupVertexArray();
+}
+
+GeometryArena::~GeometryArena()
+{
+    release();
+}
+
+std::shared_ptr<const GeometryRange> GeometryArena::allocate(const void* vertices, std::size_t vertexCount, const void* indices, std::size_t indexCount,
+    GLenum indexType)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_vao == 0)
+    {
+        std::cout << "ERROR::GEOMETRY_ARENA::ALLOCATION_AFTER_RELEASE" << std::endl;
+        return nullptr;
+    }
+
+    const std::size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    std::size_t vertexOffset = reserve(m_vertices, m_vertexBuffer, m_format.stride, vertexCount);
+    std::size_t indexBlock = reserve(m_indices, m_indexBuffer, sizeof(std::uint32_t), getIndexBlockCount(indexCount, indexSize));
+
+    // Upload through copy target, so that element buffer binding of a bound VAO isn't touched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(vertexOffset * m_format.stride), static_cast<GLsizeiptr>(vertexCount * m_format.stride), vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(indexBlock * sizeof(std::uint32_t)), static_cast<GLsizeiptr>(indexCount * indexSize), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GeometryRange* range = new GeometryRange();
+    range->id = m_nextRangeId++;
+    range->baseVertex = static_cast<GLint>(vertexOffset);
+    range->vertexCount = vertexCount;
+    range->firstIndex = indexBlock * sizeof(std::uint32_t) / indexSize;
+    range->indexCount = indexCount;
+    range->indexType = indexType;
+    return std::shared_ptr<const GeometryRange>(range, [this](const GeometryRange* range)
+    {
+        free(*range);
+        delete range;
+    });
+}
+
+void GeometryArena::reserveDrawIds(std::size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (count <= m_drawIdCapacity || m_vao == 0)
+        return;
+
+    m_drawIdCapacity = std::max(count, m_drawIdCapacity * 2);
+    std::vector<std::uint32_t> drawIds(m_drawIdCapacity);
+    for (std::size_t i = 0; i < drawIds.size(); ++i)
+        drawIds[i] = static_cast<std::uint32_t>(i);
+
+    if (m_drawIdBuffer == 0)
+        glGenBuffers(1, &m_drawIdBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_drawIdBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(drawIds.size() * sizeof(std::uint32_t)), drawIds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    setupVertexArray();
+}
+
+void GeometryArena::bindInstances(const VertexFormat& format, GLuint buffer, std::size_t offset)
+{
+    // Enables and divisors are VAO state, which stays as set by the first call
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (const VertexAttribute& attribute : format.attributes)
+    {
+        if (!m_instancesEnabled)
+        {
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribDivisor(attribute.location, 1);
+        }
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, format.stride, reinterpret_cast<void*>(offset + attribute.offset));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_instancesEnabled = true;
+}
+
+void GeometryArena::release()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_vao == 0)
+        return;
+
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+    if (m_drawIdBuffer != 0)
+        glDeleteBuffers(1, &m_drawIdBuffer);
+    m_vao = m_vertexBuffer = m_indexBuffer = m_drawIdBuffer = 0;
+    m_drawIdCapacity = 0;
+    m_instancesEnabled = false;
+
+    // VAO id may be reused by the driver
+    getGLState().invalidate();
+}
+
+std::size_t GeometryArena::getVertexCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_vertices.getCapacity();
+}
+
+std::size_t GeometryArena::getUsedVertices() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_vertices.getUsed();
+}
+
+std::size_t GeometryArena::getIndexCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indices.getCapacity();
+}
+
+std::size_t GeometryArena::getUsedIndices() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indices.getUsed();
+}
+
+void GeometryArena::free(const GeometryRange& range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_vertices.free(static_cast<std::size_t>(range.baseVertex), range.vertexCount);
+    m_indices.free(range.firstIndex * range.getIndexSize() / sizeof(std::uint32_t), getIndexBlockCount(range.indexCount, range.getIndexSize()));
+}
+
+std::size_t GeometryArena::getIndexBlockCount(std::size_t indexCount, std::size_t indexSize)
+{
+    return (indexCount * indexSize + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+}
+
+std::size_t GeometryArena::reserve(RangeAllocator& allocator, GLuint& buffer, std::size_t elementSize, std::size_t count)
+{
+    std::size_t offset = allocator.allocate(count);
+    if (offset != RangeAllocator::INVALID)
+        return offset;
+
+    // Capacity is doubled, so that loading many meshes causes only a few copies
+    std::size_t oldCapacity = allocator.getCapacity();
+    std::size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + count);
+    growBuffer(buffer, oldCapacity * elementSize, newCapacity * elementSize);
+    allocator.grow(newCapacity);
+
+    // Both buffers are part of VAO state, so VAO has to be pointed to the new one
+    setupVertexArray();
+    return allocator.allocate(count);
+}
+
+void GeometryArena::growBuffer(GLuint& buffer, std::size_t oldSize, std::size_t newSize)
+{
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(newSize), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(oldSize));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+}
+
+void GeometryArena::setupVertexArray()
+{
+    getGLState().bindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    for (const VertexAttribute& attribute : m_format.attributes)
+    {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, m_format.stride, reinterpret_cast<void*>(attribute.offset));
+    }
+    if (m_drawIdBuffer != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+        glEnableVertexAttribArray(DRAW_ID_LOCATION);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(std::uint32_t), nullptr);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+    }
+    getGLState().bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,129 @@
+#include <Render/GpuCulling.h>
+#include <Render/GLStateCache.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    // Matches local size of culling.comp
+    const unsigned int CULLING_GROUP_SIZE = 64;
+
+    // Binding points of culling.comp buffers
+    const GLuint INPUT_COMMANDS_BINDING = 0;
+    const GLuint OUTPUT_COMMANDS_BINDING = 1;
+    const GLuint CULL_DATA_BINDING = 2;
+    const GLuint BATCH_COUNTS_BINDING = 3;
+}
+
+GpuCulling::GpuCulling(std::size_t commandsSize, std::size_t maxBatches) :
+    m_commandsSize(commandsSize),
+    m_cullingShader("shaders/culling.comp")
+{
+    GLint storageAlignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    m_storageAlignment = std::max<std::size_t>(storageAlignment, sizeof(GLuint));
+    m_countsSize = maxBatches * sizeof(GLuint);
+
+    glGenBuffers(1, &m_commandsBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandsBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_commandsSize), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &m_countsBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_countsBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_countsSize), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+GpuCulling::~GpuCulling()
+{
+    glDeleteBuffers(1, &m_commandsBuffer);
+    glDeleteBuffers(1, &m_countsBuffer);
+    glDeleteProgram(m_cullingShader.ID);
+    getGLState().invalidate();
+}
+
+void GpuCulling::resize(std::size_t commandsSize)
+{
+    if (commandsSize <= m_commandsSize)
+        return;
+    m_commandsSize = commandsSize;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandsBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_commandsSize), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuCulling::beginFrame()
+{
+    m_countsHead = 0;
+}
+
+void GpuCulling::cull(DrawList& list, const View& view)
+{
+    if (!list.isMultiDraw() || list.empty())
+        return;
+
+    const std::size_t drawCount = list.size();
+    const std::size_t batchCount = list.getBatches().size();
+
+    const std::size_t commandsOffset = list.getCommandsOffset();
+    const std::size_t commandsSize = drawCount * sizeof(DrawElementsIndirectCommand);
+    if (commandsOffset + commandsSize > m_commandsSize)
+    {
+        std::cout << "ERROR::GPU_CULLING::COMMANDS_OUT_OF_RANGE" << std::endl;
+        return;
+    }
+
+    // Counts of every list start at offset aligned for storage buffer binding
+    std::size_t countsOffset = (m_countsHead + m_storageAlignment - 1) / m_storageAlignment * m_storageAlignment;
+    std::size_t countsSize = batchCount * sizeof(GLuint);
+    if (countsOffset + countsSize > m_countsSize)
+    {
+        std::cout << "ERROR::GPU_CULLING::OUT_OF_BATCH_COUNTS" << std::endl;
+        return;
+    }
+    m_countsHead = countsOffset + countsSize;
+
+    // Culled commands stay zero and draw nothing when batch is submitted without count
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandsBuffer);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, static_cast<GLintptr>(commandsOffset), static_cast<GLsizeiptr>(commandsSize), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countsBuffer);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, static_cast<GLintptr>(countsOffset), static_cast<GLsizeiptr>(countsSize), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INPUT_COMMANDS_BINDING, list.getCommandsBuffer(), commandsOffset, commandsSize);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, OUTPUT_COMMANDS_BINDING, m_commandsBuffer, commandsOffset, commandsSize);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, CULL_DATA_BINDING, list.getConstantsBuffer(), list.getCullDataOffset(), drawCount * sizeof(DrawCullData));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BATCH_COUNTS_BINDING, m_countsBuffer, countsOffset, countsSize);
+
+    m_cullingShader.use();
+    m_cullingShader.setUint("drawCount", static_cast<unsigned int>(drawCount));
+    m_cullingShader.setBool("frustumTest", view.frustumTest);
+    for (int i = 0; i < 6; ++i)
+        m_cullingShader.setVec4("planes[" + std::to_string(i) + "]", view.frustum.planes[i]);
+    m_cullingShader.setBool("sphereTest", view.sphereTest);
+    m_cullingShader.setVec4("sphere", glm::vec4(view.sphereCenter, view.sphereRadius));
+    m_cullingShader.setBool("coneTest", view.coneTest);
+    m_cullingShader.setVec3("viewPosition", view.viewPosition);
+
+    const HiZPyramid* hiZ = view.occlusion && view.occlusion->isBuilt() ? view.occlusion : nullptr;
+    m_cullingShader.setBool("occlusionTest", hiZ != nullptr);
+    if (hiZ)
+    {
+        m_cullingShader.setInt("hiZ", 0);
+        m_cullingShader.setMat4("hiZViewProjection", hiZ->getViewProjection());
+        m_cullingShader.setVec2("hiZSize", static_cast<float>(hiZ->getWidth()), static_cast<float>(hiZ->getHeight()));
+        m_cullingShader.setInt("hiZLevels", hiZ->getLevels());
+        getGLState().activeTexture(GL_TEXTURE0);
+        getGLState().bindTexture(GL_TEXTURE_2D, hiZ->getTexture());
+    }
+
+    glDispatchCompute(static_cast<GLuint>((drawCount + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE), 1, 1);
+
+    // Commands and counts are read by indirect draws
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    list.setCulledCommands(m_commandsBuffer, m_countsBuffer, countsOffset);
+}
@@ -0,0 +1,95 @@
+#include <Render/HiZPyramid.h>
+#include <Render/GLStateCache.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // Matches local size of hiz_reduce.comp
+    const int REDUCE_GROUP_SIZE = 8;
+}
+
+HiZPyramid::HiZPyramid(int width, int height) :
+    m_width(width),
+    m_height(height),
+    m_reduceShader("shaders/hiz_reduce.comp")
+{
+    m_levels = 1;
+    while ((std::max(m_width, m_height) >> m_levels) > 0)
+        ++m_levels;
+
+    GLStateCache& state = getGLState();
+    state.activeTexture(GL_TEXTURE0);
+
+    glGenTextures(1, &m_depthTexture);
+    state.bindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, m_width, m_height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenFramebuffers(1, &m_depthFramebuffer);
+    state.bindFramebuffer(GL_FRAMEBUFFER, m_depthFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::HI_Z_PYRAMID::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenTextures(1, &m_pyramid);
+    state.bindTexture(GL_TEXTURE_2D, m_pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, m_levels, GL_R32F, m_width, m_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    state.bindTexture(GL_TEXTURE_2D, 0);
+}
+
+HiZPyramid::~HiZPyramid()
+{
+    glDeleteFramebuffers(1, &m_depthFramebuffer);
+    glDeleteTextures(1, &m_depthTexture);
+    glDeleteTextures(1, &m_pyramid);
+    glDeleteProgram(m_reduceShader.ID);
+    getGLState().invalidate();
+}
+
+void HiZPyramid::build(GLuint sourceFramebuffer, const glm::mat4& viewProjection)
+{
+    GLStateCache& state = getGLState();
+    state.bindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFramebuffer);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_reduceShader.use();
+    m_reduceShader.setInt("source", 0);
+    state.activeTexture(GL_TEXTURE0);
+
+    int sourceWidth = m_width;
+    int sourceHeight = m_height;
+    for (int level = 0; level < m_levels; ++level)
+    {
+        // Level 0 is copy of depth, every next level halves previous one
+        int width = std::max(1, m_width >> level);
+        int height = std::max(1, m_height >> level);
+        state.bindTexture(GL_TEXTURE_2D, level == 0 ? m_depthTexture : m_pyramid);
+        m_reduceShader.setInt("sourceLevel", level == 0 ? 0 : level - 1);
+        m_reduceShader.setIVec2("sourceSize", sourceWidth, sourceHeight);
+        m_reduceShader.setIVec2("destinationSize", width, height);
+        glBindImageTexture(0, m_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, (height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        sourceWidth = width;
+        sourceHeight = height;
+    }
+    state.bindTexture(GL_TEXTURE_2D, 0);
+
+    m_viewProjection = viewProjection;
+    m_built = true;
+}
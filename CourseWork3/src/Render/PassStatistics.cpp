@@ -0,0 +1,96 @@
+#include <Render/PassStatistics.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+PassStatistics::PassStatistics(std::vector<std::string> passNames) :
+    m_supported(isSupported()),
+    m_passNames(std::move(passNames)),
+    m_invocations(m_passNames.size(), 0)
+{
+}
+
+PassStatistics::~PassStatistics()
+{
+    if (!m_allQueries.empty())
+        glDeleteQueries(static_cast<GLsizei>(m_allQueries.size()), m_allQueries.data());
+}
+
+bool PassStatistics::isSupported()
+{
+    if (GLAD_GL_VERSION_4_6)
+        return true;
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, "GL_ARB_pipeline_statistics_query") == 0)
+            return true;
+    }
+    return false;
+}
+
+void PassStatistics::begin(unsigned int pass)
+{
+    if (!m_supported)
+        return;
+    if (m_active)
+    {
+        std::cout << "ERROR::PASS_STATISTICS::NESTED_PASS " << m_passNames[pass] << std::endl;
+        return;
+    }
+
+    GLuint query;
+    if (m_freeQueries.empty())
+    {
+        glGenQueries(1, &query);
+        m_allQueries.push_back(query);
+    }
+    else
+    {
+        query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+
+    // ARB_pipeline_statistics_query uses the same enum value as GL 4.6
+    glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS, query);
+    m_pending.push_back({ query, pass });
+    m_active = true;
+}
+
+void PassStatistics::end()
+{
+    if (!m_active)
+        return;
+    glEndQuery(GL_VERTEX_SHADER_INVOCATIONS);
+    m_active = false;
+}
+
+void PassStatistics::collect()
+{
+    // The last query may still be open
+    std::size_t finished = m_pending.size() - (m_active ? 1 : 0);
+    std::size_t collected = 0;
+    for (; collected < finished; ++collected)
+    {
+        const PendingQuery& pending = m_pending[collected];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 invocations = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &invocations);
+        m_invocations[pending.pass] += invocations;
+        m_freeQueries.push_back(pending.query);
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + collected);
+}
+
+void PassStatistics::resetTotals()
+{
+    std::fill(m_invocations.begin(), m_invocations.end(), 0);
+}
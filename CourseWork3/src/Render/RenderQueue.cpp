@@ -0,0 +1,87 @@
+#include <Render/RenderQueue.h>
+
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    const int RADIX_BITS = 8;
+    const int RADIX_SIZE = 1 << RADIX_BITS;
+    const int RADIX_PASSES = 64 / RADIX_BITS;
+
+    // Bits of non-negative float are ordered like the float itself, top 24 of them keep the order
+    std::uint64_t quantizeDepth(float depth)
+    {
+        if (!(depth > 0.0f))
+            return 0;
+
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 8;
+    }
+}
+
+std::uint64_t RenderQueue::makeKey(Layer layer, std::uint32_t shader, std::uint32_t material, std::uint32_t geometry, float depth)
+{
+    std::uint64_t key = static_cast<std::uint64_t>(layer) << 62;
+    key |= static_cast<std::uint64_t>(shader & 0x3F) << 56;
+
+    std::uint64_t depthBits = quantizeDepth(depth);
+    if (layer == Layer::Opaque)
+    {
+        key |= static_cast<std::uint64_t>(material & 0xFFFF) << 40;
+        key |= static_cast<std::uint64_t>(geometry & 0xFFFF) << 24;
+        key |= depthBits;
+    }
+    else
+    {
+        key |= (~depthBits & 0xFFFFFF) << 32;
+        key |= static_cast<std::uint64_t>(material & 0xFFFF) << 16;
+        key |= static_cast<std::uint64_t>(geometry & 0xFFFF);
+    }
+    return key;
+}
+
+void RenderQueue::sort()
+{
+    std::size_t count = m_items.size();
+    if (count < 2)
+        return;
+
+    // Histograms of all digits are gathered in one pass over keys
+    std::uint32_t histograms[RADIX_PASSES][RADIX_SIZE] = {};
+    for (const Item& item : m_items)
+    {
+        for (int pass = 0; pass < RADIX_PASSES; ++pass)
+            ++histograms[pass][(item.key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)];
+    }
+
+    m_sortBuffer.resize(count);
+    Item* source = m_items.data();
+    Item* destination = m_sortBuffer.data();
+    for (int pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        std::uint32_t* histogram = histograms[pass];
+        int shift = pass * RADIX_BITS;
+
+        // Digit is the same for all keys, pass wouldn't change order
+        if (histogram[(source[0].key >> shift) & (RADIX_SIZE - 1)] == count)
+            continue;
+
+        std::uint32_t offset = 0;
+        for (int digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            std::uint32_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+            destination[histogram[(source[i].key >> shift) & (RADIX_SIZE - 1)]++] = source[i];
+
+        std::swap(source, destination);
+    }
+
+    if (source != m_items.data())
+        m_items.swap(m_sortBuffer);
+}
@@ -0,0 +1,128 @@
+#include <Render/RingBuffer.h>
+
+#include <algorithm>
+#include <iostream>
+
+RingBuffer::RingBuffer(GLenum target, std::size_t regionSize, std::size_t alignment, unsigned int regions) :
+    m_target(target),
+    m_alignment(std::max<std::size_t>(alignment, 1)),
+    m_regions(std::max(regions, 1u)),
+    m_fences(m_regions, nullptr)
+{
+    // Every region starts at aligned offset
+    m_regionSize = (regionSize + m_alignment - 1) / m_alignment * m_alignment;
+    create();
+}
+
+void RingBuffer::create()
+{
+    GLsizeiptr bufferSize = static_cast<GLsizeiptr>(m_regionSize * m_regions);
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(m_target, m_buffer);
+    if (GLAD_GL_VERSION_4_4)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(m_target, bufferSize, nullptr, flags);
+        m_mapped = static_cast<char*>(glMapBufferRange(m_target, 0, bufferSize, flags));
+        if (!m_mapped)
+            std::cout << "ERROR::RING_BUFFER::MAPPING_FAILED" << std::endl;
+    }
+    else
+    {
+        glBufferData(m_target, bufferSize, nullptr, GL_STREAM_DRAW);
+        m_staging.resize(m_regionSize);
+    }
+    glBindBuffer(m_target, 0);
+}
+
+RingBuffer::~RingBuffer()
+{
+    for (GLsync fence : m_fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+
+    if (m_mapped)
+    {
+        glBindBuffer(m_target, m_buffer);
+        glUnmapBuffer(m_target);
+        glBindBuffer(m_target, 0);
+    }
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void RingBuffer::grow()
+{
+    std::size_t required = std::max(m_head.load(), 2 * m_regionSize);
+    std::cout << "RING_BUFFER::GROW " << m_regionSize / 1024 << " KB -> " << required / 1024 << " KB per frame" << std::endl;
+
+    // Fences guard regions of the old buffer only, deleting it doesn't stall on pending draws
+    for (GLsync& fence : m_fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (m_mapped)
+    {
+        glBindBuffer(m_target, m_buffer);
+        glUnmapBuffer(m_target);
+        glBindBuffer(m_target, 0);
+        m_mapped = nullptr;
+    }
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+
+    m_regionSize = (required + m_alignment - 1) / m_alignment * m_alignment;
+    m_currentRegion = 0;
+    m_head = 0;
+    create();
+}
+
+void RingBuffer::beginFrame()
+{
+    m_currentRegion = (m_currentRegion + 1) % m_regions;
+    m_head = 0;
+
+    GLsync& fence = m_fences[m_currentRegion];
+    if (!fence)
+        return;
+
+    // Usually the fence has been signaled long ago, wait only if GPU is more than regions - 1 frames behind
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void RingBuffer::endFrame()
+{
+    m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* RingBuffer::allocate(std::size_t size, std::size_t& offset)
+{
+    std::size_t alignedSize = (size + m_alignment - 1) / m_alignment * m_alignment;
+    std::size_t head = m_head.fetch_add(alignedSize, std::memory_order_relaxed);
+    if (head + alignedSize > m_regionSize)
+        return nullptr;
+
+    offset = m_currentRegion * m_regionSize + head;
+    return m_mapped ? m_mapped + offset : m_staging.data() + head;
+}
+
+void RingBuffer::flush()
+{
+    if (m_mapped)
+        return;
+
+    std::size_t used = std::min(m_head.load(), m_regionSize);
+    if (used == 0)
+        return;
+
+    glBindBuffer(m_target, m_buffer);
+    glBufferSubData(m_target, static_cast<GLintptr>(m_currentRegion * m_regionSize), static_cast<GLsizeiptr>(used), m_staging.data());
+    glBindBuffer(m_target, 0);
+}
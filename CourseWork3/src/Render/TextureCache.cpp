@@ -0,0 +1,431 @@
+#include <Render/TextureCache.h>
+#include <Render/BlockCompression.h>
+
+#include "stb_image.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+namespace
+{
+    const char MAGIC[8] = { 'C', 'W', '3', 'T', 'E', 'X', 'T', 'R' };
+    const size_t DATA_ALIGNMENT = 16;
+
+    // Usage is in low bits
+    const uint32_t OPTION_COLOR_COMPRESSION = 1u << 8;
+
+    // All offsets are in bytes from the start of file
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t options;
+        uint64_t fileSize;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t sourceHash;
+        uint32_t format;
+        uint32_t compressed;
+        uint32_t levelCount;
+        uint32_t padding;
+        uint64_t levelTable;
+        uint64_t data;
+        uint64_t dataSize;
+    };
+
+    struct LevelRecord
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;        // relative to data
+        uint64_t size;
+    };
+
+    // Size and modification time identify source file cheaply, hash is checked only when time differs
+    struct SourceKey
+    {
+        uint64_t size;
+        int64_t time;
+    };
+
+    bool getSourceKey(const string& path, SourceKey& key)
+    {
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+            return false;
+        key.size = static_cast<uint64_t>(status.st_size);
+        key.time = static_cast<int64_t>(status.st_mtime);
+        return true;
+    }
+
+    uint64_t hashFile(const string& path)
+    {
+        MappedFile file;
+        file.open(path);
+        return file.hash();
+    }
+
+    uint32_t getOptions(TextureUsage usage, bool colorCompression)
+    {
+        return static_cast<uint32_t>(usage) | (colorCompression ? OPTION_COLOR_COMPRESSION : 0u);
+    }
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    unsigned char linearToSrgb(float value)
+    {
+        value = std::min(std::max(value, 0.0f), 1.0f);
+        float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<unsigned char>(encoded * 255.0f + 0.5f);
+    }
+
+    // Components of texels a usage is stored with before compression
+    int getComponents(TextureUsage usage)
+    {
+        switch (usage)
+        {
+        case TextureUsage::Normal: return 2;
+        case TextureUsage::Mask: return 1;
+        default: return 4;
+        }
+    }
+
+    // Converts decoded image to components of usage. Missing color components are replicated
+    // from the first one, missing alpha is opaque.
+    vector<unsigned char> convert(const unsigned char* image, int width, int height, int components, TextureUsage usage)
+    {
+        int target = getComponents(usage);
+        size_t count = static_cast<size_t>(width) * height;
+        vector<unsigned char> result(count * target);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const unsigned char* source = image + i * components;
+            unsigned char* texel = result.data() + i * target;
+            texel[0] = source[0];
+            if (target >= 2)
+                texel[1] = components >= 3 ? source[1] : usage == TextureUsage::Normal && components == 2 ? source[1] : source[0];
+            if (target == 4)
+            {
+                texel[2] = components >= 3 ? source[2] : source[0];
+                texel[3] = components == 4 ? source[3] : components == 2 ? source[1] : 255;
+            }
+        }
+        return result;
+    }
+
+    // Averages 2x2 texels in linear space, the last texel of odd rows and columns is repeated
+    vector<unsigned char> downsample(const vector<unsigned char>& source, int width, int height, TextureUsage usage)
+    {
+        static const vector<float> SRGB_TO_LINEAR = []()
+        {
+            vector<float> table(256);
+            for (int i = 0; i < 256; ++i)
+                table[i] = srgbToLinear(i / 255.0f);
+            return table;
+        }();
+
+        int components = getComponents(usage);
+        int targetWidth = max(width / 2, 1);
+        int targetHeight = max(height / 2, 1);
+        vector<unsigned char> result(static_cast<size_t>(targetWidth) * targetHeight * components);
+        unsigned char* target = result.data();
+        for (int y = 0; y < targetHeight; ++y)
+        {
+            for (int x = 0; x < targetWidth; ++x)
+            {
+                const unsigned char* texels[4];
+                for (int i = 0; i < 4; ++i)
+                {
+                    int sourceX = min(2 * x + (i & 1), width - 1);
+                    int sourceY = min(2 * y + (i >> 1), height - 1);
+                    texels[i] = source.data() + (static_cast<size_t>(sourceY) * width + sourceX) * components;
+                }
+
+                if (usage == TextureUsage::Color)
+                {
+                    for (int c = 0; c < 3; ++c)
+                        target[c] = linearToSrgb(0.25f * (SRGB_TO_LINEAR[texels[0][c]] + SRGB_TO_LINEAR[texels[1][c]]
+                            + SRGB_TO_LINEAR[texels[2][c]] + SRGB_TO_LINEAR[texels[3][c]]));
+                    target[3] = static_cast<unsigned char>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+                }
+                else if (usage == TextureUsage::Normal)
+                {
+                    // z is reconstructed as shaders do, sum of unit vectors is normalized again
+                    float sum[3] = {};
+                    for (const unsigned char* texel : texels)
+                    {
+                        float nx = texel[0] / 255.0f * 2.0f - 1.0f;
+                        float ny = texel[1] / 255.0f * 2.0f - 1.0f;
+                        sum[0] += nx;
+                        sum[1] += ny;
+                        sum[2] += std::sqrt(max(1.0f - nx * nx - ny * ny, 0.0f));
+                    }
+                    float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                    for (int c = 0; c < 2; ++c)
+                    {
+                        float value = length > 0.0f ? sum[c] / length : 0.0f;
+                        target[c] = static_cast<unsigned char>(std::min(std::max(value * 0.5f + 0.5f, 0.0f), 1.0f) * 255.0f + 0.5f);
+                    }
+                }
+                else
+                {
+                    target[0] = static_cast<unsigned char>((texels[0][0] + texels[1][0] + texels[2][0] + texels[3][0] + 2) / 4);
+                }
+                target += components;
+            }
+        }
+        return result;
+    }
+
+    // Range of count items of type T at offset lies within file and is aligned
+    template <typename T>
+    bool isValidRange(uint64_t offset, uint64_t count, uint64_t fileSize)
+    {
+        return offset % alignof(T) == 0 && offset <= fileSize && count <= (fileSize - offset) / sizeof(T);
+    }
+}
+
+string TextureCache::getCachePath(const string& sourcePath, TextureUsage usage)
+{
+    const char* name = usage == TextureUsage::Normal ? "normal" : usage == TextureUsage::Mask ? "mask" : "color";
+    return sourcePath + '.' + name + ".cache";
+}
+
+bool TextureCache::isColorCompressionSupported()
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+            return true;
+    }
+    return false;
+}
+
+bool TextureCache::open(const string& sourcePath, TextureUsage usage, bool colorCompression)
+{
+    SourceKey key;
+    if (!getSourceKey(sourcePath, key) || !m_file.open(getCachePath(sourcePath, usage)))
+        return false;
+
+    if (!validate())
+    {
+        cout << "ERROR::TEXTURE_CACHE::INVALID_FILE " << getCachePath(sourcePath, usage) << endl;
+        m_file.close();
+        return false;
+    }
+
+    const FileHeader& header = *at<FileHeader>(0);
+    bool touched = header.sourceTime != key.time;
+    bool fresh = header.sourceSize == key.size && (!touched || header.sourceHash == hashFile(sourcePath));
+    if (!fresh || header.options != getOptions(usage, colorCompression))
+    {
+        m_file.close();
+        return false;
+    }
+
+    // Source was touched without changes, new time is stored so later opens don't hash it again
+    if (touched)
+    {
+        string cachePath = getCachePath(sourcePath, usage);
+        m_file.close();
+        {
+            fstream file(cachePath, ios::binary | ios::in | ios::out);
+            file.seekp(static_cast<streamoff>(offsetof(FileHeader, sourceTime)));
+            file.write(reinterpret_cast<const char*>(&key.time), sizeof(key.time));
+            if (!file)
+                cout << "ERROR::TEXTURE_CACHE::FAILED_TO_WRITE " << cachePath << endl;
+        }
+        if (!m_file.open(cachePath) || !validate())
+        {
+            m_file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextureCache::validate() const
+{
+    uint64_t size = m_file.getSize();
+    if (size < sizeof(FileHeader))
+        return false;
+
+    const FileHeader& header = *at<FileHeader>(0);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.fileSize != size
+        || header.levelCount == 0)
+        return false;
+    if (!isValidRange<LevelRecord>(header.levelTable, header.levelCount, size)
+        || !isValidRange<unsigned char>(header.data, header.dataSize, size))
+        return false;
+
+    const LevelRecord* levels = at<LevelRecord>(header.levelTable);
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        if (levels[i].offset > header.dataSize || levels[i].size > header.dataSize - levels[i].offset
+            || levels[i].width == 0 || levels[i].height == 0)
+            return false;
+    }
+    return true;
+}
+
+GLenum TextureCache::getFormat() const
+{
+    return at<FileHeader>(0)->format;
+}
+
+bool TextureCache::isCompressed() const
+{
+    return at<FileHeader>(0)->compressed != 0;
+}
+
+vector<CookedLevel> TextureCache::getLevels() const
+{
+    const FileHeader& header = *at<FileHeader>(0);
+    vector<CookedLevel> levels;
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        const LevelRecord& record = at<LevelRecord>(header.levelTable)[i];
+        levels.push_back({ static_cast<int>(record.width), static_cast<int>(record.height),
+            static_cast<size_t>(record.offset), static_cast<size_t>(record.size) });
+    }
+    return levels;
+}
+
+const unsigned char* TextureCache::getData() const
+{
+    return m_file.getData() + at<FileHeader>(0)->data;
+}
+
+bool TextureCache::cook(const string& sourcePath, TextureUsage usage, bool colorCompression, CookedTexture& result)
+{
+    int width = 0, height = 0, components = 0;
+    unique_ptr<unsigned char, void (*)(void*)> image(stbi_load(sourcePath.c_str(), &width, &height, &components, 0), stbi_image_free);
+    if (!image)
+        return false;
+
+    vector<unsigned char> level = convert(image.get(), width, height, components, usage);
+    image.reset();
+
+    // Alpha decides between BC1 and BC3 for the whole chain
+    bc::Format format = bc::Format::BC1;
+    if (usage == TextureUsage::Color)
+    {
+        for (size_t i = 3; i < level.size(); i += 4)
+        {
+            if (level[i] != 255)
+            {
+                format = bc::Format::BC3;
+                break;
+            }
+        }
+    }
+    else
+    {
+        format = usage == TextureUsage::Normal ? bc::Format::BC5 : bc::Format::BC4;
+    }
+    result.compressed = usage != TextureUsage::Color || colorCompression;
+    switch (format)
+    {
+    case bc::Format::BC1: result.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+    case bc::Format::BC3: result.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+    case bc::Format::BC4: result.format = GL_COMPRESSED_RED_RGTC1; break;
+    case bc::Format::BC5: result.format = GL_COMPRESSED_RG_RGTC2; break;
+    }
+    if (!result.compressed)
+        result.format = GL_RGBA8;
+
+    result.levels.clear();
+    result.data.clear();
+    for (;;)
+    {
+        CookedLevel cooked = { width, height, result.data.size(), 0 };
+        if (result.compressed)
+        {
+            vector<unsigned char> blocks = bc::compress(format, level.data(), width, height, getComponents(usage));
+            result.data.insert(result.data.end(), blocks.begin(), blocks.end());
+        }
+        else
+        {
+            result.data.insert(result.data.end(), level.begin(), level.end());
+        }
+        cooked.size = result.data.size() - cooked.offset;
+        result.levels.push_back(cooked);
+
+        if (width == 1 && height == 1)
+            break;
+        level = downsample(level, width, height, usage);
+        width = max(width / 2, 1);
+        height = max(height / 2, 1);
+    }
+    return true;
+}
+
+bool TextureCache::write(const string& sourcePath, TextureUsage usage, bool colorCompression, const CookedTexture& texture)
+{
+    SourceKey key;
+    if (!getSourceKey(sourcePath, key))
+        return false;
+
+    FileHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.options = getOptions(usage, colorCompression);
+    header.sourceSize = key.size;
+    header.sourceTime = key.time;
+    header.sourceHash = hashFile(sourcePath);
+    header.format = texture.format;
+    header.compressed = texture.compressed ? 1 : 0;
+    header.levelCount = static_cast<uint32_t>(texture.levels.size());
+    header.levelTable = sizeof(FileHeader);
+
+    vector<LevelRecord> levels;
+    for (const CookedLevel& level : texture.levels)
+        levels.push_back({ static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height), level.offset, level.size });
+    uint64_t levelsEnd = header.levelTable + levels.size() * sizeof(LevelRecord);
+    header.data = (levelsEnd + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    header.dataSize = texture.data.size();
+    header.fileSize = header.data + header.dataSize;
+
+    // Written under temporary name, so a concurrent or interrupted run never sees a partial file
+    string cachePath = getCachePath(sourcePath, usage);
+    string temporaryPath = cachePath + ".tmp";
+    {
+        ofstream output(temporaryPath, ios::binary | ios::trunc);
+        const char padding[DATA_ALIGNMENT] = {};
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(reinterpret_cast<const char*>(levels.data()), static_cast<streamsize>(levels.size() * sizeof(LevelRecord)));
+        output.write(padding, static_cast<streamsize>(header.data - levelsEnd));
+        output.write(reinterpret_cast<const char*>(texture.data.data()), static_cast<streamsize>(texture.data.size()));
+        if (!output)
+        {
+            cout << "ERROR::TEXTURE_CACHE::FAILED_TO_WRITE " << temporaryPath << endl;
+            output.close();
+            remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    remove(cachePath.c_str());
+    if (rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+    {
+        cout << "ERROR::TEXTURE_CACHE::FAILED_TO_WRITE " << cachePath << endl;
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
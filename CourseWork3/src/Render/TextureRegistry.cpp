@@ -0,0 +1,159 @@
+#include <Render/TextureRegistry.h>
+#include <Core/MappedFile.h>
+#include <Render/GLStateCache.h>
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    // Absolute path with links and dots resolved, empty if file doesn't exist
+    std::string canonicalPath(const std::string& path)
+    {
+#ifdef _WIN32
+        char resolved[_MAX_PATH];
+        if (!_fullpath(resolved, path.c_str(), _MAX_PATH))
+            return std::string();
+        return std::ifstream(resolved).good() ? std::string(resolved) : std::string();
+#else
+        char resolved[PATH_MAX];
+        return realpath(path.c_str(), resolved) ? std::string(resolved) : std::string();
+#endif
+    }
+}
+
+GLuint TextureRegistry::acquire(const TextureKey& key)
+{
+    GLuint texture = 0;
+    auto byPath = key.path.empty() ? m_byPath.end() : m_byPath.find(getPathKey(key));
+    if (byPath != m_byPath.end())
+    {
+        texture = byPath->second;
+        ++m_pathHits;
+    }
+    else
+    {
+        auto byContent = key.contentHash == 0 ? m_byContent.end() : m_byContent.find(getContentKey(key));
+        if (byContent == m_byContent.end())
+            return 0;
+        texture = byContent->second;
+        ++m_contentHits;
+        // the other path leads to this texture from now on
+        if (!key.path.empty())
+            m_byPath[getPathKey(key)] = texture;
+    }
+
+    Entry& entry = m_entries.at(texture);
+    ++entry.references;
+    m_savedBytes += entry.size;
+    return texture;
+}
+
+void TextureRegistry::add(const TextureKey& key, GLuint texture, std::size_t size, Deleter deleter)
+{
+    auto added = m_entries.emplace(texture, Entry{ key, size, 1, std::move(deleter) });
+    if (!added.second)
+    {
+        std::cout << "ERROR::TEXTURE_REGISTRY::ALREADY_REGISTERED " << texture << std::endl;
+        return;
+    }
+    if (!key.path.empty())
+        m_byPath[getPathKey(key)] = texture;
+    if (key.contentHash != 0)
+        m_byContent.emplace(getContentKey(key), texture);
+    m_loadedBytes += size;
+}
+
+bool TextureRegistry::addReference(GLuint texture)
+{
+    auto found = m_entries.find(texture);
+    if (found == m_entries.end())
+        return false;
+    ++found->second.references;
+    return true;
+}
+
+void TextureRegistry::release(GLuint texture)
+{
+    auto found = m_entries.find(texture);
+    if (found == m_entries.end())
+        return;
+    if (--found->second.references == 0)
+    {
+        remove(texture, found->second);
+        m_entries.erase(found);
+    }
+}
+
+void TextureRegistry::releaseAll()
+{
+    for (auto& entry : m_entries)
+        remove(entry.first, entry.second);
+    m_entries.clear();
+}
+
+void TextureRegistry::remove(GLuint texture, Entry& entry)
+{
+    // Paths and content hash may lead here from several keys
+    for (auto i = m_byPath.begin(); i != m_byPath.end(); )
+        i = i->second == texture ? m_byPath.erase(i) : std::next(i);
+    auto byContent = m_byContent.find(getContentKey(entry.key));
+    if (byContent != m_byContent.end() && byContent->second == texture)
+        m_byContent.erase(byContent);
+    m_loadedBytes -= entry.size;
+
+    if (entry.deleter)
+        entry.deleter(texture);
+    else
+        getGLState().deleteTextures(1, &texture);
+}
+
+std::string TextureRegistry::getPathKey(const TextureKey& key)
+{
+    return std::to_string(static_cast<std::uint32_t>(key.usage)) + ':' + key.path;
+}
+
+std::uint64_t TextureRegistry::getContentKey(const TextureKey& key)
+{
+    return (key.contentHash ^ static_cast<std::uint64_t>(key.usage)) * 1099511628211ull;
+}
+
+TextureKey TextureRegistry::makeKey(const std::string& path, TextureUsage usage)
+{
+    TextureKey key;
+    key.path = canonicalPath(path);
+    key.usage = usage;
+    MappedFile file;
+    if (file.open(path))
+        key.contentHash = file.hash();
+    return key;
+}
+
+TextureKey TextureRegistry::makeKey(const std::vector<std::string>& paths, TextureUsage usage)
+{
+    // Paths are joined, hashes are combined in order of files
+    TextureKey key;
+    bool resolved = true;
+    for (const std::string& path : paths)
+    {
+        TextureKey part = makeKey(path);
+        resolved = resolved && !part.path.empty();
+        key.path += part.path + '|';
+        if (part.contentHash == 0)
+            resolved = false;
+        key.contentHash = (key.contentHash ^ part.contentHash) * 1099511628211ull;
+    }
+    if (!resolved)
+        key = TextureKey();
+    key.usage = usage;
+    return key;
+}
+
+TextureRegistry& getTextureRegistry()
+{
+    static TextureRegistry registry;
+    return registry;
+}
@@ -0,0 +1,491 @@
+#include <Render/TextureStreamer.h>
+#include <Render/GLStateCache.h>
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+    GLenum formatOf(int components)
+    {
+        switch (components)
+        {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+        }
+    }
+
+    unsigned char toByte(float value)
+    {
+        return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Box filters every level from the previous one, the last texel of odd rows and columns is repeated
+    void buildMipChain(const unsigned char* image, int width, int height, int components,
+        std::vector<unsigned char>& pixels, std::vector<std::size_t>& offsets)
+    {
+        std::size_t total = 0;
+        for (int w = width, h = height; ; w = std::max(w / 2, 1), h = std::max(h / 2, 1))
+        {
+            offsets.push_back(total);
+            total += static_cast<std::size_t>(w) * h * components;
+            if (w == 1 && h == 1)
+                break;
+        }
+        pixels.resize(total);
+        std::memcpy(pixels.data(), image, offsets.size() > 1 ? offsets[1] : total);
+
+        int sourceWidth = width;
+        int sourceHeight = height;
+        for (std::size_t level = 1; level < offsets.size(); ++level)
+        {
+            const unsigned char* source = pixels.data() + offsets[level - 1];
+            unsigned char* target = pixels.data() + offsets[level];
+            int targetWidth = std::max(sourceWidth / 2, 1);
+            int targetHeight = std::max(sourceHeight / 2, 1);
+            for (int y = 0; y < targetHeight; ++y)
+            {
+                const unsigned char* row0 = source + static_cast<std::size_t>(std::min(2 * y, sourceHeight - 1)) * sourceWidth * components;
+                const unsigned char* row1 = source + static_cast<std::size_t>(std::min(2 * y + 1, sourceHeight - 1)) * sourceWidth * components;
+                for (int x = 0; x < targetWidth; ++x)
+                {
+                    int x0 = std::min(2 * x, sourceWidth - 1) * components;
+                    int x1 = std::min(2 * x + 1, sourceWidth - 1) * components;
+                    for (int c = 0; c < components; ++c)
+                        *target++ = static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+            sourceWidth = targetWidth;
+            sourceHeight = targetHeight;
+        }
+    }
+}
+
+TextureStreamer::TextureStreamer(unsigned int decodeThreads, std::size_t frameBudget, std::size_t memoryBudget) :
+    m_frameBudget(frameBudget),
+    m_memoryBudget(memoryBudget),
+    m_colorCompression(TextureCache::isColorCompressionSupported())
+{
+    if (decodeThreads == 0)
+        decodeThreads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    for (unsigned int i = 0; i < decodeThreads; ++i)
+        m_threads.emplace_back(&TextureStreamer::decodeLoop, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+
+    for (UploadBuffer& buffer : m_buffers)
+    {
+        if (buffer.fence)
+            glDeleteSync(buffer.fence);
+        if (buffer.buffer)
+            glDeleteBuffers(1, &buffer.buffer);
+    }
+}
+
+GLuint TextureStreamer::request(const std::string& path, glm::vec4 placeholder, TextureUsage usage)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+
+    // Single texel has no mipmaps, so filter must not use them until the image arrives
+    const unsigned char texel[4] = { toByte(placeholder.x), toByte(placeholder.y), toByte(placeholder.z), toByte(placeholder.w) };
+    getGLState().bindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    getGLState().bindTexture(GL_TEXTURE_2D, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back({ texture, m_nextTicket, path, usage, m_cooking });
+    }
+    m_wakeUp.notify_one();
+    m_requested[texture] = m_nextTicket++;
+    return texture;
+}
+
+void TextureStreamer::decodeLoop()
+{
+    for (;;)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+            if (m_stopping)
+                return;
+            request = std::move(m_requests.front());
+            m_requests.pop_front();
+        }
+
+        StreamedTexture texture;
+        texture.texture = request.texture;
+        texture.ticket = request.ticket;
+        texture.path = std::move(request.path);
+        if (request.cook ? loadCooked(texture, request.usage) : loadImage(texture))
+        {
+            for (std::size_t level = 0; level < texture.levels.size(); ++level)
+            {
+                if (std::max(texture.levels[level].width, texture.levels[level].height) > TAIL_SIZE)
+                    texture.tailLevel = static_cast<int>(level + 1);
+            }
+            texture.residentLevel = texture.wantedLevel = texture.tailLevel;
+        }
+        else
+        {
+            std::ostringstream message;
+            message << "Texture failed to load at path: " << texture.path << std::endl;
+            std::cout << message.str();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.push_back(std::move(texture));
+    }
+}
+
+bool TextureStreamer::loadImage(StreamedTexture& texture) const
+{
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::unique_ptr<unsigned char, void (*)(void*)> image(
+        stbi_load(texture.path.c_str(), &width, &height, &components, 0), stbi_image_free);
+    if (!image)
+        return false;
+
+    std::vector<std::size_t> offsets;
+    buildMipChain(image.get(), width, height, components, texture.pixels, offsets);
+    texture.internalFormat = texture.pixelFormat = formatOf(components);
+    for (std::size_t level = 0; level < offsets.size(); ++level)
+    {
+        std::size_t end = level + 1 < offsets.size() ? offsets[level + 1] : texture.pixels.size();
+        std::size_t videoSize = static_cast<std::size_t>(width) * height * (components == 3 ? 4 : components);
+        texture.levels.push_back({ width, height, offsets[level], end - offsets[level], videoSize });
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return true;
+}
+
+bool TextureStreamer::loadCooked(StreamedTexture& texture, TextureUsage usage) const
+{
+    std::vector<CookedLevel> levels;
+    std::unique_ptr<TextureCache> cache(new TextureCache());
+    if (cache->open(texture.path, usage, m_colorCompression))
+    {
+        texture.internalFormat = cache->getFormat();
+        texture.compressed = cache->isCompressed();
+        levels = cache->getLevels();
+        texture.cache = std::move(cache);
+    }
+    else
+    {
+        // Cooked data is used even if the cache can't be written, the next run just cooks again
+        CookedTexture cooked;
+        if (!TextureCache::cook(texture.path, usage, m_colorCompression, cooked))
+            return false;
+        TextureCache::write(texture.path, usage, m_colorCompression, cooked);
+        texture.internalFormat = cooked.format;
+        texture.compressed = cooked.compressed;
+        levels = std::move(cooked.levels);
+        texture.pixels = std::move(cooked.data);
+    }
+
+    // Uncompressed cooked levels are RGBA
+    texture.pixelFormat = texture.compressed ? 0 : GL_RGBA;
+    for (const CookedLevel& level : levels)
+        texture.levels.push_back({ level.width, level.height, level.offset, level.size, level.size });
+    return true;
+}
+
+void TextureStreamer::update()
+{
+    ++m_frame;
+    if (!m_requested.empty())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (StreamedTexture& texture : m_decoded)
+            m_ready.push_back(std::move(texture));
+        m_decoded.clear();
+    }
+
+    // Tails of new textures go first, so placeholders are replaced as soon as possible
+    std::size_t uploaded = 0;
+    while (!m_ready.empty())
+    {
+        StreamedTexture& texture = m_ready.front();
+        auto requested = m_requested.find(texture.texture);
+        if (requested == m_requested.end() || requested->second != texture.ticket)
+        {
+            // released while it was decoded
+            m_ready.pop_front();
+            continue;
+        }
+        if (texture.levels.empty())
+        {
+            // failed image keeps its placeholder
+            m_requested.erase(requested);
+            m_ready.pop_front();
+            continue;
+        }
+
+        int levelCount = static_cast<int>(texture.levels.size());
+        std::size_t size = 0;
+        for (int level = texture.tailLevel; level < levelCount; ++level)
+            size += texture.levels[level].size;
+        if (!canUpload(size, uploaded))
+            break;
+
+        getGLState().bindTexture(GL_TEXTURE_2D, texture.texture);
+        if (texture.tailLevel > 0)
+            clearLevel(texture, 0);
+        upload(texture, texture.tailLevel, levelCount);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.tailLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        uploaded += size;
+        ++m_uploaded;
+
+        for (int level = 0; level < levelCount; ++level)
+        {
+            if (level >= texture.tailLevel)
+                m_residentBytes += getVideoSize(texture, level);
+            m_fullBytes += getVideoSize(texture, level);
+        }
+        m_textureIndices[texture.texture] = m_textures.size();
+        m_textures.push_back(std::move(texture));
+        m_requested.erase(requested);
+        m_ready.pop_front();
+    }
+
+    streamLevels(uploaded);
+
+    if (m_uploading)
+    {
+        // other uploads pass client memory, which is read as buffer offset while a pixel buffer is bound
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        m_uploading = false;
+    }
+    getGLState().bindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureStreamer::release(GLuint texture)
+{
+    // Image still decoded or waiting for upload is dropped by its ticket
+    m_requested.erase(texture);
+    auto found = m_textureIndices.find(texture);
+    if (found != m_textureIndices.end())
+    {
+        std::size_t index = found->second;
+        StreamedTexture& streamed = m_textures[index];
+        for (int level = 0; level < static_cast<int>(streamed.levels.size()); ++level)
+        {
+            if (level >= streamed.residentLevel)
+                m_residentBytes -= getVideoSize(streamed, level);
+            m_fullBytes -= getVideoSize(streamed, level);
+        }
+        m_textureIndices.erase(found);
+        if (index + 1 != m_textures.size())
+        {
+            m_textures[index] = std::move(m_textures.back());
+            m_textureIndices[m_textures[index].texture] = index;
+        }
+        m_textures.pop_back();
+    }
+    getGLState().deleteTextures(1, &texture);
+}
+
+void TextureStreamer::recordUse(GLuint texture, float texCoordsPerPixel)
+{
+    if (!m_mipStreaming)
+        return;
+    auto found = m_textureIndices.find(texture);
+    if (found == m_textureIndices.end())
+        return;
+
+    // Level whose texels are about as big as a pixel, finer one is taken when in between
+    StreamedTexture& streamed = m_textures[found->second];
+    float texelsPerPixel = texCoordsPerPixel * std::max(streamed.levels[0].width, streamed.levels[0].height);
+    int level = texelsPerPixel > 1.0f ? static_cast<int>(std::log2(texelsPerPixel)) : 0;
+    level = std::min(level, streamed.tailLevel);
+    if (streamed.usedFrame != m_frame)
+        streamed.wantedLevel = level;
+    else
+        streamed.wantedLevel = std::min(streamed.wantedLevel, level);
+    streamed.usedFrame = m_frame;
+}
+
+int TextureStreamer::getTargetLevel(const StreamedTexture& texture) const
+{
+    if (!m_mipStreaming)
+        return 0;
+    if (m_frame - texture.usedFrame > KEEP_FRAMES)
+        return texture.tailLevel;
+    return texture.wantedLevel;
+}
+
+void TextureStreamer::streamLevels(std::size_t& uploaded)
+{
+    // Textures furthest from their target level come first
+    std::vector<std::pair<int, std::size_t>> missing;
+    for (std::size_t i = 0; i < m_textures.size(); ++i)
+    {
+        int target = getTargetLevel(m_textures[i]);
+        if (m_textures[i].residentLevel > target)
+            missing.emplace_back(m_textures[i].residentLevel - target, i);
+    }
+    std::sort(missing.begin(), missing.end(), [](const std::pair<int, std::size_t>& a, const std::pair<int, std::size_t>& b)
+    {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    for (const std::pair<int, std::size_t>& entry : missing)
+    {
+        StreamedTexture& texture = m_textures[entry.second];
+        int level = texture.residentLevel - 1;
+        std::size_t videoSize = getVideoSize(texture, level);
+        if (m_mipStreaming && !makeRoom(videoSize, entry.second))
+            continue;
+        if (!canUpload(texture.levels[level].size, uploaded))
+            return;
+
+        getGLState().bindTexture(GL_TEXTURE_2D, texture.texture);
+        upload(texture, level, level + 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        texture.residentLevel = level;
+        uploaded += texture.levels[level].size;
+        m_residentBytes += videoSize;
+    }
+}
+
+bool TextureStreamer::makeRoom(std::size_t size, std::size_t except)
+{
+    while (m_residentBytes + size > m_memoryBudget)
+    {
+        // Levels of texture unused for the longest time are released first
+        StreamedTexture* victim = nullptr;
+        for (std::size_t i = 0; i < m_textures.size(); ++i)
+        {
+            StreamedTexture& texture = m_textures[i];
+            if (i == except || texture.residentLevel >= getTargetLevel(texture))
+                continue;
+            if (!victim || texture.usedFrame < victim->usedFrame)
+                victim = &texture;
+        }
+        if (!victim)
+            return false;
+        releaseLevel(*victim);
+    }
+    return true;
+}
+
+void TextureStreamer::releaseLevel(StreamedTexture& texture)
+{
+    // Base level is moved first, so texture stays complete, then storage of the level is freed
+    int level = texture.residentLevel;
+    getGLState().bindTexture(GL_TEXTURE_2D, texture.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    clearLevel(texture, level);
+    texture.residentLevel = level + 1;
+    m_residentBytes -= getVideoSize(texture, level);
+}
+
+void TextureStreamer::clearLevel(const StreamedTexture& texture, int level)
+{
+    if (texture.compressed)
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, 0, 0, 0, 0, nullptr);
+    else
+        glTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, 0, 0, 0, texture.pixelFormat, GL_UNSIGNED_BYTE, nullptr);
+}
+
+std::size_t TextureStreamer::getVideoSize(const StreamedTexture& texture, int level) const
+{
+    return texture.levels[level].videoSize;
+}
+
+bool TextureStreamer::canUpload(std::size_t size, std::size_t uploaded)
+{
+    if (uploaded > 0 && uploaded + size > m_frameBudget)
+        return false;
+
+    UploadBuffer& buffer = m_buffers[m_nextBuffer];
+    if (buffer.fence)
+    {
+        if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+    return true;
+}
+
+void TextureStreamer::upload(const StreamedTexture& texture, int first, int last)
+{
+    if (!m_uploading)
+    {
+        // rows of 1 and 3 component levels are not 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        m_uploading = true;
+    }
+
+    UploadBuffer& buffer = m_buffers[m_nextBuffer];
+    m_nextBuffer = (m_nextBuffer + 1) % UPLOAD_BUFFERS;
+    std::size_t begin = texture.levels[first].offset;
+    GLsizeiptr size = static_cast<GLsizeiptr>(texture.levels[last - 1].offset + texture.levels[last - 1].size - begin);
+    if (!buffer.buffer)
+        glGenBuffers(1, &buffer.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+    if (buffer.size < size)
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        buffer.size = size;
+    }
+
+    // previous upload from this buffer is finished (see canUpload), so no synchronization is needed
+    void* data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!data)
+    {
+        std::cout << "ERROR::TEXTURE_STREAMER::MAP_FAILED " << texture.path << std::endl;
+        return;
+    }
+    const unsigned char* levels = texture.cache ? texture.cache->getData() : texture.pixels.data();
+    std::memcpy(data, levels + begin, static_cast<std::size_t>(size));
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // Texture is bound by caller, levels are read at their offsets in buffer
+    for (int level = first; level < last; ++level)
+    {
+        const MipLevel& mip = texture.levels[level];
+        const void* offset = reinterpret_cast<const void*>(mip.offset - begin);
+        if (texture.compressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, mip.width, mip.height, 0,
+                static_cast<GLsizei>(mip.size), offset);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, mip.width, mip.height, 0, texture.pixelFormat,
+                GL_UNSIGNED_BYTE, offset);
+    }
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
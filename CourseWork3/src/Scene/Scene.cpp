@@ -0,0 +1,224 @@
+#include <Scene/Scene.h>
+
+namespace
+{
+    // Number of mesh instances whose bounds are transformed by one job
+    const std::size_t INSTANCE_BOUNDS_PER_JOB = 1024;
+}
+
+Scene::Scene()
+    : m_sun(glm::vec3(0, -1, 0), glm::vec3(0.98, 0.831, 0.25))
+{
+}
+
+ModelHandle Scene::addModel(Model model)
+{
+    return m_models.add(std::move(model));
+}
+
+void Scene::removeModel(ModelHandle handle)
+{
+    for (std::size_t i = m_objects.size(); i > 0; --i)
+    {
+        if (m_objects[i - 1].getModel() == handle)
+            removeObject(m_objects.getHandle(i - 1));
+    }
+    m_models.remove(handle);
+}
+
+ModelHandle Scene::findModel(const std::string& directory) const
+{
+    for (std::size_t i = 0; i < m_models.size(); ++i)
+    {
+        if (m_models[i].directory == directory)
+            return m_models.getHandle(i);
+    }
+    return ModelHandle();
+}
+
+ObjectHandle Scene::addObject(const Object& object, ObjectHandle parent)
+{
+    const Model* model = getModel(object.getModel());
+    Object* parentObject = getObject(parent);
+
+    ObjectHandle handle = m_objects.add(object);
+    Object& added = m_objects[m_objects.size() - 1];
+    added._parent = parentObject ? parent : ObjectHandle();
+
+    // Transform store is kept in the same order as objects pool
+    m_transforms.add(added.getPosition(), added.getRotation(), added.getScale(), model ? model->getBounds() : AABB());
+
+    SceneGraph::NodeId parentNode = parentObject ? parentObject->_node : SceneGraph::INVALID_NODE;
+    if (model)
+        added._node = m_sceneGraph.instantiateModel(*model, object.getModel(), parentNode, glm::mat4(1.0f));
+    else
+        added._node = m_sceneGraph.addNode(parentNode, glm::mat4(1.0f));
+
+    m_instancesDirty = true;
+    return handle;
+}
+
+void Scene::removeObject(ObjectHandle handle)
+{
+    Object* object = getObject(handle);
+    if (!object)
+        return;
+
+    for (std::size_t i = 0; i < m_objects.size(); ++i)
+    {
+        if (m_objects[i]._parent == handle)
+            setParent(m_objects.getHandle(i), object->_parent);
+    }
+
+    m_sceneGraph.removeNode(object->_node);
+    // Both pool and transform store move their last element into freed slot
+    m_transforms.remove(static_cast<TransformStore::Index>(m_objects.indexOf(handle)));
+    m_objects.remove(handle);
+    m_instancesDirty = true;
+}
+
+void Scene::setParent(ObjectHandle handle, ObjectHandle parent)
+{
+    Object* object = getObject(handle);
+    Object* parentObject = getObject(parent);
+    if (!object)
+        return;
+
+    object->_parent = parentObject ? parent : ObjectHandle();
+    m_sceneGraph.setParent(object->_node, parentObject ? parentObject->_node : SceneGraph::INVALID_NODE);
+    // Subtree moved inside graph arrays, so instance order no longer follows nodes
+    m_instancesDirty = true;
+}
+
+void Scene::setPosition(ObjectHandle handle, glm::vec3 position)
+{
+    if (Object* object = getObject(handle))
+    {
+        object->setPosition(position);
+        m_transforms.setPosition(static_cast<TransformStore::Index>(m_objects.indexOf(handle)), position);
+    }
+}
+
+void Scene::setRotation(ObjectHandle handle, glm::vec3 rotation)
+{
+    if (Object* object = getObject(handle))
+    {
+        object->setRotation(rotation);
+        m_transforms.setRotation(static_cast<TransformStore::Index>(m_objects.indexOf(handle)), rotation);
+    }
+}
+
+void Scene::setScale(ObjectHandle handle, glm::vec3 scale)
+{
+    if (Object* object = getObject(handle))
+    {
+        object->setScale(scale);
+        m_transforms.setScale(static_cast<TransformStore::Index>(m_objects.indexOf(handle)), scale);
+    }
+}
+
+void Scene::update(JobSystem* jobs)
+{
+    if (m_transforms.isDirty())
+    {
+        m_transforms.update(jobs);
+        // Only moved objects are passed on, so graph recomputes just their subtrees
+        for (TransformStore::Index i : m_transforms.getChanged())
+            m_sceneGraph.setLocalTransform(m_objects[i]._node, m_transforms.getWorldMatrix(i));
+        m_transforms.clearChanged();
+    }
+    m_sceneGraph.update();
+
+    if (m_instancesDirty)
+    {
+        rebuildMeshInstances();
+        m_bvh.build(m_instanceBounds);
+    }
+    else
+    {
+        bool moved = false;
+        for (const auto& range : m_sceneGraph.getUpdatedRanges())
+        {
+            std::size_t first = m_nodeInstances[range.first];
+            std::size_t end = m_nodeInstances[range.second];
+            if (first == end)
+                continue;
+            updateInstanceBounds(first, end, jobs);
+            moved = true;
+        }
+        if (moved)
+            m_bvh.update(m_instanceBounds);
+    }
+    m_instancesDirty = false;
+}
+
+void Scene::queryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& result) const
+{
+    m_bvh.queryFrustum(frustum, [&result](std::uint32_t instance) { result.push_back(instance); });
+}
+
+void Scene::querySphere(glm::vec3 center, float radius, std::vector<std::uint32_t>& result) const
+{
+    m_bvh.querySphere(center, radius, [&result](std::uint32_t instance) { result.push_back(instance); });
+}
+
+int Scene::raycast(glm::vec3 origin, glm::vec3 direction, float& distance) const
+{
+    return m_bvh.raycast(origin, direction, distance, [this, origin, direction](std::uint32_t index, float maxDistance)
+    {
+        const MeshInstance& instance = m_meshInstances[index];
+        const Mesh& mesh = m_models.get(instance.model)->meshes[instance.mesh];
+
+        // Ray is moved to model space without normalizing direction, so hit distance stays the same
+        glm::mat4 toModel = glm::inverse(m_sceneGraph.getWorldMatrix(instance.node));
+        glm::vec3 localOrigin = glm::vec3(toModel * glm::vec4(origin, 1.0f));
+        glm::vec3 localDirection = glm::vec3(toModel * glm::vec4(direction, 0.0f));
+        return mesh.raycast(localOrigin, localDirection, maxDistance);
+    });
+}
+
+void Scene::rebuildMeshInstances()
+{
+    m_meshInstances.clear();
+    m_nodeInstances.resize(m_sceneGraph.size() + 1);
+    for (std::size_t i = 0; i < m_sceneGraph.size(); ++i)
+    {
+        m_nodeInstances[i] = m_meshInstances.size();
+        const Model* model = getModel(m_sceneGraph.getModelAt(i));
+        int modelNode = m_sceneGraph.getModelNodeAt(i);
+        if (!model || modelNode < 0)
+            continue;
+
+        for (unsigned int mesh : model->nodes[modelNode].meshes)
+        {
+            MeshInstance instance;
+            instance.node = m_sceneGraph.getIdAt(i);
+            instance.model = m_sceneGraph.getModelAt(i);
+            instance.mesh = mesh;
+            instance.localBounds = model->meshes[mesh].getBounds();
+            m_meshInstances.push_back(instance);
+        }
+    }
+    m_nodeInstances.back() = m_meshInstances.size();
+
+    m_instanceBounds.resize(m_meshInstances.size());
+    updateInstanceBounds(0, m_meshInstances.size());
+}
+
+void Scene::updateInstanceBounds(std::size_t first, std::size_t end, JobSystem* jobs)
+{
+    auto updateRange = [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            MeshInstance& instance = m_meshInstances[i];
+            instance.worldBounds = instance.localBounds.transformed(m_sceneGraph.getWorldMatrix(instance.node));
+            m_instanceBounds[i] = instance.worldBounds;
+        }
+    };
+
+    if (jobs)
+        jobs->parallelFor(first, end, INSTANCE_BOUNDS_PER_JOB, updateRange);
+    else
+        updateRange(first, end);
+}
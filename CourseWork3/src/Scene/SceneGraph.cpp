@@ -0,0 +1,193 @@
+#include <Scene/SceneGraph.h>
+
+#include <algorithm>
+#include <limits>
+
+const SceneGraph::NodeId SceneGraph::INVALID_NODE = std::numeric_limits<SceneGraph::NodeId>::max();
+
+SceneGraph::NodeId SceneGraph::addNode(NodeId parent, const glm::mat4& localTransform)
+{
+    int parentIndex = parent == INVALID_NODE ? -1 : static_cast<int>(m_idToIndex[parent]);
+    std::size_t index = insertNode(parentIndex, localTransform, ModelHandle(), -1);
+    return m_indexToId[index];
+}
+
+SceneGraph::NodeId SceneGraph::instantiateModel(const Model& model, ModelHandle handle, NodeId parent, const glm::mat4& localTransform)
+{
+    NodeId root = addNode(parent, localTransform);
+    m_model[m_idToIndex[root]] = handle;
+
+    // Model nodes are in depth-first order too, so they are appended to the end of instance subtree one by one
+    std::vector<NodeId> instanceNodes(model.nodes.size());
+    for (std::size_t i = 0; i < model.nodes.size(); ++i)
+    {
+        const ModelNode& modelNode = model.nodes[i];
+        NodeId nodeParent = modelNode.parent < 0 ? root : instanceNodes[modelNode.parent];
+        std::size_t index = insertNode(static_cast<int>(m_idToIndex[nodeParent]), modelNode.transform, handle, static_cast<int>(i));
+        instanceNodes[i] = m_indexToId[index];
+    }
+    return root;
+}
+
+void SceneGraph::removeNode(NodeId node)
+{
+    std::size_t index = m_idToIndex[node];
+    std::size_t count = m_subtreeSize[index];
+    for (std::size_t i = index; i < index + count; ++i)
+    {
+        m_idToIndex[m_indexToId[i]] = std::numeric_limits<std::uint32_t>::max();
+        m_freeIds.push_back(m_indexToId[i]);
+    }
+    eraseRange(index, count);
+}
+
+void SceneGraph::setParent(NodeId node, NodeId parent)
+{
+    std::size_t first = m_idToIndex[node];
+    std::size_t count = m_subtreeSize[first];
+    if (parent != INVALID_NODE)
+    {
+        std::size_t parentIndex = m_idToIndex[parent];
+        if (parentIndex >= first && parentIndex < first + count)
+            return; // can't attach node to its own descendant
+    }
+
+    // Copy subtree out, remove it and insert node by node under new parent, keeping relative order
+    std::vector<glm::mat4> local(m_local.begin() + first, m_local.begin() + first + count);
+    std::vector<int> parents(m_parent.begin() + first, m_parent.begin() + first + count);
+    std::vector<ModelHandle> models(m_model.begin() + first, m_model.begin() + first + count);
+    std::vector<int> modelNodes(m_modelNode.begin() + first, m_modelNode.begin() + first + count);
+    std::vector<NodeId> ids(m_indexToId.begin() + first, m_indexToId.begin() + first + count);
+
+    eraseRange(first, count);
+
+    std::vector<std::size_t> newIndices(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int parentIndex;
+        if (i == 0)
+            parentIndex = parent == INVALID_NODE ? -1 : static_cast<int>(m_idToIndex[parent]);
+        else
+            parentIndex = static_cast<int>(newIndices[parents[i] - static_cast<int>(first)]);
+
+        // Reuse node id, so references to moved nodes stay valid
+        m_freeIds.push_back(ids[i]);
+        newIndices[i] = insertNode(parentIndex, local[i], models[i], modelNodes[i]);
+    }
+}
+
+SceneGraph::NodeId SceneGraph::getParent(NodeId node) const
+{
+    int parentIndex = m_parent[m_idToIndex[node]];
+    return parentIndex < 0 ? INVALID_NODE : m_indexToId[parentIndex];
+}
+
+void SceneGraph::setLocalTransform(NodeId node, const glm::mat4& localTransform)
+{
+    std::size_t index = m_idToIndex[node];
+    m_local[index] = localTransform;
+    m_dirty[index] = true;
+    m_hasDirtyNodes = true;
+}
+
+void SceneGraph::update()
+{
+    m_updatedRanges.clear();
+    if (!m_hasDirtyNodes)
+        return;
+
+    std::size_t index = 0;
+    while (index < m_local.size())
+    {
+        if (!m_dirty[index])
+        {
+            ++index;
+            continue;
+        }
+
+        // Whole subtree is contiguous and parents precede children, so one pass is enough
+        std::size_t end = index + m_subtreeSize[index];
+        for (std::size_t i = index; i < end; ++i)
+        {
+            int parent = m_parent[i];
+            m_world[i] = parent < 0 ? m_local[i] : m_world[parent] * m_local[i];
+            // Fixes normals in case of non-uniform scaling
+            m_normal[i] = glm::transpose(glm::inverse(glm::mat3(m_world[i])));
+            m_dirty[i] = false;
+        }
+        m_updatedRanges.emplace_back(index, end);
+        index = end;
+    }
+
+    m_hasDirtyNodes = false;
+}
+
+std::size_t SceneGraph::insertNode(int parentIndex, const glm::mat4& localTransform, ModelHandle model, int modelNode)
+{
+    std::size_t index = parentIndex < 0 ? m_local.size() : parentIndex + m_subtreeSize[parentIndex];
+
+    // Shift parent indices of nodes which are moved by insertion
+    for (std::size_t i = index; i < m_parent.size(); ++i)
+    {
+        if (m_parent[i] >= static_cast<int>(index))
+            ++m_parent[i];
+    }
+    for (int ancestor = parentIndex; ancestor >= 0; ancestor = m_parent[ancestor])
+        ++m_subtreeSize[ancestor];
+
+    m_local.insert(m_local.begin() + index, localTransform);
+    m_world.insert(m_world.begin() + index, localTransform);
+    m_normal.insert(m_normal.begin() + index, glm::mat3(1.0f));
+    m_parent.insert(m_parent.begin() + index, parentIndex);
+    m_subtreeSize.insert(m_subtreeSize.begin() + index, 1);
+    m_dirty.insert(m_dirty.begin() + index, true);
+    m_model.insert(m_model.begin() + index, model);
+    m_modelNode.insert(m_modelNode.begin() + index, modelNode);
+    m_indexToId.insert(m_indexToId.begin() + index, allocateId());
+    m_hasDirtyNodes = true;
+
+    updateIdsFrom(index);
+    return index;
+}
+
+void SceneGraph::eraseRange(std::size_t first, std::size_t count)
+{
+    for (int ancestor = m_parent[first]; ancestor >= 0; ancestor = m_parent[ancestor])
+        m_subtreeSize[ancestor] -= static_cast<std::uint32_t>(count);
+
+    m_local.erase(m_local.begin() + first, m_local.begin() + first + count);
+    m_world.erase(m_world.begin() + first, m_world.begin() + first + count);
+    m_normal.erase(m_normal.begin() + first, m_normal.begin() + first + count);
+    m_parent.erase(m_parent.begin() + first, m_parent.begin() + first + count);
+    m_subtreeSize.erase(m_subtreeSize.begin() + first, m_subtreeSize.begin() + first + count);
+    m_dirty.erase(m_dirty.begin() + first, m_dirty.begin() + first + count);
+    m_model.erase(m_model.begin() + first, m_model.begin() + first + count);
+    m_modelNode.erase(m_modelNode.begin() + first, m_modelNode.begin() + first + count);
+    m_indexToId.erase(m_indexToId.begin() + first, m_indexToId.begin() + first + count);
+
+    for (std::size_t i = first; i < m_parent.size(); ++i)
+    {
+        if (m_parent[i] >= static_cast<int>(first + count))
+            m_parent[i] -= static_cast<int>(count);
+    }
+
+    updateIdsFrom(first);
+}
+
+void SceneGraph::updateIdsFrom(std::size_t first)
+{
+    for (std::size_t i = first; i < m_indexToId.size(); ++i)
+        m_idToIndex[m_indexToId[i]] = static_cast<std::uint32_t>(i);
+}
+
+SceneGraph::NodeId SceneGraph::allocateId()
+{
+    if (!m_freeIds.empty())
+    {
+        NodeId id = m_freeIds.back();
+        m_freeIds.pop_back();
+        return id;
+    }
+    m_idToIndex.push_back(0);
+    return static_cast<NodeId>(m_idToIndex.size() - 1);
+}
@@ -0,0 +1,174 @@
+#include <Scene/StaticBatcher.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const std::uint32_t UNUSED_VERTEX = std::numeric_limits<std::uint32_t>::max();
+}
+
+void StaticBatcher::add(const Model& model, const glm::mat4& transform)
+{
+    for (const ModelNode& node : model.nodes)
+    {
+        if (node.meshes.empty())
+            continue;
+
+        glm::mat4 world = transform * node.globalTransform;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+        for (unsigned int meshIndex : node.meshes)
+        {
+            const Mesh& mesh = model.meshes[meshIndex];
+            auto inserted = m_materials.emplace(mesh.getMaterialId(), MaterialGroup());
+            MaterialGroup& group = inserted.first->second;
+            if (inserted.second)
+            {
+                group.textures = mesh.getTextures();
+                group.opacityRatio = mesh.getOpacityRatio();
+                group.refractionRatio = mesh.getRefractionRatio();
+            }
+
+            std::uint32_t baseVertex = static_cast<std::uint32_t>(group.vertices.size());
+            for (const Vertex& vertex : mesh.getVertices())
+            {
+                Vertex transformed;
+                transformed.Position = glm::vec3(world * glm::vec4(vertex.Position, 1.0f));
+                // Missing normals are zero and stay zero
+                glm::vec3 normal = normalMatrix * vertex.Normal;
+                float length = glm::length(normal);
+                transformed.Normal = length > 0.0f ? normal / length : normal;
+                transformed.TexCoords = vertex.TexCoords;
+                group.vertices.push_back(transformed);
+                m_bounds.expand(transformed.Position);
+            }
+            for (unsigned int index : mesh.getIndices())
+                group.indices.push_back(baseVertex + index);
+            ++m_sourceMeshes;
+        }
+    }
+}
+
+Model StaticBatcher::build(const std::string& name, JobSystem* jobs)
+{
+    std::vector<Chunk> chunks;
+    glm::vec3 size = m_bounds.isEmpty() ? glm::vec3(0.0f) : m_bounds.max - m_bounds.min;
+    float maxExtent = std::max(std::max(size.x, size.y), size.z) * MAX_CHUNK_EXTENT;
+    for (const auto& material : m_materials)
+    {
+        const MaterialGroup& group = material.second;
+        std::vector<std::uint32_t> triangles(group.indices.size() / 3);
+        for (std::size_t i = 0; i < triangles.size(); ++i)
+            triangles[i] = static_cast<std::uint32_t>(i);
+        std::vector<std::uint32_t> remap(group.vertices.size(), UNUSED_VERTEX);
+        buildChunks(group, triangles, 0, triangles.size(), maxExtent, remap, chunks);
+    }
+
+    // Splitting shares remap tables and is cheap, optimization and processing of chunks are not
+    auto process = [&chunks](std::size_t first, std::size_t last)
+    {
+        for (std::size_t i = first; i < last; ++i)
+        {
+            ProcessedMeshData& data = chunks[i].data;
+            // Median splits leave triangles in arbitrary order
+            if (Model::optimizeMeshes)
+                Mesh::optimizeGeometry(data.vertices, data.indices);
+            data = Mesh::processGeometry(std::move(data.vertices), std::move(data.indices));
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(0, chunks.size(), 1, process);
+    else
+        process(0, chunks.size());
+
+    // Meshes are uploaded, so they are created on calling (GL) thread
+    std::vector<Mesh> meshes;
+    meshes.reserve(chunks.size());
+    for (const Chunk& chunk : chunks)
+    {
+        Mesh mesh(chunk.data.view(), chunk.group->textures);
+        mesh.setOpacityRatio(chunk.group->opacityRatio);
+        mesh.setRefractionRatio(chunk.group->refractionRatio);
+        meshes.push_back(std::move(mesh));
+    }
+    chunks.clear();
+    clear();
+
+    return Model(name, std::move(meshes));
+}
+
+void StaticBatcher::clear()
+{
+    m_materials.clear();
+    m_bounds = AABB();
+    m_sourceMeshes = 0;
+}
+
+void StaticBatcher::buildChunks(const MaterialGroup& group, std::vector<std::uint32_t>& triangles,
+    std::size_t begin, std::size_t end, float maxExtent, std::vector<std::uint32_t>& remap, std::vector<Chunk>& chunks) const
+{
+    std::size_t count = end - begin;
+    if (count == 0)
+        return;
+
+    AABB centroidBounds;
+    for (std::size_t i = begin; i < end; ++i)
+        centroidBounds.expand(getCentroid(group, triangles[i]));
+    glm::vec3 size = centroidBounds.max - centroidBounds.min;
+    int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+
+    bool tooMany = count > MAX_CHUNK_TRIANGLES;
+    bool tooLong = count > MIN_CHUNK_TRIANGLES && size[axis] > maxExtent;
+    if ((!tooMany && !tooLong) || size[axis] <= 0.0f)
+    {
+        addChunk(group, triangles.data() + begin, count, remap, chunks);
+        return;
+    }
+
+    // Median split keeps chunks balanced even when triangles are spread unevenly
+    std::size_t middle = begin + count / 2;
+    std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+        [this, &group, axis](std::uint32_t a, std::uint32_t b)
+        {
+            return getCentroid(group, a)[axis] < getCentroid(group, b)[axis];
+        });
+    buildChunks(group, triangles, begin, middle, maxExtent, remap, chunks);
+    buildChunks(group, triangles, middle, end, maxExtent, remap, chunks);
+}
+
+void StaticBatcher::addChunk(const MaterialGroup& group, const std::uint32_t* triangles, std::size_t count,
+    std::vector<std::uint32_t>& remap, std::vector<Chunk>& chunks) const
+{
+    chunks.push_back(Chunk{ &group, ProcessedMeshData() });
+    // Vertices used by chunk triangles are copied once, in order of first use
+    std::vector<Vertex>& vertices = chunks.back().data.vertices;
+    std::vector<unsigned int>& indices = chunks.back().data.indices;
+    indices.reserve(count * 3);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            std::uint32_t vertex = group.indices[3 * triangles[i] + corner];
+            if (remap[vertex] == UNUSED_VERTEX)
+            {
+                remap[vertex] = static_cast<std::uint32_t>(vertices.size());
+                vertices.push_back(group.vertices[vertex]);
+            }
+            indices.push_back(remap[vertex]);
+        }
+    }
+
+    // Remap table is shared by all chunks of group, only entries of this chunk are reset
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+            remap[group.indices[3 * triangles[i] + corner]] = UNUSED_VERTEX;
+    }
+}
+
+glm::vec3 StaticBatcher::getCentroid(const MaterialGroup& group, std::uint32_t triangle) const
+{
+    return (group.vertices[group.indices[3 * triangle + 0]].Position
+          + group.vertices[group.indices[3 * triangle + 1]].Position
+          + group.vertices[group.indices[3 * triangle + 2]].Position) / 3.0f;
+}
@@ -0,0 +1,295 @@
+#include <Scene/TransformStore.h>
+#include <Core/Simd.h>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+
+using simd::FloatN;
+
+namespace
+{
+    // Number of SIMD batches composed by one job
+    const std::size_t UPDATE_BATCHES_PER_JOB = 128;
+}
+
+TransformStore::Index TransformStore::add(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, const AABB& localBounds)
+{
+    reserve(m_count + 1);
+    Index index = static_cast<Index>(m_count++);
+
+    setPosition(index, position);
+    setRotation(index, rotation);
+    setScale(index, scale);
+    setLocalBounds(index, localBounds);
+
+    return index;
+}
+
+void TransformStore::remove(Index index)
+{
+    std::size_t last = m_count - 1;
+    if (m_changedFlags[last])
+    {
+        m_changed.erase(std::find(m_changed.begin(), m_changed.end(), static_cast<Index>(last)));
+        m_changedFlags[last] = 0;
+    }
+    if (index != last)
+    {
+        moveSlot(last, index);
+        markChanged(index);
+    }
+
+    resetSlot(last);
+    --m_count;
+    m_dirty = true;
+}
+
+void TransformStore::clear()
+{
+    for (std::size_t i = 0; i < m_count; ++i)
+        resetSlot(i);
+    m_count = 0;
+    m_dirty = false;
+    clearChanged();
+}
+
+void TransformStore::clearChanged()
+{
+    for (Index index : m_changed)
+        m_changedFlags[index] = 0;
+    m_changed.clear();
+}
+
+void TransformStore::markChanged(Index index)
+{
+    m_dirty = true;
+    if (!m_changedFlags[index])
+    {
+        m_changedFlags[index] = 1;
+        m_changed.push_back(index);
+    }
+}
+
+void TransformStore::setPosition(Index index, glm::vec3 position)
+{
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_positionZ[index] = position.z;
+    markChanged(index);
+}
+
+void TransformStore::setRotation(Index index, glm::vec3 rotation)
+{
+    // Same conversion as in Object::getModelMatrix, done once here instead of every frame
+    glm::quat quaternion(glm::vec3(glm::radians(rotation.x), glm::radians(rotation.y), glm::radians(rotation.z)));
+    m_rotationX[index] = quaternion.x;
+    m_rotationY[index] = quaternion.y;
+    m_rotationZ[index] = quaternion.z;
+    m_rotationW[index] = quaternion.w;
+    markChanged(index);
+}
+
+void TransformStore::setScale(Index index, glm::vec3 scale)
+{
+    m_scaleX[index] = scale.x;
+    m_scaleY[index] = scale.y;
+    m_scaleZ[index] = scale.z;
+    markChanged(index);
+}
+
+void TransformStore::setLocalBounds(Index index, const AABB& bounds)
+{
+    glm::vec3 center = bounds.isEmpty() ? glm::vec3(0.0f) : bounds.getCenter();
+    glm::vec3 extents = bounds.isEmpty() ? glm::vec3(0.0f) : bounds.getExtents();
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_extentX[index] = extents.x;
+    m_extentY[index] = extents.y;
+    m_extentZ[index] = extents.z;
+    markChanged(index);
+}
+
+AABB TransformStore::getWorldBounds(Index index) const
+{
+    return AABB(
+        glm::vec3(m_worldMinX[index], m_worldMinY[index], m_worldMinZ[index]),
+        glm::vec3(m_worldMaxX[index], m_worldMaxY[index], m_worldMaxZ[index])
+    );
+}
+
+void TransformStore::update(JobSystem* jobs)
+{
+    if (!m_dirty)
+        return;
+
+    std::size_t batches = (m_count + FloatN::width - 1) / FloatN::width;
+    auto updateBatches = [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t batch = begin; batch < end; ++batch)
+            updateBatch(batch * FloatN::width);
+    };
+
+    if (jobs)
+        jobs->parallelFor(0, batches, UPDATE_BATCHES_PER_JOB, updateBatches);
+    else
+        updateBatches(0, batches);
+
+    m_dirty = false;
+}
+
+void TransformStore::updateBatch(std::size_t first)
+{
+    const FloatN one(1.0f);
+    const FloatN two(2.0f);
+
+    FloatN px = FloatN::load(&m_positionX[first]);
+    FloatN py = FloatN::load(&m_positionY[first]);
+    FloatN pz = FloatN::load(&m_positionZ[first]);
+
+    FloatN qx = FloatN::load(&m_rotationX[first]);
+    FloatN qy = FloatN::load(&m_rotationY[first]);
+    FloatN qz = FloatN::load(&m_rotationZ[first]);
+    FloatN qw = FloatN::load(&m_rotationW[first]);
+
+    FloatN sx = FloatN::load(&m_scaleX[first]);
+    FloatN sy = FloatN::load(&m_scaleY[first]);
+    FloatN sz = FloatN::load(&m_scaleZ[first]);
+
+    // Rotation matrix from quaternion, r<column><row> (same layout as glm::toMat3)
+    FloatN xx = qx * qx, yy = qy * qy, zz = qz * qz;
+    FloatN xy = qx * qy, xz = qx * qz, yz = qy * qz;
+    FloatN wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+    FloatN r00 = one - two * (yy + zz);
+    FloatN r01 = two * (xy + wz);
+    FloatN r02 = two * (xz - wy);
+
+    FloatN r10 = two * (xy - wz);
+    FloatN r11 = one - two * (xx + zz);
+    FloatN r12 = two * (yz + wx);
+
+    FloatN r20 = two * (xz + wy);
+    FloatN r21 = two * (yz - wx);
+    FloatN r22 = one - two * (xx + yy);
+
+    // World matrix: translate * rotate * scale, so each rotation column is multiplied by scale
+    FloatN m00 = r00 * sx, m01 = r01 * sx, m02 = r02 * sx;
+    FloatN m10 = r10 * sy, m11 = r11 * sy, m12 = r12 * sy;
+    FloatN m20 = r20 * sz, m21 = r21 * sz, m22 = r22 * sz;
+
+    // Normal matrix: inverse transpose of (R * S) is R * S^-1
+    FloatN isx = one / sx, isy = one / sy, isz = one / sz;
+    FloatN n00 = r00 * isx, n01 = r01 * isx, n02 = r02 * isx;
+    FloatN n10 = r10 * isy, n11 = r11 * isy, n12 = r12 * isy;
+    FloatN n20 = r20 * isz, n21 = r21 * isz, n22 = r22 * isz;
+
+    // World bounds: transform center, extents are projected with absolute matrix values
+    FloatN cx = FloatN::load(&m_centerX[first]);
+    FloatN cy = FloatN::load(&m_centerY[first]);
+    FloatN cz = FloatN::load(&m_centerZ[first]);
+    FloatN ex = FloatN::load(&m_extentX[first]);
+    FloatN ey = FloatN::load(&m_extentY[first]);
+    FloatN ez = FloatN::load(&m_extentZ[first]);
+
+    FloatN wcx = m00 * cx + m10 * cy + m20 * cz + px;
+    FloatN wcy = m01 * cx + m11 * cy + m21 * cz + py;
+    FloatN wcz = m02 * cx + m12 * cy + m22 * cz + pz;
+
+    FloatN wex = simd::abs(m00) * ex + simd::abs(m10) * ey + simd::abs(m20) * ez;
+    FloatN wey = simd::abs(m01) * ex + simd::abs(m11) * ey + simd::abs(m21) * ez;
+    FloatN wez = simd::abs(m02) * ex + simd::abs(m12) * ey + simd::abs(m22) * ez;
+
+    (wcx - wex).store(&m_worldMinX[first]);
+    (wcy - wey).store(&m_worldMinY[first]);
+    (wcz - wez).store(&m_worldMinZ[first]);
+    (wcx + wex).store(&m_worldMaxX[first]);
+    (wcy + wey).store(&m_worldMaxY[first]);
+    (wcz + wez).store(&m_worldMaxZ[first]);
+
+    // Matrices are consumed per object by OpenGL, so transpose lanes back to array-of-structs
+    alignas(32) float world[12][FloatN::width];
+    alignas(32) float normal[9][FloatN::width];
+
+    m00.store(world[0]); m01.store(world[1]);  m02.store(world[2]);
+    m10.store(world[3]); m11.store(world[4]);  m12.store(world[5]);
+    m20.store(world[6]); m21.store(world[7]);  m22.store(world[8]);
+    px.store(world[9]);  py.store(world[10]);  pz.store(world[11]);
+
+    n00.store(normal[0]); n01.store(normal[1]); n02.store(normal[2]);
+    n10.store(normal[3]); n11.store(normal[4]); n12.store(normal[5]);
+    n20.store(normal[6]); n21.store(normal[7]); n22.store(normal[8]);
+
+    for (int lane = 0; lane < FloatN::width; ++lane)
+    {
+        glm::mat4& m = m_worldMatrices[first + lane];
+        m[0] = glm::vec4(world[0][lane], world[1][lane],  world[2][lane],  0.0f);
+        m[1] = glm::vec4(world[3][lane], world[4][lane],  world[5][lane],  0.0f);
+        m[2] = glm::vec4(world[6][lane], world[7][lane],  world[8][lane],  0.0f);
+        m[3] = glm::vec4(world[9][lane], world[10][lane], world[11][lane], 1.0f);
+
+        glm::mat3& n = m_normalMatrices[first + lane];
+        n[0] = glm::vec3(normal[0][lane], normal[1][lane], normal[2][lane]);
+        n[1] = glm::vec3(normal[3][lane], normal[4][lane], normal[5][lane]);
+        n[2] = glm::vec3(normal[6][lane], normal[7][lane], normal[8][lane]);
+    }
+}
+
+void TransformStore::reserve(std::size_t count)
+{
+    if (count <= m_capacity)
+        return;
+
+    std::size_t capacity = simd::paddedSize(std::max(count, m_capacity * 2));
+
+    for (AlignedVector<float>* array : {
+        &m_positionX, &m_positionY, &m_positionZ,
+        &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW,
+        &m_scaleX, &m_scaleY, &m_scaleZ,
+        &m_centerX, &m_centerY, &m_centerZ,
+        &m_extentX, &m_extentY, &m_extentZ,
+        &m_worldMinX, &m_worldMinY, &m_worldMinZ,
+        &m_worldMaxX, &m_worldMaxY, &m_worldMaxZ })
+    {
+        array->resize(capacity, 0.0f);
+    }
+    m_worldMatrices.resize(capacity, glm::mat4(1.0f));
+    m_normalMatrices.resize(capacity, glm::mat3(1.0f));
+    m_changedFlags.resize(capacity, 0);
+
+    for (std::size_t i = m_capacity; i < capacity; ++i)
+        resetSlot(i);
+
+    m_capacity = capacity;
+}
+
+void TransformStore::resetSlot(std::size_t index)
+{
+    m_positionX[index] = m_positionY[index] = m_positionZ[index] = 0.0f;
+    m_rotationX[index] = m_rotationY[index] = m_rotationZ[index] = 0.0f;
+    m_rotationW[index] = 1.0f;
+    m_scaleX[index] = m_scaleY[index] = m_scaleZ[index] = 1.0f;
+    m_centerX[index] = m_centerY[index] = m_centerZ[index] = 0.0f;
+    m_extentX[index] = m_extentY[index] = m_extentZ[index] = 0.0f;
+}
+
+void TransformStore::moveSlot(std::size_t from, std::size_t to)
+{
+    m_positionX[to] = m_positionX[from];
+    m_positionY[to] = m_positionY[from];
+    m_positionZ[to] = m_positionZ[from];
+    m_rotationX[to] = m_rotationX[from];
+    m_rotationY[to] = m_rotationY[from];
+    m_rotationZ[to] = m_rotationZ[from];
+    m_rotationW[to] = m_rotationW[from];
+    m_scaleX[to] = m_scaleX[from];
+    m_scaleY[to] = m_scaleY[from];
+    m_scaleZ[to] = m_scaleZ[from];
+    m_centerX[to] = m_centerX[from];
+    m_centerY[to] = m_centerY[from];
+    m_centerZ[to] = m_centerZ[from];
+    m_extentX[to] = m_extentX[from];
+    m_extentY[to] = m_extentY[from];
+    m_extentZ[to] = m_extentZ[from];
+}
@@ -9,10 +9,10 @@ const glm::vec3::value_type  SceneLoader::MIN_ALLOWED_COLOR          =     0;
 const glm::vec3::value_type  SceneLoader::MAX_ALLOWED_COLOR          =  1000;
 const float                  SceneLoader::MIN_ALLOWED_DEGREES_ANGLE  =     0;
 const float                  SceneLoader::MAX_ALLOWED_DEGREES_ANGLE  =    90;
+const string                 SceneLoader::STATIC_FLAG                = " static";
+const string                 SceneLoader::STATIC_BATCH_NAME          = "static_batch";
 
-void SceneLoader::loadScene(string lightsDataPath, string objectsDataPath,
-    DirectionalLights& dirLights, PointLights& pointLights, SpotLights& spotLights, 
-    Models& models, Objects& objects)
+void SceneLoader::loadScene(string lightsDataPath, string objectsDataPath, Scene& scene, JobSystem* jobs)
 {    
     ifstream file;    
     // Read point lights info
@@ -29,11 +29,11 @@ void SceneLoader::loadScene(string lightsDataPath, string objectsDataPath,
         while (getline(lightData, type))
         {           
             if (type == "point")            
-                pointLights.push_back(loadPointLight(lightData, good));                                
+                scene.addPointLight(loadPointLight(lightData, good));
             else if (type == "spot")
-                spotLights.push_back(loadSpotLight(lightData, good));            
+                scene.addSpotLight(loadSpotLight(lightData, good));
             else if (type == "directional")
-                dirLights.push_back(loadDirectionalLight(lightData, good));
+                scene.addDirectionalLight(loadDirectionalLight(lightData, good));
             else
             {
                 cout << "ERROR::SCENE_LOADER::UNKNOWN_TYPE type: " << type << endl;
@@ -59,7 +59,8 @@ void SceneLoader::loadScene(string lightsDataPath, string objectsDataPath,
     vector<glm::vec3> rotations;
     vector<glm::vec3> scales;
     vector<string> paths;
-    vector<int> modelIndexes;
+    vector<ModelHandle> modelHandles;
+    vector<bool> statics;
 
     try
     {
@@ -81,24 +82,94 @@ void SceneLoader::loadScene(string lightsDataPath, string objectsDataPath,
 
             string path;                     
             getline(objectsData, path);
+            // objects which never move are marked by flag after the model path
+            bool isStatic = path.size() > STATIC_FLAG.size() &&
+                path.compare(path.size() - STATIC_FLAG.size(), STATIC_FLAG.size(), STATIC_FLAG) == 0;
+            if (isStatic)
+                path.erase(path.size() - STATIC_FLAG.size());
             paths.push_back(path);
-            
-            int index = getModelIndex(path, models);
-            if (index < 0)
+            statics.push_back(isStatic);
+        }
+
+        // models are imported (parsed, processed, textures decoded) on jobs concurrently,
+        // each one is uploaded on this thread as soon as its import is done
+        vector<string> importPaths;
+        vector<int> importIndices;
+        for (const string& path : paths)
+        {
+            string directory = path.substr(0, path.find_last_of('/'));
+            int index = -1;
+            for (int i = 0; i < importPaths.size() && index < 0; ++i)
+            {
+                if (importPaths[i].substr(0, importPaths[i].find_last_of('/')) == directory)
+                    index = i;
+            }
+            if (index < 0 && scene.findModel(directory).isNull())
             {
-                Model model(path);
-                models.push_back(make_shared<Model>(model));
-                modelIndexes.push_back(models.size() - 1);
+                index = static_cast<int>(importPaths.size());
+                importPaths.push_back(path);
             }
-            else            
-                modelIndexes.push_back(index);
+            importIndices.push_back(index);
+        }
+
+        vector<ModelImport> imports(importPaths.size());
+        vector<unique_ptr<JobCounter>> importCounters;
+        for (int i = 0; jobs && i < importPaths.size(); ++i)
+        {
+            importCounters.push_back(make_unique<JobCounter>());
+            jobs->run([&imports, &importPaths, i, jobs]() { imports[i] = Model::import(importPaths[i], jobs); }, importCounters.back().get());
+        }
+
+        vector<ModelHandle> importHandles;
+        for (int i = 0; i < importPaths.size(); ++i)
+        {
+            if (jobs)
+                jobs->wait(*importCounters[i]);
+            else
+                imports[i] = Model::import(importPaths[i]);
+            importHandles.push_back(scene.addModel(Model(std::move(imports[i]))));
+            // CPU copies of geometry and cache mapping are released right after upload
+            imports[i] = ModelImport();
+        }
+
+        for (int i = 0; i < paths.size(); ++i)
+        {
+            int index = importIndices[i];
+            modelHandles.push_back(index >= 0 ? importHandles[index] : scene.findModel(paths[i].substr(0, paths[i].find_last_of('/'))));
         }
 
-        for (int i = 0; i < modelIndexes.size(); ++i)
+        // static objects are merged into one batch model, their source models are unloaded
+        // unless some movable object uses them
+        StaticBatcher batcher;
+        vector<ModelHandle> staticModels;
+        for (int i = 0; i < modelHandles.size(); ++i)
         {
-            Object obj(positions[i], rotations[i], scales[i], models[modelIndexes[i]]);
-            objects.push_back(obj);
+            Object obj(positions[i], rotations[i], scales[i], modelHandles[i]);
+            if (statics[i])
+            {
+                batcher.add(*scene.getModel(modelHandles[i]), obj.getModelMatrix());
+                staticModels.push_back(modelHandles[i]);
+            }
+            else
+                scene.addObject(obj);
         }        
+
+        if (!batcher.isEmpty())
+        {
+            size_t sourceMeshes = batcher.getSourceMeshCount();
+            ModelHandle batch = scene.addModel(batcher.build(STATIC_BATCH_NAME, jobs));
+            scene.addObject(Object(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f), batch));
+            cout << "SCENE_LOADER::STATIC_BATCH meshes: " << sourceMeshes << ", chunks: " << scene.getModel(batch)->meshes.size() << endl;
+
+            for (ModelHandle handle : staticModels)
+            {
+                bool used = false;
+                for (int i = 0; i < modelHandles.size(); ++i)
+                    used = used || (!statics[i] && modelHandles[i] == handle);
+                if (!used)
+                    scene.removeModel(handle);
+            }
+        }
     }
     catch (std::ifstream::failure e)
     {
@@ -173,21 +244,6 @@ SpotLight SceneLoader::loadSpotLight(std::stringstream & lightData, bool& good)
     return spotLight;
 }
 
-int SceneLoader::getModelIndex(string path, const Models& models)
-{
-    int i = 0;
-    bool modelExists = false;
-    while (!modelExists && i < models.size())
-    {
-        modelExists = (path.substr(0, path.find_last_of('/')) == models[i]->directory);
-        ++i;
-    }
-    if (modelExists)
-        return i - 1;
-    else
-        return -1;
-}
-
 glm::vec3 SceneLoader::getVec3(stringstream& data)
 {
     glm::vec3 vec3;
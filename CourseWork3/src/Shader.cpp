@@ -2,12 +2,14 @@
 
 using namespace std;
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const char* header,
+    const char* vertexInclude)
 {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
     std::string geometryCode;
+    std::string includeCode;
     std::ifstream vShaderFile;
     std::ifstream fShaderFile;
     std::ifstream gShaderFile;
@@ -37,11 +39,29 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
             gShaderFile.close();
             geometryCode = gShaderStream.str();
         }
+        if (vertexInclude != nullptr)
+        {
+            std::ifstream includeFile;
+            includeFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+            includeFile.open(vertexInclude);
+            std::stringstream includeStream;
+            includeStream << includeFile.rdbuf();
+            includeCode = includeStream.str();
+        }
     }
     catch (std::ifstream::failure e)
     {
         cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
     }
+    if (header != nullptr)
+    {
+        applyHeader(vertexCode, header);
+        applyHeader(fragmentCode, header);
+        if (geometryPath != nullptr)
+            applyHeader(geometryCode, header);
+    }
+    if (vertexInclude != nullptr)
+        applyInclude(vertexCode, includeCode);
     const char* vShaderCode = vertexCode.c_str();
     const char * fShaderCode = fragmentCode.c_str();
     // 2. compile shaders
@@ -87,6 +107,59 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
     }
 }
 
+Shader::Shader(const char* computePath)
+{
+    std::string computeCode;
+    std::ifstream cShaderFile;
+    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        cShaderFile.open(computePath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (std::ifstream::failure e)
+    {
+        cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
+    }
+    const char* cShaderCode = computeCode.c_str();
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    checkCompileErrors(compute, "COMPUTE");
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+    glDeleteShader(compute);
+}
+
+void Shader::applyHeader(std::string& code, const char* header)
+{
+    std::size_t lineEnd = code.find('\n');
+    if (code.compare(0, 1, "#") == 0 && code.find("version") < lineEnd)
+        code.replace(0, lineEnd == std::string::npos ? code.size() : lineEnd + 1, header);
+    else
+        code.insert(0, header);
+}
+
+void Shader::applyInclude(std::string& code, const std::string& include)
+{
+    std::size_t position = 0;
+    while (position < code.size() && code[position] == '#')
+    {
+        std::size_t lineEnd = code.find('\n', position);
+        position = lineEnd == std::string::npos ? code.size() : lineEnd + 1;
+    }
+    std::string text = include;
+    if (!text.empty() && text.back() != '\n')
+        text += '\n';
+    code.insert(position, text);
+}
+
 void Shader::checkCompileErrors(GLuint shader, std::string type)
 {
     GLint success;
@@ -17,14 +17,27 @@
 #include <LightManager.h>
 #include <Objects/Model.h>
 #include <Objects/Object.h>
+#include <Scene/Scene.h>
+#include <Render/DrawList.h>
+#include <Render/GLStateCache.h>
+#include <Render/GpuCulling.h>
+#include <Render/HiZPyramid.h>
+#include <Render/PassStatistics.h>
+#include <Render/RingBuffer.h>
+#include <Render/TextureRegistry.h>
+#include <Render/TextureStreamer.h>
+#include <Core/JobSystem.h>
 #include <Aliases.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -40,6 +53,8 @@ void renderSkybox(unsigned int cubemapTexture);
 void renderScene(const Shader& shader);
 unsigned int loadCubemap(std::vector<std::string> faces);
 unsigned int loadTexture(const char* path);
+void recordTextureUse(TextureStreamer& textureStreamer, const std::vector<std::uint32_t>& instances,
+    glm::vec3 viewPosition, float projectionScale);
 
 // Screen settings
 unsigned int screenWidth = 1200;
@@ -63,12 +78,11 @@ const unsigned int                  SKYBOX_TEXTURE_INDEX                = 15;
 const unsigned int                  SHADOW_DEPTH_MAP_INDEX              = 14;
 
 // Scene contents
-DirectionalLight sun(glm::vec3(0, -1, 0), glm::vec3(0.98, 0.831, 0.25));
-DirectionalLights dirLights;
-PointLights pointLights;
-SpotLights spotLights;
-Objects objects;
-Models models;
+Scene scene;
+DirectionalLight& sun = scene.getSun();
+DirectionalLights& dirLights = scene.getDirectionalLights();
+PointLights& pointLights = scene.getPointLights();
+SpotLights& spotLights = scene.getSpotLights();
 
 // Scene settings
 bool shadows = true;
@@ -81,6 +95,36 @@ bool showCombinedDepthMapKeyPressed = false;
 const unsigned int POINT_LIGHT_SHADOW_MAP_WIDTH  = 1024; 
 const unsigned int POINT_LIGHT_SHADOW_MAP_HEIGHT = 1024;
 
+// Shadow maps range, only objects within it are rendered to shadow maps
+const float POINT_LIGHT_FAR_PLANE = 20.0f;
+const float SPOT_LIGHT_FAR_PLANE  = 25.0f;
+
+// Largest projected error of mesh level of detail in pixels, shadow maps tolerate coarser geometry
+const float CAMERA_LOD_PIXEL_ERROR = 1.0f;
+const float SHADOW_LOD_PIXEL_ERROR = 4.0f;
+
+// Size of ring buffer region with per-draw constants of one frame
+const std::size_t DRAW_CONSTANTS_BUFFER_SIZE = 8 * 1024 * 1024;
+const std::size_t DRAW_COMMANDS_BUFFER_SIZE = 2 * 1024 * 1024;
+const std::size_t MAX_CULLED_BATCHES = 64 * 1024;
+
+// Render passes whose vertex shader invocations are counted
+enum RenderPass : unsigned int
+{
+    ALBEDO_PASS,
+    POINT_SHADOW_PASS,
+    POINT_LIGHT_PASS,
+    SPOT_SHADOW_PASS,
+    SPOT_LIGHT_PASS
+};
+
+// Shadow casters of one light and their draws
+struct ShadowCasterView
+{
+    std::vector<std::uint32_t> casters;
+    DrawList drawList;
+};
+
 vector<std::string> faces
 {
     "data/skybox/right.jpg",
@@ -91,19 +135,63 @@ vector<std::string> faces
     "data/skybox/back.jpg"
 }; 
 
-int main()
+int main(int argc, char** argv)
 {        
+    // --no-mesh-optimization loads meshes as they are stored, to compare vertex shader load with optimized ones.
+    // --float-vertices keeps full precision vertices in GPU buffers instead of quantized ones.
+    // --no-lods draws full meshes at any distance, --no-meshlets culls whole meshes only.
+    // --no-geometry-cache imports models from source files and doesn't write cooked ones.
+    // --assimp-obj imports .obj files with ASSIMP instead of own parser.
+    // --sync-textures loads all textures before first frame instead of streaming them,
+    // --no-mip-streaming streams them with all mip levels.
+    // --no-texture-cooking streams them uncompressed instead of block compressed and cached ones.
+    Mesh::setVertexLayout(VertexLayout::Quantized);
+    bool streamTextures = true;
+    bool streamMips = true;
+    bool cookTextures = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--no-mesh-optimization") == 0)
+            Model::optimizeMeshes = false;
+        else if (std::strcmp(argv[i], "--float-vertices") == 0)
+            Mesh::setVertexLayout(VertexLayout::Float);
+        else if (std::strcmp(argv[i], "--no-lods") == 0)
+            Mesh::generateLods = false;
+        else if (std::strcmp(argv[i], "--no-meshlets") == 0)
+            Mesh::generateMeshlets = false;
+        else if (std::strcmp(argv[i], "--no-geometry-cache") == 0)
+            Model::useGeometryCache = false;
+        else if (std::strcmp(argv[i], "--assimp-obj") == 0)
+            Model::useObjLoader = false;
+        else if (std::strcmp(argv[i], "--sync-textures") == 0)
+            streamTextures = false;
+        else if (std::strcmp(argv[i], "--no-mip-streaming") == 0)
+            streamMips = false;
+        else if (std::strcmp(argv[i], "--no-texture-cooking") == 0)
+            cookTextures = false;
+    }
+
     // set russian locale
     setlocale(LC_ALL, "Russian");
 
     // glfw: initialize and configure    
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // glfw window creation   
-    GLFWwindow* window = glfwCreateWindow(screenWidth, screenHeight, "Seminar10 - Lighting", NULL, NULL);
+    // Drivers may give only the context version asked for, so the newest one is tried first:
+    // persistent-mapped ring buffers need GL 4.4, multi-draw indirect and GPU culling 4.3,
+    // indirect draw count and pass statistics 4.6. Everything falls back down to 3.3.
+    const int contextVersions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 4 }, { 4, 3 }, { 3, 3 } };
+    GLFWwindow* window = NULL;
+    for (const auto& version : contextVersions)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        window = glfwCreateWindow(screenWidth, screenHeight, "Seminar10 - Lighting", NULL, NULL);
+        if (window != NULL)
+            break;
+    }
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -133,31 +221,90 @@ int main()
     // Shaders for shadows
     Shader pointShadowsShader("shaders/point_shadows.vert", "shaders/point_shadows.frag");
     Shader spotShadowsShader("shaders/spot_shadows.vert", "shaders/spot_shadows.frag");
+    // With GL 4.3 passes rendering draw lists submit them by multi-draw indirect
+    const bool multiDrawIndirect = GLAD_GL_VERSION_4_3;
+    const char* drawListShaderHeader = multiDrawIndirect ? "#version 430 core\n#define MULTI_DRAW_INDIRECT\n" : nullptr;
     Shader simpleDepthShader(
         "shaders/point_shadows_depth.vert",
         "shaders/point_shadows_depth.frag",
-        "shaders/point_shadows_depth.geom"
+        "shaders/point_shadows_depth.geom",
+        drawListShaderHeader,
+        "shaders/draw_constants.glsl"
     );
     Shader shadowAccumulatorShader("shaders/shadow_accumulator.vert", "shaders/shadow_accumulator.frag");
     Shader textureRenderingShader("shaders/textureRendering.vert", "shaders/textureRendering.frag");
 
     Shader albedoShader(
         "shaders/pbr_with_shadows/albedo.vert",
-        "shaders/pbr_with_shadows/albedo.frag"
+        "shaders/pbr_with_shadows/albedo.frag",
+        nullptr,
+        drawListShaderHeader,
+        "shaders/draw_constants.glsl"
     );
     // PBR shadows
     Shader pbrShadowsPointLightShader(
         "shaders/pbr_with_shadows/point_light.vert",
-        "shaders/pbr_with_shadows/point_light.frag"
+        "shaders/pbr_with_shadows/point_light.frag",
+        nullptr,
+        drawListShaderHeader,
+        "shaders/draw_constants.glsl"
     );
     Shader pbrShadowsSpotLightShader(
         "shaders/pbr_with_shadows/spot_light.vert",
-        "shaders/pbr_with_shadows/spot_light.frag"
+        "shaders/pbr_with_shadows/spot_light.frag",
+        nullptr,
+        drawListShaderHeader,
+        "shaders/draw_constants.glsl"
     );
     
+    // Per-draw constants of all draw lists are read by instanced draws as instanced attributes
+    // (from storage buffer with multi-draw indirect)
+    GLint constantsAlignment = sizeof(glm::vec4);
+    GLint storageBufferOffsetAlignment = sizeof(GLuint);
+    if (multiDrawIndirect)
+    {
+        // Constants and commands of multi-draw lists are bound as shader storage buffers
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageBufferOffsetAlignment);
+        constantsAlignment = std::max(constantsAlignment, storageBufferOffsetAlignment);
+    }
+    auto drawConstantsBuffer = std::make_unique<RingBuffer>(GL_ARRAY_BUFFER, DRAW_CONSTANTS_BUFFER_SIZE, constantsAlignment);
+    RingBuffer& drawConstants = *drawConstantsBuffer;
+    std::unique_ptr<RingBuffer> drawCommandsBuffer;
+    if (multiDrawIndirect)
+        drawCommandsBuffer = std::make_unique<RingBuffer>(GL_DRAW_INDIRECT_BUFFER, DRAW_COMMANDS_BUFFER_SIZE, storageBufferOffsetAlignment);
+    RingBuffer* drawCommands = drawCommandsBuffer.get();
+
+    // Multi-draw lists are culled on GPU as well, camera view is tested against depth of previous frame
+    std::unique_ptr<GpuCulling> gpuCulling;
+    std::unique_ptr<HiZPyramid> hiZPyramid;
+    if (multiDrawIndirect)
+    {
+        gpuCulling = std::make_unique<GpuCulling>(drawCommands->getSize(), MAX_CULLED_BATCHES);
+        hiZPyramid = std::make_unique<HiZPyramid>(screenWidth, screenHeight);
+    }
+
+    // Vertex shader invocations of every pass are shown in window title
+    auto passStatisticsQueries = std::make_unique<PassStatistics>(std::vector<std::string>{
+        "albedo", "point shadow", "point light", "spot shadow", "spot light" });
+    PassStatistics& passStatistics = *passStatisticsQueries;
+
+    // Frame preparation (transforms, culling, draw lists) runs on job system,
+    // main thread only submits GL commands. Model files are parsed on it as well.
+    JobSystem jobSystem;
+
+    // Textures are decoded and uploaded in background, so first frame doesn't wait for them
+    std::unique_ptr<TextureStreamer> textureStreamer;
+    if (streamTextures)
+    {
+        textureStreamer = std::make_unique<TextureStreamer>();
+        textureStreamer->setMipStreaming(streamMips);
+        textureStreamer->setCooking(cookTextures);
+    }
+    Model::textureStreamer = textureStreamer.get();
+
     // Load scene   
     SceneLoader sceneLoader;
-    sceneLoader.loadScene("LightData.txt", "ModelData.txt", dirLights, pointLights, spotLights, models, objects);             
+    sceneLoader.loadScene("LightData.txt", "ModelData.txt", scene, &jobSystem);             
 
     // Load skybox
     unsigned int cubemapTexture = loadCubemap(faces); 
@@ -168,8 +315,8 @@ int main()
     glfwSetWindowUserPointer(window, &lightManager);
 
     // Configure global OpenGL state: perform depth test, don't render faces, which don't look at user    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    getGLState().enable(GL_DEPTH_TEST);
+    getGLState().enable(GL_CULL_FACE);
 
 
     // Set shader in use
@@ -226,7 +373,7 @@ int main()
     // create depth cubemap texture
     unsigned int depthCubemap;
     glGenTextures(1, &depthCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+    getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
     for (unsigned int i = 0; i < 6; ++i)
     {
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, POINT_LIGHT_SHADOW_MAP_WIDTH, POINT_LIGHT_SHADOW_MAP_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
@@ -237,11 +384,11 @@ int main()
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     // attach depth texture as FBO's depth buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+    getGLState().bindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // Configure shader for rendering scene with point light shadows
     pointShadowsShader.use();
@@ -250,13 +397,20 @@ int main()
 
     auto woodTexture = loadTexture("data/textures/cube/container.png");
 
+    // Textures of models, skybox and scene are shared through the registry
+    TextureRegistry& textureRegistry = getTextureRegistry();
+    std::cout << "TEXTURE_REGISTRY:: textures: " << textureRegistry.getTextureCount()
+              << ", " << (textureRegistry.getLoadedBytes() >> 20) << " MB; shared by path: " << textureRegistry.getPathHits()
+              << ", by content: " << textureRegistry.getContentHits()
+              << ", " << (textureRegistry.getSavedBytes() >> 20) << " MB saved" << std::endl;
+
     auto createAndConfigureFramebuffer = [] (GLuint& framebuffer, GLuint& texture, GLuint& depthBuffer)
     {
         glGenFramebuffers(1, &framebuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        getGLState().bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
         glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        getGLState().bindTexture(GL_TEXTURE_2D, texture);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screenWidth, screenHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -264,7 +418,8 @@ int main()
 
         glGenRenderbuffers(1, &depthBuffer);
         glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, screenWidth, screenHeight);
+        // sized format, so that depth can be blit to hierarchical depth pyramid
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, screenWidth, screenHeight);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
         // finally check if framebuffer is complete
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -272,8 +427,8 @@ int main()
             std::cout << "Framebuffer not complete!" << std::endl;
         }
 
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        getGLState().bindTexture(GL_TEXTURE_2D, 0);
+        getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
     };
 
     // Configure framebuffers for light rendering and color blending
@@ -303,7 +458,27 @@ int main()
     textureRenderingShader.use();
     textureRenderingShader.setInt("sourceTexture", 0);
 
- 
+    // Draw lists are recorded once per view and replayed by all passes of that view
+    std::vector<std::uint32_t> visibleInstances;
+    DrawList cameraDrawList;
+    std::vector<ShadowCasterView> pointLightViews;
+    std::vector<ShadowCasterView> spotLightViews;
+
+    // GL calls issued and dropped by state cache are summed over a second and shown in window title
+    GLStateCache& glState = getGLState();
+    glState.resetStats();
+    unsigned long long issuedStateCalls = 0;
+    unsigned long long skippedStateCalls = 0;
+    unsigned int statsFrames = 0;
+    float statsStartTime = glfwGetTime();
+    // Triangles submitted by all passes with chosen levels of detail and with full meshes
+    unsigned long long submittedTriangles = 0;
+    unsigned long long fullTriangles = 0;
+    auto countTriangles = [&submittedTriangles, &fullTriangles](const DrawList& drawList)
+    {
+        submittedTriangles += drawList.getTriangleCount();
+        fullTriangles += drawList.getFullTriangleCount();
+    };
 
     // Render loop    
     while (!glfwWindowShouldClose(window))
@@ -312,8 +487,43 @@ int main()
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+
+        if (textureStreamer)
+            textureStreamer->update();
+
+        issuedStateCalls += glState.getStats().issued;
+        skippedStateCalls += glState.getStats().skipped;
+        glState.resetStats();
+        passStatistics.collect();
+        ++statsFrames;
+        if (currentFrame - statsStartTime >= 1.0f)
+        {
+            std::string title = "Seminar10 - Lighting | GL state calls per frame: "
+                + std::to_string(issuedStateCalls / statsFrames) + " issued, "
+                + std::to_string(skippedStateCalls / statsFrames) + " redundant skipped";
+            if (passStatistics.isEnabled())
+            {
+                title += " | VS invocations per frame:";
+                for (unsigned int pass = 0; pass < passStatistics.getPassCount(); ++pass)
+                    title += " " + passStatistics.getPassName(pass) + " " + std::to_string(passStatistics.getInvocations(pass) / statsFrames);
+            }
+            title += " | triangles per frame: " + std::to_string(submittedTriangles / statsFrames)
+                + " (" + std::to_string(fullTriangles / statsFrames) + " without LOD)";
+            if (textureStreamer && textureStreamer->getPendingCount() > 0)
+                title += " | textures loading: " + std::to_string(textureStreamer->getPendingCount());
+            if (textureStreamer)
+                title += " | texture memory: " + std::to_string(textureStreamer->getResidentBytes() >> 20) + " of "
+                    + std::to_string(textureStreamer->getFullBytes() >> 20) + " MB";
+            glfwSetWindowTitle(window, title.c_str());
+            submittedTriangles = fullTriangles = 0;
+            passStatistics.resetTotals();
+            issuedStateCalls = skippedStateCalls = 0;
+            statsFrames = 0;
+            statsStartTime = currentFrame;
+        }
         lightManager.updateDeltaTime(deltaTime);
         lightManager.update();
+        scene.update(&jobSystem);
 
         // Render        
         glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
@@ -328,22 +538,139 @@ int main()
         );
         glm::mat4 view = camera.GetViewMatrix();
 
+        // Cull and record draws of camera and of every shadow casting light in parallel,
+        // their per-draw constants are written to the ring buffer region of this frame
+        drawConstants.beginFrame();
+        if (drawCommands)
+            drawCommands->beginFrame();
+        // Level of detail error is measured in pixels of camera viewport and of shadow cubemap face (90 degrees)
+        LodSelection cameraLods;
+        cameraLods.projectionScale = screenHeight / (2.0f * glm::tan(glm::radians(camera.Zoom) * 0.5f));
+        cameraLods.maxPixelError = CAMERA_LOD_PIXEL_ERROR;
+        LodSelection shadowLods;
+        shadowLods.projectionScale = POINT_LIGHT_SHADOW_MAP_HEIGHT * 0.5f;
+        shadowLods.maxPixelError = SHADOW_LOD_PIXEL_ERROR;
+
+        JobCounter framePrepared;
+        auto recordDrawLists = [&]()
+        {
+            jobSystem.run([&visibleInstances, &cameraDrawList, &drawConstants, drawCommands, &projection, &view, cameraLods]()
+            {
+                // Mesh instances inside camera frustum, they are drawn by all passes rendered from camera
+                Frustum frustum = Frustum::fromMatrix(projection * view);
+                visibleInstances.clear();
+                scene.queryFrustum(frustum, visibleInstances);
+                DrawView cameraView;
+                cameraView.position = camera.Position;
+                cameraView.frustum = &frustum;
+                cameraView.lods = cameraLods;
+                cameraDrawList.build(scene, visibleInstances, cameraView, drawConstants, drawCommands);
+            }, &framePrepared);
+
+            auto prepareShadowCasters = [&jobSystem, &framePrepared, &drawConstants, drawCommands, shadowLods](ShadowCasterView& shadowView, glm::vec3 lightPos, float far_plane)
+            {
+                jobSystem.run([&shadowView, &drawConstants, drawCommands, lightPos, far_plane, shadowLods]()
+                {
+                    // Only geometry within shadow map range can cast shadows
+                    shadowView.casters.clear();
+                    scene.querySphere(lightPos, far_plane, shadowView.casters);
+                    DrawView lightView;
+                    lightView.position = lightPos;
+                    lightView.range = far_plane;
+                    lightView.lods = shadowLods;
+                    shadowView.drawList.build(scene, shadowView.casters, lightView, drawConstants, drawCommands);
+                }, &framePrepared);
+            };
+            pointLightViews.resize(pointLights.size());
+            for (PointLights::size_type i = 0; i < pointLights.size(); ++i)
+            {
+                if (pointLights[i].isOn())
+                    prepareShadowCasters(pointLightViews[i], pointLights[i].getPosition(), POINT_LIGHT_FAR_PLANE);
+            }
+            spotLightViews.resize(spotLights.size());
+            for (SpotLights::size_type i = 0; i < spotLights.size(); ++i)
+            {
+                if (spotLights[i].isOn())
+                    prepareShadowCasters(spotLightViews[i], spotLights[i].getPosition(), SPOT_LIGHT_FAR_PLANE);
+            }
+        };
+        recordDrawLists();
+        jobSystem.wait(framePrepared);
+
+        // Lists which didn't fit are recorded again into grown buffers rather than skipped for the frame
+        while (drawConstants.hasOverflowed() || (drawCommands && drawCommands->hasOverflowed()))
+        {
+            for (RingBuffer* buffer : { &drawConstants, drawCommands })
+            {
+                if (buffer && buffer->hasOverflowed())
+                    buffer->grow();
+                else if (buffer)
+                    buffer->restartFrame();
+            }
+            if (gpuCulling)
+                gpuCulling->resize(drawCommands->getSize());
+            recordDrawLists();
+            jobSystem.wait(framePrepared);
+        }
+        if (textureStreamer)
+            recordTextureUse(*textureStreamer, visibleInstances, camera.Position, cameraLods.projectionScale);
+        drawConstants.flush();
+        if (drawCommands)
+            drawCommands->flush();
+
+        if (gpuCulling)
+        {
+            gpuCulling->beginFrame();
+
+            GpuCulling::View cameraView;
+            cameraView.frustumTest = true;
+            cameraView.frustum = Frustum::fromMatrix(projection * view);
+            cameraView.occlusion = hiZPyramid.get();
+            cameraView.coneTest = true;
+            cameraView.viewPosition = camera.Position;
+            gpuCulling->cull(cameraDrawList, cameraView);
+
+            auto cullShadowCasters = [&gpuCulling](ShadowCasterView& shadowView, glm::vec3 lightPos, float far_plane)
+            {
+                GpuCulling::View lightView;
+                lightView.sphereTest = true;
+                lightView.sphereCenter = lightPos;
+                lightView.sphereRadius = far_plane;
+                lightView.coneTest = true;
+                lightView.viewPosition = lightPos;
+                gpuCulling->cull(shadowView.drawList, lightView);
+            };
+            for (PointLights::size_type i = 0; i < pointLights.size(); ++i)
+            {
+                if (pointLights[i].isOn())
+                    cullShadowCasters(pointLightViews[i], pointLights[i].getPosition(), POINT_LIGHT_FAR_PLANE);
+            }
+            for (SpotLights::size_type i = 0; i < spotLights.size(); ++i)
+            {
+                if (spotLights[i].isOn())
+                    cullShadowCasters(spotLightViews[i], spotLights[i].getPosition(), SPOT_LIGHT_FAR_PLANE);
+            }
+        }
+
         auto renderPointLightWithShadows = [
             &simpleDepthShader, 
             &pbrShadowsPointLightShader,
             &view, 
             &projection, 
             &depthMapFBO, 
-            &depthCubemap](
+            &depthCubemap,
+            &cameraDrawList,
+            &passStatistics](
             PointLight& pointLight,
+            const DrawList& shadowCasterDrawList,
             GLuint& renderingFramebuffer)
         {
-            glEnable(GL_DEPTH_TEST);
+            getGLState().enable(GL_DEPTH_TEST);
             glm::vec3 lightPos = pointLight.getPosition();
             // 0. create depth cubemap transformation matrices
             // -----------------------------------------------
             float near_plane = 0.1f;
-            float far_plane = 20.0f;
+            float far_plane = POINT_LIGHT_FAR_PLANE;
             glm::mat4 shadowProj = glm::perspective(
                 glm::radians(90.0f),
                 static_cast<float>(POINT_LIGHT_SHADOW_MAP_WIDTH) / static_cast<float>(POINT_LIGHT_SHADOW_MAP_HEIGHT),
@@ -360,8 +687,8 @@ int main()
 
             // 1. render scene to depth cubemap
             // --------------------------------
-            glViewport(0, 0, POINT_LIGHT_SHADOW_MAP_WIDTH, POINT_LIGHT_SHADOW_MAP_HEIGHT);
-            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+            getGLState().viewport(0, 0, POINT_LIGHT_SHADOW_MAP_WIDTH, POINT_LIGHT_SHADOW_MAP_HEIGHT);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
             glClear(GL_DEPTH_BUFFER_BIT);
             simpleDepthShader.use();
             for (unsigned int i = 0; i < 6; ++i)
@@ -371,20 +698,16 @@ int main()
             simpleDepthShader.setFloat("far_plane", far_plane);
             simpleDepthShader.setVec3("lightPos", lightPos);
             
-            for (unsigned int i = 0; i < objects.size(); i++)
-            {
-                glm::mat4 model = objects[i].getModelMatrix();
-                simpleDepthShader.setMat4("model", model);
+            passStatistics.begin(POINT_SHADOW_PASS);
+            shadowCasterDrawList.replay(simpleDepthShader);
+            passStatistics.end();
 
-                objects[i].getModel()->Draw(simpleDepthShader);
-            }
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
             // 2. render scene as normal 
             // -------------------------
-            glViewport(0, 0, screenWidth, screenHeight);
-            glBindFramebuffer(GL_FRAMEBUFFER, renderingFramebuffer);
+            getGLState().viewport(0, 0, screenWidth, screenHeight);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, renderingFramebuffer);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             pbrShadowsPointLightShader.use();
@@ -403,26 +726,18 @@ int main()
             pbrShadowsPointLightShader.setInt(  "shadows"   , shadows); // enable/disable shadows by pressing 'SPACE'
             pbrShadowsPointLightShader.setInt(  "depthMap"  , SHADOW_DEPTH_MAP_INDEX);
             
-            glActiveTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+            getGLState().activeTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
+            getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
             
             // Render objects
-            for (unsigned int i = 0; i < objects.size(); i++)
-            {
-                glm::mat4 model = objects[i].getModelMatrix();
-                pbrShadowsPointLightShader.setMat4("model", model);
-
-                // Fixes normals in case of non-uniform model scaling
-                glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
-                pbrShadowsPointLightShader.setMat3("normalMatrix", normalMatrix);
-
-                objects[i].getModel()->Draw(pbrShadowsPointLightShader);
-            }
+            passStatistics.begin(POINT_LIGHT_PASS);
+            cameraDrawList.replay(pbrShadowsPointLightShader);
+            passStatistics.end();
 
-            glActiveTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            getGLState().activeTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
+            getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
         };
 
         auto renderSpotLightWithShadows = [
@@ -431,16 +746,19 @@ int main()
             &view, 
             &projection, 
             &depthMapFBO, 
-            &depthCubemap](
+            &depthCubemap,
+            &cameraDrawList,
+            &passStatistics](
             SpotLight& spotLight,
+            const DrawList& shadowCasterDrawList,
             GLuint& renderingFramebuffer)
         {
-            glEnable(GL_DEPTH_TEST);
+            getGLState().enable(GL_DEPTH_TEST);
             glm::vec3 lightPos = spotLight.getPosition();
             // 0. create depth cubemap transformation matrices
             // -----------------------------------------------
             float near_plane = 0.1f;
-            float far_plane = 25.0f;
+            float far_plane = SPOT_LIGHT_FAR_PLANE;
             glm::mat4 shadowProj = glm::perspective(
                 glm::radians(90.0f),
                 static_cast<float>(POINT_LIGHT_SHADOW_MAP_WIDTH) / static_cast<float>(POINT_LIGHT_SHADOW_MAP_HEIGHT),
@@ -457,8 +775,8 @@ int main()
 
             // 1. render scene to depth cubemap
             // --------------------------------
-            glViewport(0, 0, POINT_LIGHT_SHADOW_MAP_WIDTH, POINT_LIGHT_SHADOW_MAP_HEIGHT);
-            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+            getGLState().viewport(0, 0, POINT_LIGHT_SHADOW_MAP_WIDTH, POINT_LIGHT_SHADOW_MAP_HEIGHT);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
             glClear(GL_DEPTH_BUFFER_BIT);
             simpleDepthShader.use();
             for (unsigned int i = 0; i < 6; ++i)
@@ -468,20 +786,16 @@ int main()
             simpleDepthShader.setFloat("far_plane", far_plane);
             simpleDepthShader.setVec3("lightPos", lightPos);
 
-            for (unsigned int i = 0; i < objects.size(); i++)
-            {
-                glm::mat4 model = objects[i].getModelMatrix();
-                simpleDepthShader.setMat4("model", model);
+            passStatistics.begin(SPOT_SHADOW_PASS);
+            shadowCasterDrawList.replay(simpleDepthShader);
+            passStatistics.end();
 
-                objects[i].getModel()->Draw(simpleDepthShader);
-            }
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
             // 2. render scene as normal 
             // -------------------------
-            glViewport(0, 0, screenWidth, screenHeight);
-            glBindFramebuffer(GL_FRAMEBUFFER, renderingFramebuffer);
+            getGLState().viewport(0, 0, screenWidth, screenHeight);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, renderingFramebuffer);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             // Shader configuration
@@ -503,51 +817,40 @@ int main()
             pbrShadowsSpotLightShader.setFloat("far_plane"  , far_plane);
             pbrShadowsSpotLightShader.setInt(  "depthMap"   , SHADOW_DEPTH_MAP_INDEX);
 
-            glActiveTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+            getGLState().activeTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
+            getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
             
             // Render objects
-            for (unsigned int i = 0; i < objects.size(); i++)
-            {
-                glm::mat4 model = objects[i].getModelMatrix();
-                pbrShadowsSpotLightShader.setMat4("model", model);
+            passStatistics.begin(SPOT_LIGHT_PASS);
+            cameraDrawList.replay(pbrShadowsSpotLightShader);
+            passStatistics.end();
 
-                // Fixes normals in case of non-uniform model scaling
-                glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
-                pbrShadowsSpotLightShader.setMat3("normalMatrix", normalMatrix);
+            getGLState().activeTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
+            getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-                objects[i].getModel()->Draw(pbrShadowsSpotLightShader);
-            }
-
-            glActiveTexture(GL_TEXTURE0 + SHADOW_DEPTH_MAP_INDEX);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
         };
 
         albedoShader.use();
         albedoShader.setMat4("projection"   , projection);
         albedoShader.setMat4("view"         , view);
 
-        glEnable(GL_DEPTH_TEST);
-        glViewport(0, 0, screenWidth, screenHeight);
-        glBindFramebuffer(GL_FRAMEBUFFER, blendedFramebuffer);
+        getGLState().enable(GL_DEPTH_TEST);
+        getGLState().viewport(0, 0, screenWidth, screenHeight);
+        getGLState().bindFramebuffer(GL_FRAMEBUFFER, blendedFramebuffer);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
          // Render objects
-        for (unsigned int i = 0; i < objects.size(); i++)
-        {
-            glm::mat4 model = objects[i].getModelMatrix();
-            albedoShader.setMat4("model", model);
-
-            // Fixes normals in case of non-uniform model scaling
-            glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
-            albedoShader.setMat3("normalMatrix", normalMatrix);
+        passStatistics.begin(ALBEDO_PASS);
+        cameraDrawList.replay(albedoShader);
+        passStatistics.end();
+        countTriangles(cameraDrawList);
 
-            objects[i].getModel()->Draw(albedoShader);
-        }
+        getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // Depth of albedo pass is used for occlusion culling of the next frame
+        if (hiZPyramid)
+            hiZPyramid->build(blendedFramebuffer, projection * view);
 
         for (auto i = 0; i < pointLights.size(); ++i)
         {
@@ -555,18 +858,20 @@ int main()
             {
                 continue;
             }
-            renderPointLightWithShadows(pointLights[i], lightRenderFramebuffer);
+            renderPointLightWithShadows(pointLights[i], pointLightViews[i].drawList, lightRenderFramebuffer);
+            countTriangles(pointLightViews[i].drawList);
+            countTriangles(cameraDrawList);
             {
-                glBindFramebuffer(GL_FRAMEBUFFER, currentBlendingFramebuffer);
-                glDisable(GL_DEPTH_TEST);
+                getGLState().bindFramebuffer(GL_FRAMEBUFFER, currentBlendingFramebuffer);
+                getGLState().disable(GL_DEPTH_TEST);
                 glClear(GL_COLOR_BUFFER_BIT);
                 shadowAccumulatorShader.use();
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, lightRenderTexture);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, blendedTexture);
+                getGLState().activeTexture(GL_TEXTURE0);
+                getGLState().bindTexture(GL_TEXTURE_2D, lightRenderTexture);
+                getGLState().activeTexture(GL_TEXTURE1);
+                getGLState().bindTexture(GL_TEXTURE_2D, blendedTexture);
                 renderScreenQuad();
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
             }
             std::swap(currentBlendingFramebuffer, blendedFramebuffer);
             std::swap(currentBlendingTexture, blendedTexture);
@@ -577,47 +882,49 @@ int main()
             {
                 continue;
             }
-            renderSpotLightWithShadows(spotLights[i], lightRenderFramebuffer);
+            renderSpotLightWithShadows(spotLights[i], spotLightViews[i].drawList, lightRenderFramebuffer);
+            countTriangles(spotLightViews[i].drawList);
+            countTriangles(cameraDrawList);
             {
-                glBindFramebuffer(GL_FRAMEBUFFER, currentBlendingFramebuffer);
-                glDisable(GL_DEPTH_TEST);
+                getGLState().bindFramebuffer(GL_FRAMEBUFFER, currentBlendingFramebuffer);
+                getGLState().disable(GL_DEPTH_TEST);
                 glClear(GL_COLOR_BUFFER_BIT);
                 shadowAccumulatorShader.use();
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, lightRenderTexture);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, blendedTexture);
+                getGLState().activeTexture(GL_TEXTURE0);
+                getGLState().bindTexture(GL_TEXTURE_2D, lightRenderTexture);
+                getGLState().activeTexture(GL_TEXTURE1);
+                getGLState().bindTexture(GL_TEXTURE_2D, blendedTexture);
                 renderScreenQuad();
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
             }
             std::swap(currentBlendingFramebuffer, blendedFramebuffer);
             std::swap(currentBlendingTexture, blendedTexture);
         }
 
         textureRenderingShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, blendedTexture);
+        getGLState().activeTexture(GL_TEXTURE0);
+        getGLState().bindTexture(GL_TEXTURE_2D, blendedTexture);
         renderScreenQuad();
-        glBindTexture(GL_TEXTURE_2D, 0);       
+        getGLState().bindTexture(GL_TEXTURE_2D, 0);       
         
         if (std::any_of(pointLights.begin(), pointLights.end(), [] (const PointLight& light) { return light.isOn(); }) ||
             std::any_of(spotLights.begin() , spotLights.end() , [] (const SpotLight& light)  { return light.isOn(); }))
         {
             // TODO: find proper fix for depth bug
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, lightRenderFramebuffer);
+            getGLState().bindFramebuffer(GL_READ_FRAMEBUFFER, lightRenderFramebuffer);
         }
         else
         {
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, blendedFramebuffer);
+            getGLState().bindFramebuffer(GL_READ_FRAMEBUFFER, blendedFramebuffer);
         }
 
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        getGLState().bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
         
         // blit to default framebuffer.                                           
         glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        getGLState().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        glEnable(GL_DEPTH_TEST);
+        getGLState().enable(GL_DEPTH_TEST);
 
         shaderLightBox.use();
         shaderLightBox.setMat4("projection", projection);
@@ -660,14 +967,54 @@ int main()
         processInput(window, lightManager);
 
         // GLFW: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        drawConstants.endFrame();
+        if (drawCommands)
+            drawCommands->endFrame();
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    // GL objects must be released while context still exists
+    drawConstantsBuffer.reset();
+    drawCommandsBuffer.reset();
+    gpuCulling.reset();
+    hiZPyramid.reset();
+    passStatisticsQueries.reset();
+    getTextureRegistry().releaseAll();
+    Model::textureStreamer = nullptr;
+    textureStreamer.reset();
+    Mesh::getGeometryArena().release();
+
     glfwTerminate();
     return 0;
 }
 
+// reports mip levels needed by textures of visible mesh instances to the streamer. Pixel is
+// measured at the closest point of instance bounds, like level of detail error.
+// --------------------
+void recordTextureUse(TextureStreamer& textureStreamer, const std::vector<std::uint32_t>& instances,
+    glm::vec3 viewPosition, float projectionScale)
+{
+    const SceneGraph& sceneGraph = scene.getSceneGraph();
+    const std::vector<Scene::MeshInstance>& meshInstances = scene.getMeshInstances();
+    for (std::uint32_t index : instances)
+    {
+        const Scene::MeshInstance& instance = meshInstances[index];
+        const Mesh& mesh = scene.getModel(instance.model)->meshes[instance.mesh];
+        if (mesh.getTextures().empty())
+            continue;
+
+        const glm::mat4& world = sceneGraph.getWorldMatrix(instance.node);
+        float worldScale = std::max(std::max(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1]))), glm::length(glm::vec3(world[2])));
+        const AABB& bounds = instance.worldBounds;
+        float boundsRadius = 0.5f * glm::length(bounds.max - bounds.min);
+        float distance = std::max(glm::length(bounds.getCenter() - viewPosition) - boundsRadius, 0.0f);
+        float texCoordsPerPixel = mesh.getTexCoordDensity() / worldScale * distance / projectionScale;
+        for (const Texture& texture : mesh.getTextures())
+            textureStreamer.recordUse(texture.id, texCoordsPerPixel);
+    }
+}
+
 // renders the 3D scene
 // --------------------
 void renderScene(const Shader &shader)
@@ -676,11 +1023,11 @@ void renderScene(const Shader &shader)
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(10.0f));
     shader.setMat4("model", model);
-    glDisable(GL_CULL_FACE); // note that we disable culling here since we render 'inside' the cube instead of the usual 'outside' which throws off the normal culling methods.
+    getGLState().disable(GL_CULL_FACE); // note that we disable culling here since we render 'inside' the cube instead of the usual 'outside' which throws off the normal culling methods.
     shader.setInt("reverse_normals", 1); // A small little hack to invert normals when drawing cube from the inside so lighting still works.
     renderSeminarCube();
     shader.setInt("reverse_normals", 0); // and of course disable it
-    glEnable(GL_CULL_FACE);
+    getGLState().enable(GL_CULL_FACE);
     // cubes
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(4.0f, -3.5f, 0.0));
@@ -762,7 +1109,7 @@ void renderSkybox(unsigned int cubemapTexture){
 
         glGenVertexArrays(1, &skyboxVAO);
         glGenBuffers(1, &skyboxVBO);
-        glBindVertexArray(skyboxVAO);
+        getGLState().bindVertexArray(skyboxVAO);
         // fill buffer
         glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
@@ -771,19 +1118,19 @@ void renderSkybox(unsigned int cubemapTexture){
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);   
         // set to defaults     
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        getGLState().bindVertexArray(0);
     }
-    glDepthFunc(GL_LEQUAL); // For rendering skybox behind all other objects in scene
-    glBindVertexArray(skyboxVAO);
-    glActiveTexture(GL_TEXTURE0 + SKYBOX_TEXTURE_INDEX);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    getGLState().depthFunc(GL_LEQUAL); // For rendering skybox behind all other objects in scene
+    getGLState().bindVertexArray(skyboxVAO);
+    getGLState().activeTexture(GL_TEXTURE0 + SKYBOX_TEXTURE_INDEX);
+    getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
 
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    glActiveTexture(GL_TEXTURE0);
-    glDepthFunc(GL_LESS);// glDepthMask(GL_TRUE);
-    glBindVertexArray(0);
+    getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    getGLState().activeTexture(GL_TEXTURE0);
+    getGLState().depthFunc(GL_LESS);// glDepthMask(GL_TRUE);
+    getGLState().bindVertexArray(0);
 }
 
 // renderCube() renders a 1x1 3D cube in NDC.
@@ -841,7 +1188,7 @@ void renderCube()
         };
         glGenVertexArrays(1, &cubeVAO);
         glGenBuffers(1, &cubeVBO);
-        glBindVertexArray(cubeVAO);
+        getGLState().bindVertexArray(cubeVAO);
         // fill buffer
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
@@ -851,12 +1198,12 @@ void renderCube()
 
         // set to defaults      
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        getGLState().bindVertexArray(0);
     }
     // render Cube
-    glBindVertexArray(cubeVAO);
+    getGLState().bindVertexArray(cubeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    getGLState().bindVertexArray(0);
 }
 
 unsigned int seminarCubeVAO = 0;
@@ -919,7 +1266,7 @@ void renderSeminarCube()
         glBindBuffer(GL_ARRAY_BUFFER, seminarCubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-        glBindVertexArray(seminarCubeVAO);
+        getGLState().bindVertexArray(seminarCubeVAO);
 
         const int stride = 8;
 
@@ -936,10 +1283,10 @@ void renderSeminarCube()
         //seminarCubeTexture = loadTexture("data/textures/cube/container.png");
     }
     // render Cube
-    glBindVertexArray(seminarCubeVAO);
-    //glBindTexture(GL_TEXTURE_2D, seminarCubeTexture);
+    getGLState().bindVertexArray(seminarCubeVAO);
+    //getGLState().bindTexture(GL_TEXTURE_2D, seminarCubeTexture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    getGLState().bindVertexArray(0);
 }
 
 unsigned int pyramidVAO = 0;
@@ -979,7 +1326,7 @@ void renderPyramid()
 
         glGenVertexArrays(1, &pyramidVAO);
         glGenBuffers(1, &pyramidVBO);
-        glBindVertexArray(pyramidVAO);
+        getGLState().bindVertexArray(pyramidVAO);
         // fill buffer
         glBindBuffer(GL_ARRAY_BUFFER, pyramidVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
@@ -987,11 +1334,11 @@ void renderPyramid()
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);        
+        getGLState().bindVertexArray(0);        
     }
-    glBindVertexArray(pyramidVAO);
+    getGLState().bindVertexArray(pyramidVAO);
     glDrawArrays(GL_TRIANGLES, 0, 18);
-    glBindVertexArray(0);
+    getGLState().bindVertexArray(0);
 }
 
 
@@ -1013,7 +1360,7 @@ void renderScreenQuad()
         };
         glGenVertexArrays(1, &screenQuadVAO);
         glGenBuffers(1, &screenQuadVBO);
-        glBindVertexArray(screenQuadVAO);
+        getGLState().bindVertexArray(screenQuadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, screenQuadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -1021,7 +1368,7 @@ void renderScreenQuad()
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     }
-    glBindVertexArray(screenQuadVAO);
+    getGLState().bindVertexArray(screenQuadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
@@ -1043,7 +1390,7 @@ void renderQuad()
         // setup plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        getGLState().bindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -1051,9 +1398,9 @@ void renderQuad()
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
+    getGLState().bindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    getGLState().bindVertexArray(0);
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -1082,7 +1429,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    getGLState().viewport(0, 0, width, height);
     screenWidth = width;
     screenHeight = height;
 }
@@ -1144,16 +1491,22 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
-    unsigned int textureID;
+    TextureKey key = TextureRegistry::makeKey(faces);
+    unsigned int textureID = getTextureRegistry().acquire(key);
+    if (textureID != 0)
+        return textureID;
+
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
+    std::size_t size = 0;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
         unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
         if (data)
         {
+            size += static_cast<std::size_t>(width) * height * 4;
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
                          0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
             );
@@ -1171,15 +1524,21 @@ unsigned int loadCubemap(vector<std::string> faces)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    getGLState().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
+    getTextureRegistry().add(key, textureID, size);
     return textureID;
 }  
 
 unsigned int loadTexture(char const * path)
 {
-    unsigned int textureID;
+    TextureKey key = TextureRegistry::makeKey(path);
+    unsigned int textureID = getTextureRegistry().acquire(key);
+    if (textureID != 0)
+        return textureID;
+
     glGenTextures(1, &textureID);
+    std::size_t size = 0;
 
     int width, height, nrComponents;
     unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
@@ -1193,7 +1552,7 @@ unsigned int loadTexture(char const * path)
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        getGLState().bindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -1202,6 +1561,7 @@ unsigned int loadTexture(char const * path)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+        size = getTextureSize(width, height, nrComponents);
         stbi_image_free(data);
     }
     else
@@ -1210,5 +1570,6 @@ unsigned int loadTexture(char const * path)
         stbi_image_free(data);
     }
 
+    getTextureRegistry().add(key, textureID, size);
     return textureID;
 }
\ No newline at end of file